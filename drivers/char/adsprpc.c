@@ -56,7 +56,7 @@
 #define FASTRPC_ENOSUCH 39
 #define VMID_SSC_Q6     5
 #define VMID_ADSP_Q6    6
-#define DEBUGFS_SIZE 3072
+#define DEBUGFS_SIZE 4096
 #define UL_SIZE 25
 #define PID_SIZE 10
 
@@ -108,7 +108,8 @@
 #define RH_CID ADSP_DOMAIN_ID
 
 #define PERF_KEYS \
-	"count:flush:map:copy:rpmsg:getargs:putargs:invalidate:invoke"
+	"count:flush:map:copy:rpmsg:getargs:putargs:invalidate:invoke:"\
+	"regcount:regsetup:wait"
 #define FASTRPC_STATIC_HANDLE_PROCESS_GROUP (1)
 #define FASTRPC_STATIC_HANDLE_DSP_UTILITIES (2)
 #define FASTRPC_STATIC_HANDLE_LISTENER (3)
@@ -133,6 +134,15 @@
 /* latency in us, early wake up signal used below this value */
 #define FASTRPC_EARLY_WAKEUP_LATENCY (200)
 
+/* default spin budget in us for adaptive completion wait */
+#define FASTRPC_ADAPTIVE_SPIN_MAX_US (200)
+
+/* handles tracked per file for adaptive completion wait */
+#define FASTRPC_HANDLE_LAT_BITS (4)
+
+/* log2 us buckets of the per channel completion wait histogram */
+#define FASTRPC_WAIT_HIST_BUCKETS (16)
+
 /* response version number */
 #define FASTRPC_RSP_VERSION2 (2)
 
@@ -260,6 +270,7 @@ struct fastrpc_buf {
 };
 
 struct fastrpc_ctx_lst;
+struct fastrpc_reg_args;
 
 struct overlap {
 	uintptr_t start;
@@ -300,6 +311,10 @@ struct smq_invoke_ctx {
 	uint32_t earlyWakeTime;
 	/* work done status flag */
 	bool isWorkDone;
+	/* registered argument set, NULL for regular invokes */
+	struct fastrpc_reg_args *reg;
+	/* us to spin before sleeping on a normal response, 0 to sleep */
+	uint32_t spinTime;
 };
 
 struct fastrpc_ctx_lst {
@@ -372,6 +387,10 @@ struct fastrpc_channel_ctx {
 	bool cpuinfo_status;
 	struct smq_invoke_ctx *ctxtable[FASTRPC_CTX_MAX];
 	spinlock_t ctxlock;
+	/* completion wait time distribution and adaptive spin outcome */
+	atomic64_t wait_hist[FASTRPC_WAIT_HIST_BUCKETS];
+	atomic64_t spin_hit;
+	atomic64_t spin_miss;
 };
 
 struct fastrpc_apps {
@@ -428,6 +447,27 @@ struct fastrpc_mmap {
 	unsigned int dma_handle_refs;
 };
 
+/*
+ * Argument set registered by FASTRPC_IOCTL_REGISTER_ARGS. Buffers are
+ * mapped and the invoke metadata is built once, so FASTRPC_IOCTL_INVOKE_REG
+ * only restores the metadata and does cache maintenance on dirty buffers.
+ */
+struct fastrpc_reg_args {
+	struct hlist_node hn;
+	int id;
+	/* set while an invoke owns the set, protected by fl->hlock */
+	int busy;
+	uint32_t sc;
+	struct fastrpc_mmap *maps[FASTRPC_REG_ARGS_MAX];
+	/* byte offset and length of each argument inside its dma buf */
+	uintptr_t offs[FASTRPC_REG_ARGS_MAX];
+	size_t lens[FASTRPC_REG_ARGS_MAX];
+	struct fastrpc_buf *buf;
+	/* pristine copy of the metadata the remote side may overwrite */
+	void *meta;
+	size_t metalen;
+};
+
 enum fastrpc_perfkeys {
 	PERF_COUNT = 0,
 	PERF_FLUSH = 1,
@@ -438,7 +478,10 @@ enum fastrpc_perfkeys {
 	PERF_PUTARGS = 6,
 	PERF_INVARGS = 7,
 	PERF_INVOKE = 8,
-	PERF_KEY_MAX = 9,
+	PERF_REG_COUNT = 9,
+	PERF_REG_SETUP = 10,
+	PERF_WAIT = 11,
+	PERF_KEY_MAX = 12,
 };
 
 struct fastrpc_perf {
@@ -451,16 +494,27 @@ struct fastrpc_perf {
 	int64_t putargs;
 	int64_t invargs;
 	int64_t invoke;
+	int64_t regcount;
+	int64_t regsetup;
+	int64_t wait;
 	int64_t tid;
 	struct hlist_node hn;
 };
 
+/* Moving average of the completion wait seen for a remote handle */
+struct fastrpc_handle_lat {
+	uint32_t handle;
+	uint32_t avg_us;
+};
+
 struct fastrpc_file {
 	struct hlist_node hn;
 	spinlock_t hlock;
 	struct hlist_head maps;
 	struct hlist_head cached_bufs;
 	struct hlist_head remote_bufs;
+	struct hlist_head reg_args;
+	int reg_args_id;
 	struct fastrpc_ctx_lst clst;
 	struct fastrpc_session_ctx *sctx;
 	struct fastrpc_buf *init_mem;
@@ -495,6 +549,10 @@ struct fastrpc_file {
 	/* Flag to indicate dynamic process creation status*/
 	enum fastrpc_process_create_state dsp_process_state;
 	struct completion shutdown;
+	/* Adaptive spin/sleep on invoke completion */
+	int adaptive_wait;
+	uint32_t spin_max_us;
+	struct fastrpc_handle_lat handle_lat[1 << FASTRPC_HANDLE_LAT_BITS];
 };
 
 static struct fastrpc_apps gfa;
@@ -1300,7 +1358,8 @@ static int context_restore_interrupted(struct fastrpc_file *fl,
 	spin_lock(&fl->hlock);
 	hlist_for_each_entry_safe(ictx, n, &fl->clst.interrupted, hn) {
 		if (ictx->pid == current->pid) {
-			if (invoke->sc != ictx->sc || ictx->fl != fl)
+			if (invoke->sc != ictx->sc || ictx->fl != fl ||
+				ictx->reg)
 				err = -1;
 			else {
 				ctx = ictx;
@@ -1401,17 +1460,39 @@ static int context_build_overlap(struct smq_invoke_ctx *ctx)
 
 static void context_free(struct smq_invoke_ctx *ctx);
 
+static int context_assign_ctxid(struct fastrpc_channel_ctx *chan, int cid,
+				struct smq_invoke_ctx *ctx)
+{
+	struct fastrpc_apps *me = &gfa;
+	unsigned long irq_flags = 0;
+	int err = 0, ii;
+
+	spin_lock_irqsave(&chan->ctxlock, irq_flags);
+	me->jobid[cid]++;
+	for (ii = 0; ii < FASTRPC_CTX_MAX; ii++) {
+		if (!chan->ctxtable[ii]) {
+			chan->ctxtable[ii] = ctx;
+			ctx->ctxid = (me->jobid[cid] << 12) | (ii << 4);
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&chan->ctxlock, irq_flags);
+	VERIFY(err, ii < FASTRPC_CTX_MAX);
+	if (err)
+		pr_err("adsprpc: out of context memory\n");
+	return err;
+}
+
 static int context_alloc(struct fastrpc_file *fl, uint32_t kernel,
 			 struct fastrpc_ioctl_invoke_crc *invokefd,
 			 struct smq_invoke_ctx **po)
 {
 	struct fastrpc_apps *me = &gfa;
-	int err = 0, bufs, ii, size = 0, cid = -1;
+	int err = 0, bufs, size = 0, cid = -1;
 	struct smq_invoke_ctx *ctx = NULL;
 	struct fastrpc_ctx_lst *clst = &fl->clst;
 	struct fastrpc_ioctl_invoke *invoke = &invokefd->inv;
 	struct fastrpc_channel_ctx *chan = 0;
-	unsigned long irq_flags = 0;
 
 	bufs = REMOTE_SCALARS_LENGTH(invoke->sc);
 	size = bufs * sizeof(*ctx->lpra) + bufs * sizeof(*ctx->maps) +
@@ -1479,21 +1560,9 @@ static int context_alloc(struct fastrpc_file *fl, uint32_t kernel,
 	chan = &me->channel[cid];
 	spin_unlock(&fl->hlock);
 
-	spin_lock_irqsave(&chan->ctxlock, irq_flags);
-	me->jobid[cid]++;
-	for (ii = 0; ii < FASTRPC_CTX_MAX; ii++) {
-		if (!chan->ctxtable[ii]) {
-			chan->ctxtable[ii] = ctx;
-			ctx->ctxid = (me->jobid[cid] << 12) | (ii << 4);
-			break;
-		}
-	}
-	spin_unlock_irqrestore(&chan->ctxlock, irq_flags);
-	VERIFY(err, ii < FASTRPC_CTX_MAX);
-	if (err) {
-		pr_err("adsprpc: out of context memory\n");
+	VERIFY(err, 0 == context_assign_ctxid(chan, cid, ctx));
+	if (err)
 		goto bail;
-	}
 	trace_fastrpc_context_alloc((uint64_t)ctx,
 		ctx->ctxid | fl->pd, ctx->handle, ctx->sc);
 	*po = ctx;
@@ -1534,17 +1603,22 @@ static void context_free(struct smq_invoke_ctx *ctx)
 
 	spin_lock(&ctx->fl->hlock);
 	hlist_del_init(&ctx->hn);
+	/* maps and metadata buffer of a registered set outlive the ctx */
+	if (ctx->reg)
+		ctx->reg->busy = 0;
 	spin_unlock(&ctx->fl->hlock);
 
-	mutex_lock(&ctx->fl->map_mutex);
-	for (i = 0; i < nbufs; ++i) {
-		if (ctx->maps[i] && ctx->maps[i]->ctx_refs)
-			ctx->maps[i]->ctx_refs--;
-		fastrpc_mmap_free(ctx->maps[i], 0);
-	}
-	mutex_unlock(&ctx->fl->map_mutex);
+	if (!ctx->reg) {
+		mutex_lock(&ctx->fl->map_mutex);
+		for (i = 0; i < nbufs; ++i) {
+			if (ctx->maps[i] && ctx->maps[i]->ctx_refs)
+				ctx->maps[i]->ctx_refs--;
+			fastrpc_mmap_free(ctx->maps[i], 0);
+		}
+		mutex_unlock(&ctx->fl->map_mutex);
 
-	fastrpc_buf_free(ctx->buf, 1);
+		fastrpc_buf_free(ctx->buf, 1);
+	}
 	kfree(ctx->lrpra);
 	ctx->lrpra = NULL;
 	ctx->magic = 0;
@@ -2331,6 +2405,28 @@ static inline int fastrpc_wait_for_response(struct smq_invoke_ctx *ctx,
 	return interrupted;
 }
 
+static bool fastrpc_spin_for_response(struct smq_invoke_ctx *ctx)
+{
+	struct fastrpc_channel_ctx *chan = &gcinfo[ctx->fl->cid];
+	bool wait_resp = false;
+	uint32_t jj;
+
+	/* disable preempt to avoid context switch latency */
+	preempt_disable();
+	for (jj = 0; jj < ctx->spinTime; jj++) {
+		wait_resp = try_wait_for_completion(&ctx->work);
+		if (wait_resp)
+			break;
+		udelay(1);
+	}
+	preempt_enable_no_resched();
+	if (wait_resp)
+		atomic64_inc(&chan->spin_hit);
+	else
+		atomic64_inc(&chan->spin_miss);
+	return wait_resp;
+}
+
 static void fastrpc_wait_for_completion(struct smq_invoke_ctx *ctx,
 		 int *pInterrupted, uint32_t kernel)
 {
@@ -2395,6 +2491,13 @@ static void fastrpc_wait_for_completion(struct smq_invoke_ctx *ctx,
 
 		case COMPLETE_SIGNAL:
 		case NORMAL_RESPONSE:
+			/* short calls: spin once, then fall back to sleep */
+			if (ctx->spinTime) {
+				wait_resp = fastrpc_spin_for_response(ctx);
+				ctx->spinTime = 0;
+				if (wait_resp)
+					break;
+			}
 			interrupted = fastrpc_wait_for_response(ctx, kernel);
 			*pInterrupted = interrupted;
 			if (interrupted || ctx->isWorkDone)
@@ -2410,6 +2513,54 @@ static void fastrpc_wait_for_completion(struct smq_invoke_ctx *ctx,
 	} while (!ctx->isWorkDone);
 }
 
+static inline struct fastrpc_handle_lat *fastrpc_handle_lat_slot(
+			struct fastrpc_file *fl, uint32_t handle)
+{
+	return &fl->handle_lat[hash_32(handle, FASTRPC_HANDLE_LAT_BITS)];
+}
+
+/*
+ * Wait for an invoke to complete. In adaptive mode, handles whose average
+ * wait fits the spin budget busy wait for up to 1.5x that average before
+ * sleeping; longer ones sleep right away. Every wait is accounted in the
+ * channel histogram and, unless interrupted, in the handle average.
+ */
+static void fastrpc_invoke_wait(struct fastrpc_file *fl,
+		struct smq_invoke_ctx *ctx, int *pInterrupted, uint32_t kernel)
+{
+	struct fastrpc_channel_ctx *chan = &fl->apps->channel[fl->cid];
+	struct fastrpc_handle_lat *lat = fastrpc_handle_lat_slot(fl,
+							ctx->handle);
+	uint32_t avg_us = 0, wait_us;
+	int bucket;
+	u64 start;
+
+	if (fl->adaptive_wait && READ_ONCE(lat->handle) == ctx->handle)
+		avg_us = READ_ONCE(lat->avg_us);
+	if (avg_us && avg_us <= fl->spin_max_us)
+		ctx->spinTime = min(avg_us + avg_us / 2, fl->spin_max_us);
+
+	start = ktime_get_ns();
+	fastrpc_wait_for_completion(ctx, pInterrupted, kernel);
+	wait_us = (uint32_t)min_t(u64, (ktime_get_ns() - start) /
+					NSEC_PER_USEC, U32_MAX);
+
+	bucket = wait_us ? min(fls(wait_us), FASTRPC_WAIT_HIST_BUCKETS - 1) : 0;
+	atomic64_inc(&chan->wait_hist[bucket]);
+
+	if (!fl->adaptive_wait || *pInterrupted)
+		return;
+	/* 1/8 weight moving average, a new handle takes over the slot */
+	if (READ_ONCE(lat->handle) != ctx->handle || !lat->avg_us) {
+		WRITE_ONCE(lat->handle, ctx->handle);
+		WRITE_ONCE(lat->avg_us, wait_us ? wait_us : 1);
+	} else {
+		avg_us = lat->avg_us;
+		WRITE_ONCE(lat->avg_us, max_t(uint32_t, 1,
+				avg_us - avg_us / 8 + wait_us / 8));
+	}
+}
+
 static void fastrpc_update_invoke_count(uint32_t handle, int64_t *perf_counter,
 					struct timespec64 *invoket)
 {
@@ -2507,7 +2658,9 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	if (err)
 		goto bail;
  wait:
-	fastrpc_wait_for_completion(ctx, &interrupted, kernel);
+	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_WAIT),
+	fastrpc_invoke_wait(fl, ctx, &interrupted, kernel);
+	PERF_END);
 	VERIFY(err, 0 == (err = interrupted));
 	if (err)
 		goto bail;
@@ -2549,6 +2702,444 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	return err;
 }
 
+static void fastrpc_reg_args_free(struct fastrpc_file *fl,
+				  struct fastrpc_reg_args *reg)
+{
+	int i;
+
+	mutex_lock(&fl->map_mutex);
+	for (i = 0; i < FASTRPC_REG_ARGS_MAX; i++) {
+		if (!reg->maps[i])
+			continue;
+		if (reg->maps[i]->ctx_refs)
+			reg->maps[i]->ctx_refs--;
+		fastrpc_mmap_free(reg->maps[i], 0);
+	}
+	mutex_unlock(&fl->map_mutex);
+	fastrpc_buf_free(reg->buf, 1);
+	kfree(reg->meta);
+	kfree(reg);
+}
+
+static void fastrpc_reg_args_list_free(struct fastrpc_file *fl)
+{
+	struct fastrpc_reg_args *reg, *free;
+
+	do {
+		struct hlist_node *n;
+
+		free = NULL;
+		spin_lock(&fl->hlock);
+		hlist_for_each_entry_safe(reg, n, &fl->reg_args, hn) {
+			hlist_del_init(&reg->hn);
+			free = reg;
+			break;
+		}
+		spin_unlock(&fl->hlock);
+		if (free)
+			fastrpc_reg_args_free(fl, free);
+	} while (free);
+}
+
+static int fastrpc_internal_register_args(struct fastrpc_file *fl,
+				struct fastrpc_ioctl_register_args *ra)
+{
+	struct fastrpc_reg_args *reg = NULL;
+	struct fastrpc_reg_arg *args = NULL;
+	struct smq_invoke_buf *list;
+	struct smq_phy_page *pages;
+	remote_arg64_t *rpra;
+	uint32_t sc = ra->sc;
+	int nbufs = REMOTE_SCALARS_INBUFS(sc) + REMOTE_SCALARS_OUTBUFS(sc);
+	int i, err = 0;
+
+	VERIFY(err, fl->sctx != NULL);
+	if (err) {
+		err = -EBADR;
+		goto bail;
+	}
+	VERIFY(err, nbufs > 0 && nbufs <= FASTRPC_REG_ARGS_MAX &&
+		!REMOTE_SCALARS_INHANDLES(sc) &&
+		!REMOTE_SCALARS_OUTHANDLES(sc));
+	if (err) {
+		err = -EINVAL;
+		goto bail;
+	}
+	VERIFY(err, NULL != (reg = kzalloc(sizeof(*reg), GFP_KERNEL)));
+	if (err) {
+		err = -ENOMEM;
+		goto bail;
+	}
+	INIT_HLIST_NODE(&reg->hn);
+	reg->sc = sc;
+
+	VERIFY(err, NULL != (args = kcalloc(nbufs, sizeof(*args),
+						GFP_KERNEL)));
+	if (err) {
+		err = -ENOMEM;
+		goto bail;
+	}
+	K_COPY_FROM_USER(err, 0, args, uint64_to_ptr(ra->args),
+				nbufs * sizeof(*args));
+	if (err)
+		goto bail;
+
+	/* metadata is the same layout get_args builds, minus handles */
+	reg->metalen = (size_t)smq_phy_page_start(sc,
+				smq_invoke_buf_start(NULL, sc)) +
+			nbufs * sizeof(*pages) +
+			(sizeof(uint64_t) * M_FDLIST) +
+			(sizeof(uint32_t) * M_CRCLIST) + sizeof(uint32_t);
+	VERIFY(err, NULL != (reg->meta = kzalloc(reg->metalen, GFP_KERNEL)));
+	if (err) {
+		err = -ENOMEM;
+		goto bail;
+	}
+	rpra = reg->meta;
+	list = smq_invoke_buf_start(rpra, sc);
+	pages = smq_phy_page_start(sc, list);
+
+	/* map every buffer once and hold it until the set is unregistered */
+	for (i = 0; i < nbufs; i++) {
+		struct fastrpc_mmap *map = NULL;
+		uint64_t buf = args[i].pv;
+		size_t len = args[i].len;
+		uintptr_t offset = 0;
+
+		VERIFY(err, args[i].fd != -1 && len > 0);
+		if (err) {
+			err = -EINVAL;
+			goto bail;
+		}
+		mutex_lock(&fl->map_mutex);
+		err = fastrpc_mmap_create(fl, args[i].fd, args[i].attrs,
+				(uintptr_t)buf, len, 0, &reg->maps[i]);
+		if (!err && reg->maps[i])
+			reg->maps[i]->ctx_refs++;
+		mutex_unlock(&fl->map_mutex);
+		if (err)
+			goto bail;
+		map = reg->maps[i];
+
+		if (!(map->attr & FASTRPC_ATTR_NOVA)) {
+			struct vm_area_struct *vma;
+
+			down_read(&current->mm->mmap_sem);
+			VERIFY(err, NULL != (vma = find_vma(current->mm,
+							map->va)));
+			if (err) {
+				up_read(&current->mm->mmap_sem);
+				goto bail;
+			}
+			offset = buf_page_start(buf) - vma->vm_start;
+			reg->offs[i] = buf - vma->vm_start;
+			up_read(&current->mm->mmap_sem);
+			VERIFY(err, offset + len <= (uintptr_t)map->size);
+			if (err)
+				goto bail;
+		}
+		reg->lens[i] = len;
+
+		list[i].num = 1;
+		list[i].pgidx = i;
+		pages[i].addr = map->phys + offset;
+		pages[i].size = buf_num_pages(buf, len) << PAGE_SHIFT;
+		rpra[i].buf.pv = buf;
+		rpra[i].buf.len = len;
+	}
+
+	err = fastrpc_buf_alloc(fl, reg->metalen, 0, 0, 0, &reg->buf);
+	if (err)
+		goto bail;
+
+	spin_lock(&fl->hlock);
+	reg->id = ++fl->reg_args_id;
+	hlist_add_head(&reg->hn, &fl->reg_args);
+	spin_unlock(&fl->hlock);
+	ra->regid = reg->id;
+bail:
+	if (err && reg)
+		fastrpc_reg_args_free(fl, reg);
+	kfree(args);
+	return err;
+}
+
+static int fastrpc_internal_unregister_args(struct fastrpc_file *fl,
+					    int regid)
+{
+	struct fastrpc_reg_args *reg = NULL, *iter;
+	int err = 0;
+
+	spin_lock(&fl->hlock);
+	hlist_for_each_entry(iter, &fl->reg_args, hn) {
+		if (iter->id == regid) {
+			reg = iter;
+			break;
+		}
+	}
+	if (reg && reg->busy)
+		err = -EBUSY;
+	else if (reg)
+		hlist_del_init(&reg->hn);
+	spin_unlock(&fl->hlock);
+	VERIFY(err, reg != NULL);
+	if (err) {
+		if (!reg)
+			err = -EINVAL;
+		goto bail;
+	}
+	fastrpc_reg_args_free(fl, reg);
+bail:
+	return err;
+}
+
+/*
+ * Look up a registered set and claim it for this invoke, or pick up the
+ * context this thread left interrupted on it. Returns the set with
+ * *po set to the restored context, if any.
+ */
+static int fastrpc_reg_args_get(struct fastrpc_file *fl, int regid,
+				struct fastrpc_reg_args **preg,
+				struct smq_invoke_ctx **po)
+{
+	struct fastrpc_reg_args *reg = NULL, *iter;
+	struct smq_invoke_ctx *ctx = NULL, *ictx;
+	struct hlist_node *n;
+	int err = 0;
+
+	spin_lock(&fl->hlock);
+	hlist_for_each_entry_safe(ictx, n, &fl->clst.interrupted, hn) {
+		if (ictx->pid == current->pid) {
+			if (!ictx->reg || ictx->reg->id != regid) {
+				err = -1;
+			} else {
+				ctx = ictx;
+				hlist_del_init(&ctx->hn);
+				hlist_add_head(&ctx->hn, &fl->clst.pending);
+			}
+			break;
+		}
+	}
+	if (err || ctx)
+		goto bail;
+	hlist_for_each_entry(iter, &fl->reg_args, hn) {
+		if (iter->id == regid) {
+			reg = iter;
+			break;
+		}
+	}
+	if (!reg)
+		err = -EINVAL;
+	else if (reg->busy)
+		err = -EBUSY;
+	else
+		reg->busy = 1;
+bail:
+	spin_unlock(&fl->hlock);
+	if (ctx) {
+		reg = ctx->reg;
+		*po = ctx;
+	}
+	if (!err)
+		*preg = reg;
+	return err;
+}
+
+static int context_alloc_reg(struct fastrpc_file *fl,
+			     struct fastrpc_reg_args *reg, uint32_t handle,
+			     struct smq_invoke_ctx **po)
+{
+	struct fastrpc_apps *me = &gfa;
+	struct smq_invoke_ctx *ctx = NULL;
+	int err = 0, cid = fl->cid;
+
+	VERIFY(err, NULL != (ctx = kzalloc(sizeof(*ctx), GFP_KERNEL)));
+	if (err)
+		goto bail;
+
+	INIT_HLIST_NODE(&ctx->hn);
+	ctx->fl = fl;
+	ctx->reg = reg;
+	ctx->handle = handle;
+	ctx->sc = reg->sc;
+	ctx->buf = reg->buf;
+	ctx->used = reg->metalen;
+	ctx->rpra = reg->buf->virt;
+	ctx->retval = 0xDECAF;
+	ctx->pid = current->pid;
+	ctx->tgid = fl->tgid;
+	init_completion(&ctx->work);
+	ctx->magic = FASTRPC_CTX_MAGIC;
+	ctx->rspFlags = NORMAL_RESPONSE;
+	ctx->isWorkDone = false;
+
+	/* remote side writes fds, crc and poll words back, start clean */
+	memcpy(reg->buf->virt, reg->meta, reg->metalen);
+
+	spin_lock(&fl->hlock);
+	hlist_add_head(&ctx->hn, &fl->clst.pending);
+	spin_unlock(&fl->hlock);
+
+	VERIFY(err, 0 == context_assign_ctxid(&me->channel[cid], cid, ctx));
+	if (err)
+		goto bail;
+	trace_fastrpc_context_alloc((uint64_t)ctx,
+		ctx->ctxid | fl->pd, ctx->handle, ctx->sc);
+	*po = ctx;
+bail:
+	if (ctx && err)
+		context_free(ctx);
+	return err;
+}
+
+/*
+ * Cache maintenance for a registered set. Before the invoke input buffers
+ * userspace marked dirty are cleaned and output buffers are cleaned and
+ * invalidated so no dirty line gets evicted over what the DSP writes;
+ * afterwards output buffers are invalidated. Skips the same buffers
+ * get_args and inv_args do.
+ */
+static void fastrpc_reg_args_cmo(struct smq_invoke_ctx *ctx, uint64_t dirty,
+				 bool invalidate)
+{
+	struct fastrpc_reg_args *reg = ctx->reg;
+	int inbufs = REMOTE_SCALARS_INBUFS(reg->sc);
+	int nbufs = inbufs + REMOTE_SCALARS_OUTBUFS(reg->sc);
+	int i;
+
+	for (i = 0; i < nbufs; i++) {
+		struct fastrpc_mmap *map = reg->maps[i];
+		bool outbuf = i >= inbufs;
+
+		if (!map || !map->buf || map->uncached)
+			continue;
+		if (outbuf) {
+			if (map->attr & FASTRPC_ATTR_FORCE_NOINVALIDATE)
+				continue;
+		} else {
+			if (invalidate || !(dirty & BIT_ULL(i)))
+				continue;
+			if (map->attr & FASTRPC_ATTR_FORCE_NOFLUSH)
+				continue;
+		}
+		if (ctx->fl->sctx && ctx->fl->sctx->smmu.coherent &&
+			!(map->attr & FASTRPC_ATTR_NON_COHERENT))
+			continue;
+		if (map->attr & FASTRPC_ATTR_COHERENT)
+			continue;
+
+		dma_buf_begin_cpu_access_partial(map->buf, DMA_TO_DEVICE,
+				reg->offs[i], reg->lens[i]);
+		dma_buf_end_cpu_access_partial(map->buf,
+				outbuf ? DMA_FROM_DEVICE : DMA_TO_DEVICE,
+				reg->offs[i], reg->lens[i]);
+	}
+}
+
+static int fastrpc_internal_invoke_reg(struct fastrpc_file *fl,
+				       struct fastrpc_ioctl_invoke_reg *inv)
+{
+	struct smq_invoke_ctx *ctx = NULL;
+	struct fastrpc_reg_args *reg = NULL;
+	int err = 0, interrupted = 0, cid = -1;
+	struct timespec64 invoket = {0};
+	int64_t *perf_counter = NULL;
+
+	cid = fl->cid;
+	VERIFY(err, cid >= ADSP_DOMAIN_ID && cid < NUM_CHANNELS);
+	if (err) {
+		err = -ECHRNG;
+		goto bail;
+	}
+	VERIFY(err, fl->sctx != NULL);
+	if (err) {
+		err = -EBADR;
+		goto bail;
+	}
+	VERIFY(err, inv->handle != FASTRPC_STATIC_HANDLE_PROCESS_GROUP &&
+		inv->handle != FASTRPC_STATIC_HANDLE_DSP_UTILITIES);
+	if (err)
+		goto bail;
+	if (fl->sctx->smmu.faults) {
+		err = FASTRPC_ENOSUCH;
+		goto bail;
+	}
+	if (fl->profile) {
+		perf_counter = getperfcounter(fl, PERF_COUNT);
+		ktime_get_real_ts64(&invoket);
+	}
+
+	err = fastrpc_reg_args_get(fl, inv->regid, &reg, &ctx);
+	if (err)
+		goto bail;
+	if (ctx) {
+		trace_fastrpc_context_restore(cid, (uint64_t)ctx,
+			ctx->msg.invoke.header.ctx, ctx->handle, ctx->sc);
+		goto wait;
+	}
+
+	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_REG_SETUP),
+	err = context_alloc_reg(fl, reg, inv->handle, &ctx);
+	PERF_END);
+	if (err) {
+		spin_lock(&fl->hlock);
+		reg->busy = 0;
+		spin_unlock(&fl->hlock);
+		goto bail;
+	}
+
+	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_FLUSH),
+	fastrpc_reg_args_cmo(ctx, inv->dirty, false);
+	PERF_END);
+
+	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_LINK),
+	VERIFY(err, 0 == fastrpc_invoke_send(ctx, 0, inv->handle));
+	PERF_END);
+	if (err)
+		goto bail;
+ wait:
+	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_WAIT),
+	fastrpc_invoke_wait(fl, ctx, &interrupted, 0);
+	PERF_END);
+	VERIFY(err, 0 == (err = interrupted));
+	if (err)
+		goto bail;
+
+	if (!ctx->isWorkDone) {
+		err = EPROTO;
+		pr_err("Error: adsprpc: %s: %s: WorkDone state is invalid for handle 0x%x, sc 0x%x\n",
+			__func__, current->comm, inv->handle, ctx->sc);
+		goto bail;
+	}
+
+	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_INVARGS),
+	fastrpc_reg_args_cmo(ctx, 0, true);
+	PERF_END);
+
+	VERIFY(err, 0 == (err = ctx->retval));
+ bail:
+	if (ctx && interrupted == -ERESTARTSYS) {
+		trace_fastrpc_context_interrupt(cid, (uint64_t)ctx,
+			ctx->msg.invoke.header.ctx, ctx->handle, ctx->sc);
+		context_save_interrupted(ctx);
+	} else if (ctx) {
+		context_free(ctx);
+	}
+	if (cid >= ADSP_DOMAIN_ID && cid < NUM_CHANNELS &&
+		fl->ssrcount != fl->apps->channel[cid].ssrcount)
+		err = ECONNRESET;
+
+	if (fl->profile && !interrupted) {
+		int64_t *count = GET_COUNTER(perf_counter, PERF_REG_COUNT);
+
+		if (count)
+			*count += 1;
+		fastrpc_update_invoke_count(inv->handle, perf_counter,
+						&invoket);
+	}
+	return err;
+}
+
 static int fastrpc_get_spd_session(char *name, int *session, int *cid)
 {
 	struct fastrpc_apps *me = &gfa;
@@ -3876,6 +4467,7 @@ static int fastrpc_file_free(struct fastrpc_file *fl)
 	if (!IS_ERR_OR_NULL(fl->init_mem))
 		fastrpc_buf_free(fl->init_mem, 0);
 	fastrpc_context_list_dtor(fl);
+	fastrpc_reg_args_list_free(fl);
 	fastrpc_cached_buf_list_free(fl);
 	mutex_lock(&fl->map_mutex);
 	do {
@@ -3986,6 +4578,28 @@ static ssize_t fastrpc_debugfs_read(struct file *filp, char __user *buffer,
 			len += scnprintf(fileinfo + len,
 				DEBUGFS_SIZE - len, "|%-13d\n", sess_used);
 		}
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"\n%s %s %s\n", title, " WAIT HISTOGRAM (us) ", title);
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%-7s", "subsys");
+		for (j = 0; j < FASTRPC_WAIT_HIST_BUCKETS - 1; j++)
+			len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+				"|<%-6u", 1 << j);
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"|>=%-5u|%-9s|%-9s\n", 1 << (j - 1), "spin_hit", "spin_miss");
+		for (i = 0; i < NUM_CHANNELS; i++) {
+			chan = &gcinfo[i];
+			len += scnprintf(fileinfo + len,
+				DEBUGFS_SIZE - len, "%-7s", chan->subsys);
+			for (j = 0; j < FASTRPC_WAIT_HIST_BUCKETS; j++)
+				len += scnprintf(fileinfo + len,
+					DEBUGFS_SIZE - len, "|%-7lld",
+					atomic64_read(&chan->wait_hist[j]));
+			len += scnprintf(fileinfo + len,
+				DEBUGFS_SIZE - len, "|%-9lld|%-9lld\n",
+				atomic64_read(&chan->spin_hit),
+				atomic64_read(&chan->spin_miss));
+		}
 		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
 			"\n%s%s%s\n", "=============",
 			" CMA HEAP ", "==============");
@@ -4267,6 +4881,7 @@ static int fastrpc_device_open(struct inode *inode, struct file *filp)
 	INIT_HLIST_HEAD(&fl->perf);
 	INIT_HLIST_HEAD(&fl->cached_bufs);
 	INIT_HLIST_HEAD(&fl->remote_bufs);
+	INIT_HLIST_HEAD(&fl->reg_args);
 	INIT_HLIST_NODE(&fl->hn);
 	fl->sessionid = 0;
 	fl->apps = me;
@@ -4453,6 +5068,13 @@ static int fastrpc_internal_control(struct fastrpc_file *fl,
 	case FASTRPC_CONTROL_DSPPROCESS_CLEAN:
 		(void)fastrpc_release_current_dsp_process(fl);
 		break;
+	case FASTRPC_CONTROL_ADAPTIVE_WAIT:
+		fl->spin_max_us = cp->aw.spin_max_us ? min_t(uint32_t,
+				cp->aw.spin_max_us,
+				FASTRPC_POLL_TIME_WITHOUT_PREEMPT) :
+				FASTRPC_ADAPTIVE_SPIN_MAX_US;
+		fl->adaptive_wait = cp->aw.enable;
+		break;
 	default:
 		err = -EBADRQC;
 		break;
@@ -4625,6 +5247,9 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 		struct fastrpc_ioctl_perf perf;
 		struct fastrpc_ioctl_control cp;
 		struct fastrpc_ioctl_dsp_capabilities dsp_cap;
+		struct fastrpc_ioctl_register_args reg;
+		struct fastrpc_ioctl_invoke_reg invreg;
+		int32_t regid;
 	} p;
 	union {
 		struct fastrpc_ioctl_mmap mmap;
@@ -4784,6 +5409,36 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 	case FASTRPC_IOCTL_GET_DSP_INFO:
 		err = fastrpc_get_dsp_info(&p.dsp_cap, param, fl);
 		break;
+	case FASTRPC_IOCTL_REGISTER_ARGS:
+		K_COPY_FROM_USER(err, 0, &p.reg, param, sizeof(p.reg));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_internal_register_args(fl,
+							&p.reg)));
+		if (err)
+			goto bail;
+		K_COPY_TO_USER(err, 0, param, &p.reg, sizeof(p.reg));
+		if (err)
+			goto bail;
+		break;
+	case FASTRPC_IOCTL_INVOKE_REG:
+		K_COPY_FROM_USER(err, 0, &p.invreg, param, sizeof(p.invreg));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_internal_invoke_reg(fl,
+							&p.invreg)));
+		if (err)
+			goto bail;
+		break;
+	case FASTRPC_IOCTL_UNREGISTER_ARGS:
+		K_COPY_FROM_USER(err, 0, &p.regid, param, sizeof(p.regid));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_internal_unregister_args(fl,
+							p.regid)));
+		if (err)
+			goto bail;
+		break;
 	default:
 		err = -ENOTTY;
 		break;
@@ -138,6 +138,12 @@ struct compat_fastrpc_ctrl_pm {
 	compat_uint_t timeout;	/* timeout(in ms) for PM to keep system awake*/
 };
 
+#define FASTRPC_CONTROL_ADAPTIVE_WAIT	(7)
+struct compat_fastrpc_ctrl_adaptive_wait {
+	compat_uint_t enable;	/* adaptive completion wait enable */
+	compat_uint_t spin_max_us;	/* longest spin in us */
+};
+
 struct compat_fastrpc_ioctl_control {
 	compat_uint_t req;
 	union {
@@ -145,6 +151,7 @@ struct compat_fastrpc_ioctl_control {
 		struct compat_fastrpc_ctrl_kalloc kalloc;
 		struct compat_fastrpc_ctrl_wakelock wp;
 		struct compat_fastrpc_ctrl_pm pm;
+		struct compat_fastrpc_ctrl_adaptive_wait aw;
 	};
 };
 
@@ -348,6 +355,11 @@ static int compat_get_fastrpc_ioctl_control(
 	} else if (p == FASTRPC_CONTROL_PM) {
 		err |= get_user(p, &ctrl32->pm.timeout);
 		err |= put_user(p, &ctrl->pm.timeout);
+	} else if (p == FASTRPC_CONTROL_ADAPTIVE_WAIT) {
+		err |= get_user(p, &ctrl32->aw.enable);
+		err |= put_user(p, &ctrl->aw.enable);
+		err |= get_user(p, &ctrl32->aw.spin_max_us);
+		err |= put_user(p, &ctrl->aw.spin_max_us);
 	}
 
 	return err;
@@ -656,6 +668,12 @@ long compat_fastrpc_device_ioctl(struct file *filp, unsigned int cmd,
 	}
 	case FASTRPC_IOCTL_SETMODE:
 		return fastrpc_setmode(filp, cmd, arg);
+	case FASTRPC_IOCTL_REGISTER_ARGS:
+	case FASTRPC_IOCTL_INVOKE_REG:
+	case FASTRPC_IOCTL_UNREGISTER_ARGS:
+		/* fixed width layouts, same for 32-bit callers */
+		return filp->f_op->unlocked_ioctl(filp, cmd,
+					(unsigned long)compat_ptr(arg));
 	case COMPAT_FASTRPC_IOCTL_CONTROL:
 	{
 		return compat_fastrpc_control(filp, arg);
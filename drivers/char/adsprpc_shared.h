@@ -25,6 +25,11 @@
 #define FASTRPC_IOCTL_MUNMAP_FD _IOWR('R', 13, struct fastrpc_ioctl_munmap_fd)
 #define FASTRPC_IOCTL_GET_DSP_INFO \
 			_IOWR('R', 16, struct fastrpc_ioctl_dsp_capabilities)
+#define FASTRPC_IOCTL_REGISTER_ARGS \
+			_IOWR('R', 17, struct fastrpc_ioctl_register_args)
+#define FASTRPC_IOCTL_INVOKE_REG \
+			_IOWR('R', 18, struct fastrpc_ioctl_invoke_reg)
+#define FASTRPC_IOCTL_UNREGISTER_ARGS _IOWR('R', 19, int32_t)
 
 #define FASTRPC_GLINK_GUID "fastrpcglink-apps-dsp"
 #define FASTRPC_SMD_GUID "fastrpcsmd-apps-dsp"
@@ -189,6 +194,32 @@ struct fastrpc_ioctl_invoke_crc {
 	unsigned int *crc;
 };
 
+/* Maximum buffers in a registered argument set, one dirty bit each */
+#define FASTRPC_REG_ARGS_MAX	(64)
+
+/*
+ * Argument region registered once and reused by FASTRPC_IOCTL_INVOKE_REG.
+ * Fixed width so 32-bit callers share the 64-bit layout.
+ */
+struct fastrpc_reg_arg {
+	uint64_t pv;		/* buffer pointer */
+	uint64_t len;		/* length of buffer */
+	int32_t fd;		/* ION fd backing the buffer */
+	uint32_t attrs;		/* FASTRPC_ATTR_* flags */
+};
+
+struct fastrpc_ioctl_register_args {
+	uint32_t sc;		/* scalars, buffers only */
+	int32_t regid;		/* returned id of the argument set */
+	uint64_t args;		/* pointer to struct fastrpc_reg_arg list */
+};
+
+struct fastrpc_ioctl_invoke_reg {
+	uint32_t handle;	/* remote handle */
+	int32_t regid;		/* registered argument set */
+	uint64_t dirty;		/* bit i set if CPU wrote buffer i */
+};
+
 struct fastrpc_ioctl_init {
 	uint32_t flags;		/* one of FASTRPC_INIT_* macros */
 	uintptr_t file;		/* pointer to elf file */
@@ -252,6 +283,8 @@ enum fastrpc_control_type {
 	FASTRPC_CONTROL_PM		=	5,
 /* Clean process on DSP */
 	FASTRPC_CONTROL_DSPPROCESS_CLEAN	=	6,
+/* Spin or sleep on completion based on learned handle latency */
+	FASTRPC_CONTROL_ADAPTIVE_WAIT	=	7,
 };
 
 struct fastrpc_ctrl_latency {
@@ -271,6 +304,11 @@ struct fastrpc_ctrl_pm {
 	uint32_t timeout;	/* timeout(in ms) for PM to keep system awake*/
 };
 
+struct fastrpc_ctrl_adaptive_wait {
+	uint32_t enable;	/* adaptive completion wait enable */
+	uint32_t spin_max_us;	/* longest spin in us, 0 for default */
+};
+
 struct fastrpc_ioctl_control {
 	uint32_t req;
 	union {
@@ -278,6 +316,7 @@ struct fastrpc_ioctl_control {
 		struct fastrpc_ctrl_kalloc kalloc;
 		struct fastrpc_ctrl_wakelock wp;
 		struct fastrpc_ctrl_pm pm;
+		struct fastrpc_ctrl_adaptive_wait aw;
 	};
 };
 
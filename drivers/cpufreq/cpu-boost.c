@@ -8,12 +8,15 @@
 #include <linux/kernel.h>
 #include <linux/init.h>
 #include <linux/cpufreq.h>
+#include <linux/cpu_boost.h>
 #include <linux/cpu.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/input.h>
 #include <linux/time.h>
 #include <linux/sysfs.h>
+#include <linux/mutex.h>
+#include <linux/atomic.h>
 
 #define cpu_boost_attr_rw(_name)		\
 static struct kobj_attribute _name##_attr =	\
@@ -36,10 +39,14 @@ const char *buf, size_t count)					\
 	return count;						\
 }
 
+#define FRAME_BOOST_CURVE_LEN 4
+
 struct cpu_sync {
 	int cpu;
 	unsigned int input_boost_min;
 	unsigned int input_boost_freq;
+	unsigned int frame_boost_curve[FRAME_BOOST_CURVE_LEN];
+	unsigned int frame_boost_curve_len;
 };
 
 static DEFINE_PER_CPU(struct cpu_sync, sync_info);
@@ -65,6 +72,42 @@ static struct delayed_work input_boost_rem;
 static u64 last_input_time;
 #define MIN_INPUT_INTERVAL (150 * USEC_PER_MSEC)
 
+/*
+ * In frame mode the input boost is not dropped after input_boost_ms but on
+ * the first frame committed by the display once input has been quiet for
+ * frame_boost_debounce_ms, or when the debounce expires if a frame was
+ * already committed since the last input. frame_boost_max_ms bounds the
+ * boost in case the display never commits a frame.
+ */
+static unsigned int frame_boost;
+show_one(frame_boost);
+store_one(frame_boost);
+cpu_boost_attr_rw(frame_boost);
+
+static unsigned int frame_boost_debounce_ms = 100;
+show_one(frame_boost_debounce_ms);
+store_one(frame_boost_debounce_ms);
+cpu_boost_attr_rw(frame_boost_debounce_ms);
+
+static unsigned int frame_boost_max_ms = 1000;
+show_one(frame_boost_max_ms);
+store_one(frame_boost_max_ms);
+cpu_boost_attr_rw(frame_boost_max_ms);
+
+static DEFINE_MUTEX(boost_lock);
+static struct work_struct frame_boost_work;
+static struct delayed_work frame_boost_quiet;
+static bool input_boost_active;
+static bool frame_since_input;
+static unsigned int boost_frames;
+static u64 boost_start_time;
+static u64 last_event_time;
+
+static atomic64_t stat_boosts;
+static atomic64_t stat_boosted_us;
+static atomic64_t stat_frames;
+static atomic64_t stat_timeouts;
+
 static ssize_t store_input_boost_freq(struct kobject *kobj,
 				      struct kobj_attribute *attr,
 				      const char *buf, size_t count)
@@ -131,6 +174,96 @@ static ssize_t show_input_boost_freq(struct kobject *kobj,
 
 cpu_boost_attr_rw(input_boost_freq);
 
+static ssize_t store_frame_boost_curve(struct kobject *kobj,
+				       struct kobj_attribute *attr,
+				       const char *buf, size_t count)
+{
+	unsigned int curve[FRAME_BOOST_CURVE_LEN];
+	unsigned int cpu, val, n;
+	char *str, *orig, *tok, *freqs, *f;
+	struct cpu_sync *s;
+	int ret = count;
+
+	orig = str = kstrndup(buf, count, GFP_KERNEL);
+	if (!str)
+		return -ENOMEM;
+
+	/* cpu:freq0,freq1,... pairs, one curve step per committed frame */
+	while ((tok = strsep(&str, " \n"))) {
+		if (!*tok)
+			continue;
+
+		freqs = strchr(tok, ':');
+		if (!freqs) {
+			ret = -EINVAL;
+			break;
+		}
+		*freqs++ = '\0';
+
+		if (kstrtouint(tok, 10, &cpu) || cpu >= num_possible_cpus()) {
+			ret = -EINVAL;
+			break;
+		}
+
+		n = 0;
+		while ((f = strsep(&freqs, ",")) && n < FRAME_BOOST_CURVE_LEN) {
+			if (kstrtouint(f, 10, &val)) {
+				ret = -EINVAL;
+				goto out;
+			}
+			curve[n++] = val;
+		}
+
+		/* a single 0 clears the curve */
+		if (n == 1 && !curve[0])
+			n = 0;
+
+		s = &per_cpu(sync_info, cpu);
+		memcpy(s->frame_boost_curve, curve, n * sizeof(curve[0]));
+		s->frame_boost_curve_len = n;
+	}
+
+out:
+	kfree(orig);
+	return ret;
+}
+
+static ssize_t show_frame_boost_curve(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	int cnt = 0, cpu, i;
+	struct cpu_sync *s;
+
+	for_each_possible_cpu(cpu) {
+		s = &per_cpu(sync_info, cpu);
+		if (!s->frame_boost_curve_len)
+			continue;
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%d:", cpu);
+		for (i = 0; i < s->frame_boost_curve_len; i++)
+			cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%s%u",
+					i ? "," : "", s->frame_boost_curve[i]);
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, " ");
+	}
+	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+	return cnt;
+}
+
+cpu_boost_attr_rw(frame_boost_curve);
+
+static ssize_t show_frame_boost_stats(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE,
+			 "boosts: %lld\nboosted_ms: %lld\nframes: %lld\ntimeouts: %lld\n",
+			 atomic64_read(&stat_boosts),
+			 div_s64(atomic64_read(&stat_boosted_us), USEC_PER_MSEC),
+			 atomic64_read(&stat_frames),
+			 atomic64_read(&stat_timeouts));
+}
+
+static struct kobj_attribute frame_boost_stats_attr =
+__ATTR(frame_boost_stats, 0444, show_frame_boost_stats, NULL);
+
 /*
  * The CPUFREQ_ADJUST notifier is used to override the current policy min to
  * make sure policy min >= boost_min. The cpufreq framework then does the job
@@ -180,11 +313,21 @@ static void update_policy_online(void)
 	put_online_cpus();
 }
 
-static void do_input_boost_rem(struct work_struct *work)
+static unsigned int frame_boost_freq(struct cpu_sync *s, unsigned int frame)
+{
+	if (!frame_boost || !s->frame_boost_curve_len)
+		return s->input_boost_freq;
+
+	return s->frame_boost_curve[min(frame, s->frame_boost_curve_len - 1)];
+}
+
+static void input_boost_end(bool timeout)
 {
 	unsigned int i, ret;
 	struct cpu_sync *i_sync_info;
 
+	mutex_lock(&boost_lock);
+
 	/* Reset the input_boost_min for all CPUs in the system */
 	pr_debug("Resetting input boost min for all CPUs\n");
 	for_each_possible_cpu(i) {
@@ -201,6 +344,21 @@ static void do_input_boost_rem(struct work_struct *work)
 			pr_err("cpu-boost: sched boost disable failed\n");
 		sched_boost_active = false;
 	}
+
+	if (input_boost_active) {
+		atomic64_add(ktime_to_us(ktime_get()) - boost_start_time,
+			     &stat_boosted_us);
+		if (timeout)
+			atomic64_inc(&stat_timeouts);
+		WRITE_ONCE(input_boost_active, false);
+	}
+
+	mutex_unlock(&boost_lock);
+}
+
+static void do_input_boost_rem(struct work_struct *work)
+{
+	input_boost_end(frame_boost);
 }
 
 static void do_input_boost(struct work_struct *work)
@@ -209,6 +367,8 @@ static void do_input_boost(struct work_struct *work)
 	struct cpu_sync *i_sync_info;
 
 	cancel_delayed_work_sync(&input_boost_rem);
+
+	mutex_lock(&boost_lock);
 	if (sched_boost_active) {
 		sched_set_boost(0);
 		sched_boost_active = false;
@@ -218,7 +378,7 @@ static void do_input_boost(struct work_struct *work)
 	pr_debug("Setting input boost min for all CPUs\n");
 	for_each_possible_cpu(i) {
 		i_sync_info = &per_cpu(sync_info, i);
-		i_sync_info->input_boost_min = i_sync_info->input_boost_freq;
+		i_sync_info->input_boost_min = frame_boost_freq(i_sync_info, 0);
 	}
 
 	/* Update policies for all online CPUs */
@@ -233,10 +393,96 @@ static void do_input_boost(struct work_struct *work)
 			sched_boost_active = true;
 	}
 
+	if (!input_boost_active) {
+		boost_start_time = ktime_to_us(ktime_get());
+		atomic64_inc(&stat_boosts);
+		WRITE_ONCE(input_boost_active, true);
+	}
+	boost_frames = 0;
+	mutex_unlock(&boost_lock);
+
 	queue_delayed_work(cpu_boost_wq, &input_boost_rem,
-					msecs_to_jiffies(input_boost_ms));
+		msecs_to_jiffies(frame_boost ? frame_boost_max_ms :
+					       input_boost_ms));
 }
 
+static void do_frame_boost(struct work_struct *work)
+{
+	unsigned int i, freq;
+	struct cpu_sync *i_sync_info;
+	bool changed = false;
+	u64 debounce = frame_boost_debounce_ms * USEC_PER_MSEC;
+	u64 last = READ_ONCE(last_event_time);
+	u64 now = ktime_to_us(ktime_get());
+	u64 quiet = now > last ? now - last : 0;
+
+	/* Input went quiet and a frame made it out, the boost did its job */
+	if (quiet >= debounce) {
+		cancel_delayed_work_sync(&input_boost_rem);
+		input_boost_end(false);
+		return;
+	}
+
+	/* Still scrolling, walk down the per-cluster boost curve */
+	mutex_lock(&boost_lock);
+	if (!input_boost_active) {
+		mutex_unlock(&boost_lock);
+		return;
+	}
+
+	/*
+	 * The display may go static after this frame, so end the boost once
+	 * input stays quiet even if no further frame shows up.
+	 */
+	WRITE_ONCE(frame_since_input, true);
+	mod_delayed_work(cpu_boost_wq, &frame_boost_quiet,
+			 usecs_to_jiffies(debounce - quiet) + 1);
+
+	boost_frames++;
+	for_each_possible_cpu(i) {
+		i_sync_info = &per_cpu(sync_info, i);
+		freq = frame_boost_freq(i_sync_info, boost_frames);
+		if (i_sync_info->input_boost_min != freq) {
+			i_sync_info->input_boost_min = freq;
+			changed = true;
+		}
+	}
+
+	if (changed)
+		update_policy_online();
+	mutex_unlock(&boost_lock);
+}
+
+static void do_frame_boost_quiet(struct work_struct *work)
+{
+	u64 last = READ_ONCE(last_event_time);
+	u64 now = ktime_to_us(ktime_get());
+
+	/* New input since the last frame, wait for the next frame instead */
+	if (!READ_ONCE(frame_since_input) || now < last ||
+	    now - last < frame_boost_debounce_ms * USEC_PER_MSEC)
+		return;
+
+	cancel_delayed_work_sync(&input_boost_rem);
+	input_boost_end(false);
+}
+
+/**
+ * cpu_boost_frame_committed - notify cpu-boost that a frame was committed
+ *
+ * Called by the display driver when a frame has been committed to the
+ * panel. In frame mode this ends or steps down an active input boost.
+ */
+void cpu_boost_frame_committed(void)
+{
+	if (!frame_boost || !READ_ONCE(input_boost_active))
+		return;
+
+	atomic64_inc(&stat_frames);
+	queue_work(cpu_boost_wq, &frame_boost_work);
+}
+EXPORT_SYMBOL(cpu_boost_frame_committed);
+
 static void cpuboost_input_event(struct input_handle *handle,
 		unsigned int type, unsigned int code, int value)
 {
@@ -246,6 +492,18 @@ static void cpuboost_input_event(struct input_handle *handle,
 		return;
 
 	now = ktime_to_us(ktime_get());
+
+	/*
+	 * A continuous gesture only keeps an active frame boost alive, the
+	 * boost is not re-applied for every event.
+	 */
+	if (frame_boost) {
+		WRITE_ONCE(last_event_time, now);
+		WRITE_ONCE(frame_since_input, false);
+		if (READ_ONCE(input_boost_active))
+			return;
+	}
+
 	if (now - last_input_time < MIN_INPUT_INTERVAL)
 		return;
 
@@ -339,6 +597,8 @@ static int cpu_boost_init(void)
 
 	INIT_WORK(&input_boost_work, do_input_boost);
 	INIT_DELAYED_WORK(&input_boost_rem, do_input_boost_rem);
+	INIT_WORK(&frame_boost_work, do_frame_boost);
+	INIT_DELAYED_WORK(&frame_boost_quiet, do_frame_boost_quiet);
 
 	for_each_possible_cpu(cpu) {
 		s = &per_cpu(sync_info, cpu);
@@ -364,6 +624,28 @@ static int cpu_boost_init(void)
 	if (ret)
 		pr_err("Failed to create sched_boost_on_input node: %d\n", ret);
 
+	ret = sysfs_create_file(cpu_boost_kobj, &frame_boost_attr.attr);
+	if (ret)
+		pr_err("Failed to create frame_boost node: %d\n", ret);
+
+	ret = sysfs_create_file(cpu_boost_kobj,
+				&frame_boost_debounce_ms_attr.attr);
+	if (ret)
+		pr_err("Failed to create frame_boost_debounce_ms node: %d\n",
+		       ret);
+
+	ret = sysfs_create_file(cpu_boost_kobj, &frame_boost_max_ms_attr.attr);
+	if (ret)
+		pr_err("Failed to create frame_boost_max_ms node: %d\n", ret);
+
+	ret = sysfs_create_file(cpu_boost_kobj, &frame_boost_curve_attr.attr);
+	if (ret)
+		pr_err("Failed to create frame_boost_curve node: %d\n", ret);
+
+	ret = sysfs_create_file(cpu_boost_kobj, &frame_boost_stats_attr.attr);
+	if (ret)
+		pr_err("Failed to create frame_boost_stats node: %d\n", ret);
+
 	ret = input_register_handler(&cpuboost_input_handler);
 	return 0;
 }
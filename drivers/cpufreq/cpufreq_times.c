@@ -18,6 +18,7 @@
 #include <linux/hashtable.h>
 #include <linux/init.h>
 #include <linux/jiffies.h>
+#include <linux/percpu.h>
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
@@ -29,7 +30,6 @@
 
 static DECLARE_HASHTABLE(uid_hash_table, UID_HASH_BITS);
 
-static DEFINE_SPINLOCK(task_time_in_state_lock); /* task->time_in_state */
 static DEFINE_SPINLOCK(uid_lock); /* uid_hash_table */
 
 struct concurrent_times {
@@ -64,6 +64,43 @@ static struct cpu_freqs *all_freqs[NR_CPUS];
 
 static unsigned int next_offset;
 
+#define UID_PENDING_SLOTS 8
+#define UID_PENDING_NO_POLICY UINT_MAX
+
+/**
+ * struct uid_pending_slot - cputime not yet folded into a uid_entry
+ * @uid: uid the time was charged to
+ * @state: index into uid_entry->time_in_state
+ * @time: time spent in @state
+ * @active: concurrent active times, indexed like concurrent_times->active
+ * @policy: concurrent policy times, indexed like concurrent_times->policy
+ */
+struct uid_pending_slot {
+	uid_t uid;
+	unsigned int state;
+	u64 time;
+	u64 active[NR_CPUS];
+	u64 policy[NR_CPUS];
+};
+
+/**
+ * struct uid_pending - per-cpu accumulation of per-uid cputime
+ * @lock: only contended when a reader folds the buffer remotely
+ * @nr: number of slots in use
+ * @slots: pending per-uid times
+ *
+ * The tick path charges time here instead of taking uid_lock and walking
+ * uid_hash_table. The slots are folded into the global table when they
+ * run out or when a reader opens one of the uid time files.
+ */
+struct uid_pending {
+	spinlock_t lock;
+	unsigned int nr;
+	struct uid_pending_slot slots[UID_PENDING_SLOTS];
+};
+
+static DEFINE_PER_CPU(struct uid_pending, uid_pending);
+
 
 /* Caller must hold rcu_read_lock() */
 static struct uid_entry *find_uid_entry_rcu(uid_t uid)
@@ -137,6 +174,52 @@ static struct uid_entry *find_or_register_uid_locked(uid_t uid)
 	return uid_entry;
 }
 
+/* Caller must hold pending->lock */
+static void uid_pending_fold_locked(struct uid_pending *pending)
+{
+	struct uid_pending_slot *slot;
+	struct uid_entry *uid_entry;
+	unsigned int i, j;
+
+	if (!pending->nr)
+		return;
+
+	spin_lock(&uid_lock);
+	for (i = 0; i < pending->nr; i++) {
+		slot = &pending->slots[i];
+		uid_entry = find_or_register_uid_locked(slot->uid);
+		if (!uid_entry)
+			continue;
+		if (slot->state < uid_entry->max_state)
+			uid_entry->time_in_state[slot->state] += slot->time;
+		for (j = 0; j < NR_CPUS; j++) {
+			if (slot->active[j])
+				atomic64_add(slot->active[j],
+				    &uid_entry->concurrent_times->active[j]);
+			if (slot->policy[j])
+				atomic64_add(slot->policy[j],
+				    &uid_entry->concurrent_times->policy[j]);
+		}
+	}
+	spin_unlock(&uid_lock);
+
+	pending->nr = 0;
+}
+
+static void uid_pending_fold_all(void)
+{
+	struct uid_pending *pending;
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		pending = &per_cpu(uid_pending, cpu);
+		spin_lock_irqsave(&pending->lock, flags);
+		uid_pending_fold_locked(pending);
+		spin_unlock_irqrestore(&pending->lock, flags);
+	}
+}
+
 static int single_uid_time_in_state_show(struct seq_file *m, void *ptr)
 {
 	struct uid_entry *uid_entry;
@@ -306,13 +389,75 @@ static int concurrent_policy_time_seq_show(struct seq_file *m, void *v)
 	return concurrent_time_seq_show(m, v, get_policy_times);
 }
 
-void cpufreq_task_times_init(struct task_struct *p)
+/*
+ * Binary layout of uid_time_in_state_bin: for every uid, a u32 uid and a
+ * u32 count followed by count u64 times in clock_t, in the same state order
+ * as the header line of uid_time_in_state.
+ */
+static int uid_time_in_state_bin_seq_show(struct seq_file *m, void *v)
 {
-	unsigned long flags;
+	struct uid_entry *uid_entry;
+	u32 hdr[2];
+	int i;
+
+	rcu_read_lock();
+
+	hlist_for_each_entry_rcu(uid_entry, (struct hlist_head *)v, hash) {
+		if (!uid_entry->max_state)
+			continue;
+		hdr[0] = uid_entry->uid;
+		hdr[1] = uid_entry->max_state;
+		seq_write(m, hdr, sizeof(hdr));
+		for (i = 0; i < uid_entry->max_state; ++i) {
+			u64 time = nsec_to_clock_t(uid_entry->time_in_state[i]);
+
+			seq_write(m, &time, sizeof(time));
+		}
+	}
+
+	rcu_read_unlock();
+	return 0;
+}
+
+/*
+ * Binary layout of uid_concurrent_active_time_bin: a u32 cpu count, then
+ * for every uid a u32 uid followed by one u64 time in clock_t per cpu.
+ */
+static int concurrent_active_time_bin_seq_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *uid_entry;
+	int i, num_possible_cpus = num_possible_cpus();
+
+	if (v == uid_hash_table) {
+		u32 cpus = num_possible_cpus;
+
+		seq_write(m, &cpus, sizeof(cpus));
+	}
+
+	rcu_read_lock();
+
+	hlist_for_each_entry_rcu(uid_entry, (struct hlist_head *)v, hash) {
+		atomic64_t *times = uid_entry->concurrent_times->active;
+		u32 uid = uid_entry->uid;
+
+		seq_write(m, &uid, sizeof(uid));
+		for (i = 0; i < num_possible_cpus; ++i) {
+			u64 time = nsec_to_clock_t(atomic64_read(&times[i]));
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+			seq_write(m, &time, sizeof(time));
+		}
+	}
+
+	rcu_read_unlock();
+
+	return 0;
+}
+
+void cpufreq_task_times_init(struct task_struct *p)
+{
+	/* p is not visible to anyone yet, its lock was copied from current */
+	spin_lock_init(&p->time_in_state_lock);
 	p->time_in_state = NULL;
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
 	p->max_state = 0;
 }
 
@@ -327,13 +472,13 @@ void cpufreq_task_times_alloc(struct task_struct *p)
 	if (!temp)
 		return;
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	spin_lock_irqsave(&p->time_in_state_lock, flags);
 	p->time_in_state = temp;
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
 	p->max_state = max_state;
+	spin_unlock_irqrestore(&p->time_in_state_lock, flags);
 }
 
-/* Caller must hold task_time_in_state_lock */
+/* Caller must hold p->time_in_state_lock */
 static int cpufreq_task_times_realloc_locked(struct task_struct *p)
 {
 	void *temp;
@@ -357,10 +502,10 @@ void cpufreq_task_times_exit(struct task_struct *p)
 	if (!p->time_in_state)
 		return;
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	spin_lock_irqsave(&p->time_in_state_lock, flags);
 	temp = p->time_in_state;
 	p->time_in_state = NULL;
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+	spin_unlock_irqrestore(&p->time_in_state_lock, flags);
 	kfree(temp);
 }
 
@@ -373,7 +518,7 @@ int proc_time_in_state_show(struct seq_file *m, struct pid_namespace *ns,
 	struct cpu_freqs *freqs;
 	struct cpu_freqs *last_freqs = NULL;
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	spin_lock_irqsave(&p->time_in_state_lock, flags);
 	for_each_possible_cpu(cpu) {
 		freqs = all_freqs[cpu];
 		if (!freqs || freqs == last_freqs)
@@ -390,7 +535,7 @@ int proc_time_in_state_show(struct seq_file *m, struct pid_namespace *ns,
 				   (unsigned long)nsec_to_clock_t(cputime));
 		}
 	}
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+	spin_unlock_irqrestore(&p->time_in_state_lock, flags);
 	return 0;
 }
 
@@ -400,11 +545,13 @@ void cpufreq_acct_update_power(struct task_struct *p, u64 cputime)
 	unsigned int state;
 	unsigned int active_cpu_cnt = 0;
 	unsigned int policy_cpu_cnt = 0;
-	unsigned int policy_first_cpu;
-	struct uid_entry *uid_entry;
+	unsigned int policy_idx = UID_PENDING_NO_POLICY;
+	struct uid_pending *pending;
+	struct uid_pending_slot *slot = NULL;
 	struct cpu_freqs *freqs = all_freqs[task_cpu(p)];
 	struct cpufreq_policy *policy;
 	uid_t uid = from_kuid_munged(current_user_ns(), task_uid(p));
+	unsigned int i;
 	int cpu = 0;
 
 	if (!freqs || is_idle_task(p) || p->flags & PF_EXITING)
@@ -412,53 +559,58 @@ void cpufreq_acct_update_power(struct task_struct *p, u64 cputime)
 
 	state = freqs->offset + READ_ONCE(freqs->last_index);
 
-	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	spin_lock_irqsave(&p->time_in_state_lock, flags);
 	if ((state < p->max_state || !cpufreq_task_times_realloc_locked(p)) &&
 	    p->time_in_state)
 		p->time_in_state[state] += cputime;
-	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
-
-	spin_lock_irqsave(&uid_lock, flags);
-	uid_entry = find_or_register_uid_locked(uid);
-	if (uid_entry && state < uid_entry->max_state)
-		uid_entry->time_in_state[state] += cputime;
-	spin_unlock_irqrestore(&uid_lock, flags);
-
-	rcu_read_lock();
-	uid_entry = find_uid_entry_rcu(uid);
-	if (!uid_entry) {
-		rcu_read_unlock();
-		return;
-	}
+	spin_unlock_irqrestore(&p->time_in_state_lock, flags);
 
 	for_each_possible_cpu(cpu)
 		if (!idle_cpu(cpu))
 			++active_cpu_cnt;
 
-	atomic64_add(cputime,
-		     &uid_entry->concurrent_times->active[active_cpu_cnt - 1]);
-
+	/*
+	 * This CPU may have just come up and not have a cpufreq policy
+	 * yet, in which case only the concurrent active time is charged.
+	 */
 	policy = cpufreq_cpu_get(task_cpu(p));
-	if (!policy) {
-		/*
-		 * This CPU may have just come up and not have a cpufreq policy
-		 * yet.
-		 */
-		rcu_read_unlock();
-		return;
+	if (policy) {
+		for_each_cpu(cpu, policy->related_cpus)
+			if (!idle_cpu(cpu))
+				++policy_cpu_cnt;
+
+		policy_idx = cpumask_first(policy->related_cpus) +
+			     policy_cpu_cnt - 1;
+		cpufreq_cpu_put(policy);
 	}
 
-	for_each_cpu(cpu, policy->related_cpus)
-		if (!idle_cpu(cpu))
-			++policy_cpu_cnt;
+	pending = this_cpu_ptr(&uid_pending);
+	spin_lock_irqsave(&pending->lock, flags);
+
+	for (i = 0; i < pending->nr; i++) {
+		if (pending->slots[i].uid == uid &&
+		    pending->slots[i].state == state) {
+			slot = &pending->slots[i];
+			break;
+		}
+	}
 
-	policy_first_cpu = cpumask_first(policy->related_cpus);
-	cpufreq_cpu_put(policy);
+	if (!slot) {
+		if (pending->nr == UID_PENDING_SLOTS)
+			uid_pending_fold_locked(pending);
+		slot = &pending->slots[pending->nr++];
+		memset(slot, 0, sizeof(*slot));
+		slot->uid = uid;
+		slot->state = state;
+	}
 
-	atomic64_add(cputime,
-		     &uid_entry->concurrent_times->policy[policy_first_cpu +
-							  policy_cpu_cnt - 1]);
-	rcu_read_unlock();
+	slot->time += cputime;
+	if (active_cpu_cnt)
+		slot->active[active_cpu_cnt - 1] += cputime;
+	if (policy_idx < NR_CPUS)
+		slot->policy[policy_idx] += cputime;
+
+	spin_unlock_irqrestore(&pending->lock, flags);
 }
 
 static int cpufreq_times_get_index(struct cpu_freqs *freqs, unsigned int freq)
@@ -525,6 +677,9 @@ void cpufreq_task_times_remove_uids(uid_t uid_start, uid_t uid_end)
 	unsigned long flags;
 	u64 uid;
 
+	/* Don't let pending time re-register the uids removed below */
+	uid_pending_fold_all();
+
 	spin_lock_irqsave(&uid_lock, flags);
 
 	for (uid = uid_start; uid <= uid_end; uid++) {
@@ -562,11 +717,13 @@ static const struct seq_operations uid_time_in_state_seq_ops = {
 
 static int uid_time_in_state_open(struct inode *inode, struct file *file)
 {
+	uid_pending_fold_all();
 	return seq_open(file, &uid_time_in_state_seq_ops);
 }
 
 int single_uid_time_in_state_open(struct inode *inode, struct file *file)
 {
+	uid_pending_fold_all();
 	return single_open(file, single_uid_time_in_state_show,
 			&(inode->i_uid));
 }
@@ -578,6 +735,26 @@ static const struct file_operations uid_time_in_state_fops = {
 	.release	= seq_release,
 };
 
+static const struct seq_operations uid_time_in_state_bin_seq_ops = {
+	.start = uid_seq_start,
+	.next = uid_seq_next,
+	.stop = uid_seq_stop,
+	.show = uid_time_in_state_bin_seq_show,
+};
+
+static int uid_time_in_state_bin_open(struct inode *inode, struct file *file)
+{
+	uid_pending_fold_all();
+	return seq_open(file, &uid_time_in_state_bin_seq_ops);
+}
+
+static const struct file_operations uid_time_in_state_bin_fops = {
+	.open		= uid_time_in_state_bin_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
 static const struct seq_operations concurrent_active_time_seq_ops = {
 	.start = uid_seq_start,
 	.next = uid_seq_next,
@@ -587,6 +764,7 @@ static const struct seq_operations concurrent_active_time_seq_ops = {
 
 static int concurrent_active_time_open(struct inode *inode, struct file *file)
 {
+	uid_pending_fold_all();
 	return seq_open(file, &concurrent_active_time_seq_ops);
 }
 
@@ -597,6 +775,27 @@ static const struct file_operations concurrent_active_time_fops = {
 	.release	= seq_release,
 };
 
+static const struct seq_operations concurrent_active_time_bin_seq_ops = {
+	.start = uid_seq_start,
+	.next = uid_seq_next,
+	.stop = uid_seq_stop,
+	.show = concurrent_active_time_bin_seq_show,
+};
+
+static int concurrent_active_time_bin_open(struct inode *inode,
+					   struct file *file)
+{
+	uid_pending_fold_all();
+	return seq_open(file, &concurrent_active_time_bin_seq_ops);
+}
+
+static const struct file_operations concurrent_active_time_bin_fops = {
+	.open		= concurrent_active_time_bin_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
 static const struct seq_operations concurrent_policy_time_seq_ops = {
 	.start = uid_seq_start,
 	.next = uid_seq_next,
@@ -606,6 +805,7 @@ static const struct seq_operations concurrent_policy_time_seq_ops = {
 
 static int concurrent_policy_time_open(struct inode *inode, struct file *file)
 {
+	uid_pending_fold_all();
 	return seq_open(file, &concurrent_policy_time_seq_ops);
 }
 
@@ -618,12 +818,23 @@ static const struct file_operations concurrent_policy_time_fops = {
 
 static int __init cpufreq_times_init(void)
 {
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu(uid_pending, cpu).lock);
+
 	proc_create_data("uid_time_in_state", 0444, NULL,
 			 &uid_time_in_state_fops, NULL);
 
+	proc_create_data("uid_time_in_state_bin", 0444, NULL,
+			 &uid_time_in_state_bin_fops, NULL);
+
 	proc_create_data("uid_concurrent_active_time", 0444, NULL,
 			 &concurrent_active_time_fops, NULL);
 
+	proc_create_data("uid_concurrent_active_time_bin", 0444, NULL,
+			 &concurrent_active_time_bin_fops, NULL);
+
 	proc_create_data("uid_concurrent_policy_time", 0444, NULL,
 			 &concurrent_policy_time_fops, NULL);
 
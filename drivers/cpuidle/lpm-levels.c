@@ -44,6 +44,7 @@
 #include <trace/events/trace_msm_low_power.h>
 
 #define SCLK_HZ (32768)
+#define LPM_HISTORY_MAX_RESI USEC_PER_SEC
 #define PSCI_POWER_STATE(reset) (reset << 30)
 #define PSCI_AFFINITY_LEVEL(lvl) ((lvl & 0x3) << 24)
 
@@ -51,6 +52,8 @@ static struct system_pm_ops *sys_pm_ops;
 struct lpm_cluster *lpm_root_node;
 
 static DEFINE_PER_CPU(struct lpm_cpu*, cpu_lpm);
+static DEFINE_PER_CPU(struct lpm_history, cpu_lpm_history);
+static DEFINE_PER_CPU(struct hrtimer, histtimer);
 static bool suspend_in_progress;
 static struct hrtimer lpm_hrtimer;
 
@@ -67,6 +70,15 @@ module_param_named(print_parsed_dt, print_parsed_dt, bool, 0664);
 static bool sleep_disabled;
 module_param_named(sleep_disabled, sleep_disabled, bool, 0664);
 
+static bool lpm_prediction = true;
+module_param_named(lpm_prediction, lpm_prediction, bool, 0664);
+
+static uint32_t ref_stddev = 500;
+module_param_named(ref_stddev, ref_stddev, uint, 0664);
+
+static uint32_t tmr_add = 100;
+module_param_named(tmr_add, tmr_add, uint, 0664);
+
 /**
  * msm_cpuidle_get_deep_idle_latency - Get deep idle latency value
  *
@@ -286,6 +298,129 @@ static void calculate_next_wakeup(uint32_t *next_wakeup_us,
 		*next_wakeup_us = next_event_us - lvl_latency_us;
 }
 
+/**
+ * lpm_history_predict() - Predict the next idle residency from history
+ * @h: residency history of a cpu or cluster
+ *
+ * Looks for a stable pattern in the recent idle residencies, such as a
+ * periodic IRQ or IPI waking the core well ahead of its next timer. If
+ * the samples are too spread out, the longest one is dropped and the
+ * rest are checked again.
+ *
+ * Returns the predicted residency in us, or 0 if there is no pattern.
+ */
+static uint32_t lpm_history_predict(struct lpm_history *h)
+{
+	uint64_t avg, stddev, max;
+	uint32_t thresh = UINT_MAX;
+	int i, n, iter;
+	int64_t diff;
+
+	/* The last prediction was wrong, start learning from scratch */
+	if (h->hinvalid) {
+		h->nsamp = 0;
+		h->hptr = 0;
+		h->hinvalid = false;
+		return 0;
+	}
+
+	if (h->nsamp < LPM_HISTORY_SAMPLES)
+		return 0;
+
+	for (iter = 0; iter < LPM_HISTORY_SAMPLES - 2; iter++) {
+		avg = 0;
+		max = 0;
+		n = 0;
+		for (i = 0; i < LPM_HISTORY_SAMPLES; i++) {
+			if (h->resi[i] > thresh)
+				continue;
+			avg += h->resi[i];
+			max = max_t(uint64_t, max, h->resi[i]);
+			n++;
+		}
+		if (!n)
+			return 0;
+		avg = div_u64(avg, n);
+
+		stddev = 0;
+		for (i = 0; i < LPM_HISTORY_SAMPLES; i++) {
+			if (h->resi[i] > thresh)
+				continue;
+			diff = (int64_t)h->resi[i] - avg;
+			stddev += diff * diff;
+		}
+		stddev = int_sqrt(div_u64(stddev, n));
+
+		if (stddev <= ref_stddev || avg > 6 * stddev)
+			return (uint32_t)avg;
+
+		thresh = (uint32_t)max - 1;
+	}
+
+	return 0;
+}
+
+static void lpm_history_update(struct lpm_history *h, uint32_t resi_us,
+		uint32_t min_residency)
+{
+	struct lpm_pred_stats *st = &h->stats;
+
+	st->selections++;
+	if (resi_us < min_residency)
+		st->premature++;
+
+	if (h->predicted) {
+		st->predicted++;
+		st->error_us += abs((int64_t)resi_us - h->predicted);
+		h->predicted = 0;
+	}
+
+	/* Cut short by the history timer, not a real residency */
+	if (h->hinvalid)
+		return;
+
+	h->resi[h->hptr] = min_t(uint32_t, resi_us, LPM_HISTORY_MAX_RESI);
+	h->hptr = (h->hptr + 1) % LPM_HISTORY_SAMPLES;
+	if (h->nsamp < LPM_HISTORY_SAMPLES)
+		h->nsamp++;
+}
+
+/*
+ * Fires when a cpu slept longer than predicted plus tmr_add, i.e. the
+ * pattern the prediction was based on is gone. Invalidate the history of
+ * the cpu and its clusters so the next selection falls back to the timer
+ * based sleep length instead of staying in a shallow mode.
+ */
+static enum hrtimer_restart histtimer_fn(struct hrtimer *h)
+{
+	int cpu = raw_smp_processor_id();
+	struct lpm_cpu *lpm_cpu = per_cpu(cpu_lpm, cpu);
+	struct lpm_cluster *cluster = lpm_cpu ? lpm_cpu->parent : NULL;
+
+	per_cpu(cpu_lpm_history, cpu).hinvalid = true;
+	for (; cluster; cluster = cluster->parent)
+		WRITE_ONCE(cluster->history.hinvalid, true);
+
+	return HRTIMER_NORESTART;
+}
+
+static void histtimer_start(int cpu, uint32_t time_us)
+{
+	struct hrtimer *cpu_histtimer = &per_cpu(histtimer, cpu);
+	ktime_t hist_ktime = ns_to_ktime((u64)time_us * NSEC_PER_USEC);
+
+	cpu_histtimer->function = histtimer_fn;
+	hrtimer_start(cpu_histtimer, hist_ktime, HRTIMER_MODE_REL_PINNED_HARD);
+}
+
+static void histtimer_cancel(int cpu)
+{
+	struct hrtimer *cpu_histtimer = &per_cpu(histtimer, cpu);
+
+	if (hrtimer_is_queued(cpu_histtimer))
+		hrtimer_try_to_cancel(cpu_histtimer);
+}
+
 static int cpu_power_select(struct cpuidle_device *dev,
 		struct lpm_cpu *cpu)
 {
@@ -300,7 +435,11 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	uint32_t lvl_latency_us = 0;
 	uint32_t next_wakeup_us = (uint32_t)sleep_us;
 	uint32_t max_residency;
+	uint32_t pred_us = 0;
 	struct power_params *pwr_params;
+	struct lpm_history *history = &per_cpu(cpu_lpm_history, dev->cpu);
+
+	history->predicted = 0;
 
 	if (lpm_disallowed(sleep_us, dev->cpu, cpu))
 		goto done_select;
@@ -308,6 +447,9 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	idx_restrict = cpu->nlevels + 1;
 	next_event_us = (uint32_t)(ktime_to_us(get_next_event_time(dev->cpu)));
 
+	if (lpm_prediction)
+		pred_us = lpm_history_predict(history);
+
 	for (i = 0; i < cpu->nlevels; i++) {
 		if (!lpm_cpu_mode_allow(dev->cpu, i, true))
 			continue;
@@ -322,6 +464,11 @@ static int cpu_power_select(struct cpuidle_device *dev,
 		calculate_next_wakeup(&next_wakeup_us, next_event_us,
 				      lvl_latency_us, sleep_us);
 
+		if (pred_us && pred_us < next_wakeup_us) {
+			next_wakeup_us = pred_us;
+			history->predicted = pred_us;
+		}
+
 		if (i >= idx_restrict)
 			break;
 
@@ -339,6 +486,9 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	if (modified_time_us)
 		msm_pm_set_timer(modified_time_us);
 
+	if (history->predicted)
+		histtimer_start(dev->cpu, history->predicted + tmr_add);
+
 done_select:
 	trace_cpu_power_select(best_level, sleep_us, latency_us, next_event_us);
 
@@ -407,6 +557,16 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle)
 
 	sleep_us = (uint32_t)get_cluster_sleep_time(cluster, from_idle);
 
+	cluster->history.predicted = 0;
+	if (from_idle && lpm_prediction) {
+		uint32_t pred_us = lpm_history_predict(&cluster->history);
+
+		if (pred_us && pred_us < sleep_us) {
+			sleep_us = pred_us;
+			cluster->history.predicted = pred_us;
+		}
+	}
+
 	if (cpumask_and(&mask, cpu_online_mask, &cluster->child_cpus))
 		latency_us = pm_qos_request_for_cpumask(PM_QOS_CPU_DMA_LATENCY,
 							&mask);
@@ -517,6 +677,14 @@ static void cluster_prepare(struct lpm_cluster *cluster,
 				&cluster->child_cpus))
 		goto failed;
 
+	/*
+	 * Sample every cluster idle period, including the ones spent in the
+	 * default level, so a prediction that keeps the cluster shallow is
+	 * still corrected by what actually happened.
+	 */
+	if (from_idle)
+		cluster->history.entry_time = start_time;
+
 	i = cluster_select(cluster, from_idle);
 
 	if (i < 0)
@@ -533,6 +701,8 @@ static void cluster_prepare(struct lpm_cluster *cluster,
 	raw_spin_unlock(&cluster->sync_lock);
 	return;
 failed:
+	cluster->history.predicted = 0;
+	cluster->history.entry_time = 0;
 	raw_spin_unlock(&cluster->sync_lock);
 	if (!IS_ERR_OR_NULL(cluster->stats))
 		cluster->stats->sleep_time = 0;
@@ -567,6 +737,18 @@ static void cluster_unprepare(struct lpm_cluster *cluster,
 					&lvl->num_cpu_votes, cpu);
 	}
 
+	level = &cluster->levels[cluster->last_level];
+
+	if (first_cpu && cluster->history.entry_time) {
+		if (from_idle)
+			lpm_history_update(&cluster->history,
+				(uint32_t)div_s64(end_time -
+					cluster->history.entry_time,
+					NSEC_PER_USEC),
+				level->pwr.min_residency);
+		cluster->history.entry_time = 0;
+	}
+
 	if (!first_cpu || cluster->last_level == cluster->default_level)
 		goto unlock_return;
 
@@ -575,8 +757,6 @@ static void cluster_unprepare(struct lpm_cluster *cluster,
 			cluster->stats->sleep_time;
 	lpm_stats_cluster_exit(cluster->stats, cluster->last_level, success);
 
-	level = &cluster->levels[cluster->last_level];
-
 	if (level->notify_rpm)
 		if (sys_pm_ops && sys_pm_ops->exit)
 			sys_pm_ops->exit(success);
@@ -729,6 +909,10 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 exit:
 	end_time = ktime_to_ns(ktime_get());
 	lpm_stats_cpu_exit(idx, end_time, success);
+	histtimer_cancel(dev->cpu);
+	lpm_history_update(&per_cpu(cpu_lpm_history, dev->cpu),
+			(uint32_t)div_u64(end_time - start_time, NSEC_PER_USEC),
+			cpu->levels[idx].pwr.min_residency);
 
 	cluster_unprepare(cpu->parent, cpumask, idx, true, end_time, success);
 	cpu_unprepare(cpu, idx, true);
@@ -951,6 +1135,53 @@ static void register_cluster_lpm_stats(struct lpm_cluster *cl,
 		register_cluster_lpm_stats(child, cl);
 }
 
+static ssize_t lpm_pred_stats_print(char *buf, ssize_t len,
+		const char *name, struct lpm_history *h)
+{
+	struct lpm_pred_stats *st = &h->stats;
+	uint64_t avg_err = st->predicted ?
+			div_u64(st->error_us, st->predicted) : 0;
+
+	return len + scnprintf(buf + len, PAGE_SIZE - len,
+		"%s: selections:%u predicted:%u premature:%u avg_error_us:%llu\n",
+		name, st->selections, st->predicted, st->premature, avg_err);
+}
+
+static ssize_t cluster_pred_stats_show(struct lpm_cluster *cl, char *buf,
+		ssize_t len)
+{
+	struct lpm_cluster *child;
+
+	len = lpm_pred_stats_print(buf, len, cl->cluster_name, &cl->history);
+
+	list_for_each_entry(child, &cl->child, list)
+		len = cluster_pred_stats_show(child, buf, len);
+
+	return len;
+}
+
+static ssize_t prediction_stats_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	char name[8];
+	ssize_t len = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		snprintf(name, sizeof(name), "cpu%d", cpu);
+		len = lpm_pred_stats_print(buf, len, name,
+				&per_cpu(cpu_lpm_history, cpu));
+	}
+
+	if (lpm_root_node)
+		len = cluster_pred_stats_show(lpm_root_node, buf, len);
+
+	return len;
+}
+
+static struct kobj_attribute prediction_stats_attr =
+	__ATTR_RO(prediction_stats);
+
 static int lpm_suspend_prepare(void)
 {
 	suspend_in_progress = true;
@@ -1016,7 +1247,7 @@ static const struct platform_s2idle_ops lpm_s2idle_ops = {
 
 static int lpm_probe(struct platform_device *pdev)
 {
-	int ret;
+	int ret, cpu;
 	struct kobject *module_kobj = NULL;
 
 	get_online_cpus();
@@ -1040,6 +1271,9 @@ static int lpm_probe(struct platform_device *pdev)
 	suspend_set_ops(&lpm_suspend_ops);
 	s2idle_set_ops(&lpm_s2idle_ops);
 	hrtimer_init(&lpm_hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+	for_each_possible_cpu(cpu)
+		hrtimer_init(&per_cpu(histtimer, cpu), CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL_PINNED_HARD);
 
 	register_cluster_lpm_stats(lpm_root_node, NULL);
 
@@ -1069,6 +1303,9 @@ static int lpm_probe(struct platform_device *pdev)
 		goto failed;
 	}
 
+	if (sysfs_create_file(module_kobj, &prediction_stats_attr.attr))
+		pr_err("Failed to create prediction stats node\n");
+
 	return 0;
 failed:
 	free_cluster_node(lpm_root_node);
@@ -62,6 +62,25 @@ struct lpm_cluster_level {
 	int reset_level;
 };
 
+#define LPM_HISTORY_SAMPLES 5
+
+struct lpm_pred_stats {
+	uint32_t selections;	/* idle exits accounted */
+	uint32_t predicted;	/* selections shortened by the predictor */
+	uint32_t premature;	/* exits before the level's min residency */
+	uint64_t error_us;	/* sum of |actual - predicted| residency */
+};
+
+struct lpm_history {
+	uint32_t resi[LPM_HISTORY_SAMPLES];
+	int nsamp;
+	int hptr;
+	uint32_t predicted;
+	bool hinvalid;
+	int64_t entry_time;
+	struct lpm_pred_stats stats;
+};
+
 struct lpm_cluster {
 	struct list_head list;
 	struct list_head child;
@@ -80,6 +99,7 @@ struct lpm_cluster {
 	struct lpm_stats *stats;
 	unsigned int psci_mode_shift;
 	unsigned int psci_mode_mask;
+	struct lpm_history history;
 };
 
 struct lpm_cluster *lpm_of_parse_cluster(struct platform_device *pdev);
@@ -26,11 +26,53 @@
 
 #include <trace/events/power.h>
 
+enum memlat_class {
+	MEMLAT_COMPUTE,
+	MEMLAT_POINTER_CHASE,
+	MEMLAT_STREAMING,
+	MEMLAT_NUM_CLASSES,
+};
+
+static const char * const memlat_class_names[MEMLAT_NUM_CLASSES] = {
+	[MEMLAT_COMPUTE]	= "compute",
+	[MEMLAT_POINTER_CHASE]	= "pointer_chase",
+	[MEMLAT_STREAMING]	= "streaming",
+};
+
+#define MEMLAT_HIST_LEN	4
+
+/**
+ * struct memlat_phase - Workload phase tracking for adaptive mode
+ * @hist:		Classes of the last MEMLAT_HIST_LEN samples.
+ * @hist_idx:		Next slot to fill in @hist.
+ * @cur_class:		Majority class over @hist.
+ * @cur_freq:		Vote currently held by the hysteresis.
+ * @down_cnt:		Consecutive samples asking for less than @cur_freq.
+ * @down_max:		Highest of those lower requests.
+ * @last_ts:		Time of the previous sample, in ms.
+ * @residency_ms:	Time spent in each class.
+ * @flips:		Number of times the vote changed.
+ */
+struct memlat_phase {
+	u8 hist[MEMLAT_HIST_LEN];
+	unsigned int hist_idx;
+	enum memlat_class cur_class;
+	unsigned long cur_freq;
+	unsigned int down_cnt;
+	unsigned long down_max;
+	s64 last_ts;
+	u64 residency_ms[MEMLAT_NUM_CLASSES];
+	unsigned long flips;
+};
+
 struct memlat_node {
 	unsigned int ratio_ceil;
 	unsigned int stall_floor;
 	unsigned int wb_pct_thres;
 	unsigned int wb_filter_ratio;
+	unsigned int adaptive;
+	unsigned int down_hyst;
+	struct memlat_phase phase;
 	bool mon_started;
 	bool already_zero;
 	struct list_head list;
@@ -261,6 +303,76 @@ static void gov_stop(struct devfreq *df)
 	hw->df = NULL;
 }
 
+static enum memlat_class memlat_update_phase(struct memlat_phase *p,
+					     enum memlat_class cls)
+{
+	unsigned int cnt[MEMLAT_NUM_CLASSES] = { 0 };
+	enum memlat_class best = cls;
+	s64 now = ktime_to_ms(ktime_get());
+	int i;
+
+	/* Seed the history from the first sample rather than with compute */
+	if (p->last_ts)
+		p->residency_ms[p->cur_class] += now - p->last_ts;
+	else
+		memset(p->hist, cls, sizeof(p->hist));
+	p->last_ts = now;
+
+	p->hist[p->hist_idx] = cls;
+	p->hist_idx = (p->hist_idx + 1) % MEMLAT_HIST_LEN;
+
+	/* Majority vote, ties go to the latest sample */
+	for (i = 0; i < MEMLAT_HIST_LEN; i++)
+		cnt[p->hist[i]]++;
+	for (i = 0; i < MEMLAT_NUM_CLASSES; i++)
+		if (cnt[i] > cnt[best])
+			best = i;
+
+	p->cur_class = best;
+	return best;
+}
+
+/*
+ * Adaptive mode: raise the vote right away when the workload needs more and
+ * only lower it after down_hyst samples in a row asked for less. The phase
+ * only shapes how fast the vote comes down and never takes it below what the
+ * current sample asked for: compute phases drop it on the first lower
+ * request, streaming phases come with bursty writebacks so they hold it
+ * twice as long.
+ */
+static unsigned long memlat_adaptive_freq(struct memlat_node *node,
+					  enum memlat_class cls,
+					  unsigned long freq)
+{
+	struct memlat_phase *p = &node->phase;
+	unsigned long prev = p->cur_freq;
+	unsigned int hyst = node->down_hyst;
+
+	cls = memlat_update_phase(p, cls);
+	if (cls == MEMLAT_COMPUTE)
+		hyst = 1;
+	else if (cls == MEMLAT_STREAMING)
+		hyst *= 2;
+
+	if (freq >= p->cur_freq) {
+		p->cur_freq = freq;
+		p->down_cnt = 0;
+		p->down_max = 0;
+	} else {
+		p->down_max = max(p->down_max, freq);
+		if (++p->down_cnt >= hyst) {
+			p->cur_freq = p->down_max;
+			p->down_cnt = 0;
+			p->down_max = 0;
+		}
+	}
+
+	if (p->cur_freq != prev)
+		p->flips++;
+
+	return p->cur_freq;
+}
+
 static int devfreq_memlat_get_freq(struct devfreq *df,
 					unsigned long *freq)
 {
@@ -269,6 +381,8 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 	struct memlat_hwmon *hw = node->hw;
 	unsigned long max_freq = 0;
 	unsigned int ratio;
+	enum memlat_class cls = MEMLAT_COMPUTE;
+	bool stall_bound, wb_bound;
 
 	/*
 	 * node->resume_freq is set to 0 at the end of resume (after the update)
@@ -301,19 +415,26 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 					hw->core_stats[i].stall_pct,
 					hw->core_stats[i].wb_pct, ratio);
 
-		if (((ratio <= node->ratio_ceil
-		      && hw->core_stats[i].stall_pct >= node->stall_floor) ||
-		      (hw->core_stats[i].wb_pct >= node->wb_pct_thres
-		      && ratio <= node->wb_filter_ratio))
+		stall_bound = ratio <= node->ratio_ceil &&
+			hw->core_stats[i].stall_pct >= node->stall_floor;
+		wb_bound = hw->core_stats[i].wb_pct >= node->wb_pct_thres &&
+			ratio <= node->wb_filter_ratio;
+
+		if ((stall_bound || wb_bound)
 		      && (hw->core_stats[i].freq > max_freq)) {
 			lat_dev = i;
 			max_freq = hw->core_stats[i].freq;
+			cls = wb_bound ? MEMLAT_STREAMING :
+					 MEMLAT_POINTER_CHASE;
 		}
 	}
 
 	if (max_freq)
 		max_freq = core_to_dev_freq(node, max_freq);
 
+	if (node->adaptive)
+		max_freq = memlat_adaptive_freq(node, cls, max_freq);
+
 	if (max_freq || !node->already_zero) {
 		trace_memlat_dev_update(dev_name(df->dev.parent),
 					hw->core_stats[lat_dev].id,
@@ -333,12 +454,39 @@ gov_attr(ratio_ceil, 1U, 20000U);
 gov_attr(stall_floor, 0U, 100U);
 gov_attr(wb_pct_thres, 0U, 100U);
 gov_attr(wb_filter_ratio, 0U, 50000U);
+gov_attr(adaptive, 0U, 1U);
+gov_attr(down_hyst, 1U, 20U);
+
+static ssize_t class_stats_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct memlat_node *n = df->data;
+	struct memlat_phase *p = &n->phase;
+	unsigned int cnt = 0;
+	int i;
+
+	for (i = 0; i < MEMLAT_NUM_CLASSES; i++)
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "%s: %llu ms\n",
+				 memlat_class_names[i], p->residency_ms[i]);
+	cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "current: %s\n",
+			 memlat_class_names[p->cur_class]);
+	cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "flips: %lu\n",
+			 p->flips);
+
+	return cnt;
+}
+
+static DEVICE_ATTR_RO(class_stats);
 
 static struct attribute *memlat_dev_attr[] = {
 	&dev_attr_ratio_ceil.attr,
 	&dev_attr_stall_floor.attr,
 	&dev_attr_wb_pct_thres.attr,
 	&dev_attr_wb_filter_ratio.attr,
+	&dev_attr_adaptive.attr,
+	&dev_attr_down_hyst.attr,
+	&dev_attr_class_stats.attr,
 	&dev_attr_freq_map.attr,
 	NULL,
 };
@@ -503,6 +651,7 @@ static struct memlat_node *register_common(struct device *dev,
 	node->ratio_ceil = 10;
 	node->wb_pct_thres = 100;
 	node->wb_filter_ratio = 25000;
+	node->down_hyst = 3;
 	node->hw = hw;
 
 	if (hw->get_child_of_node) {
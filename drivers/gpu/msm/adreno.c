@@ -2886,6 +2886,10 @@ static int adreno_setproperty(struct kgsl_device_private *dev_priv,
 			kgsl_context_put(context);
 		}
 		break;
+	case KGSL_PROP_CONTEXT_FRAME_BUDGET:
+		status = adreno_drawctxt_set_frame_budget(dev_priv, value,
+			sizebytes);
+		break;
 	default:
 		status = -ENODEV;
 		break;
@@ -4059,6 +4063,8 @@ static const struct kgsl_functable adreno_functable = {
 	.waittimestamp = adreno_waittimestamp,
 	.readtimestamp = adreno_readtimestamp,
 	.queue_cmds = adreno_dispatcher_queue_cmds,
+	.queue_cmds_deferred = adreno_dispatcher_queue_cmds_deferred,
+	.issue_cmds = adreno_dispatcher_issue_cmds,
 	.ioctl = adreno_ioctl,
 	.compat_ioctl = adreno_compat_ioctl,
 	.power_stats = adreno_power_stats,
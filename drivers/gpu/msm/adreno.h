@@ -567,6 +567,11 @@ struct adreno_device {
 	 * controls perfcounter ioctl read
 	 */
 	bool perfcounter;
+	/**
+	 * @deadline_sched: Issue the pending contexts in order of the deadline
+	 * of their next command instead of by priority
+	 */
+	bool deadline_sched;
 };
 
 /**
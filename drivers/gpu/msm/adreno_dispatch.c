@@ -49,6 +49,13 @@ unsigned int adreno_drawobj_timeout = 2000;
 /* Interval for reading and comparing fault detection registers */
 static unsigned int _fault_timer_interval = 200;
 
+/*
+ * Implicit deadline (in milliseconds) for commands from contexts without a
+ * frame budget in the deadline scheduling mode. This bounds how long such a
+ * context can be starved by contexts with tight frame budgets.
+ */
+static unsigned int _dispatcher_deadline_default_ms = 100;
+
 #define DRAWQUEUE_RB(_drawqueue) \
 	((struct adreno_ringbuffer *) \
 		container_of((_drawqueue),\
@@ -331,11 +338,43 @@ static bool _marker_expired(struct kgsl_drawobj_cmd *markerobj)
 			markerobj->marker_timestamp);
 }
 
+/*
+ * Return the deadline of a drawobj. Objects other than commands and markers
+ * are cheap to process and are considered due immediately.
+ */
+static inline ktime_t _drawobj_deadline(struct kgsl_drawobj *drawobj)
+{
+	if (drawobj->type & (CMDOBJ_TYPE | MARKEROBJ_TYPE))
+		return CMDOBJ(drawobj)->deadline;
+
+	return 0;
+}
+
+/*
+ * Cache the deadline of the head of the context queue so that the dispatcher
+ * can compare contexts without taking their locks. Called with the context
+ * lock held whenever the head of the queue changes.
+ */
+static inline void _update_head_deadline(struct adreno_context *drawctxt)
+{
+	struct kgsl_drawobj *drawobj;
+
+	if (drawctxt->drawqueue_head == drawctxt->drawqueue_tail) {
+		WRITE_ONCE(drawctxt->head_deadline, KTIME_MAX);
+		return;
+	}
+
+	drawobj = drawctxt->drawqueue[drawctxt->drawqueue_head];
+	WRITE_ONCE(drawctxt->head_deadline,
+		drawobj ? _drawobj_deadline(drawobj) : 0);
+}
+
 static inline void _pop_drawobj(struct adreno_context *drawctxt)
 {
 	drawctxt->drawqueue_head = DRAWQUEUE_NEXT(drawctxt->drawqueue_head,
 		ADRENO_CONTEXT_DRAWQUEUE_SIZE);
 	drawctxt->queued--;
+	_update_head_deadline(drawctxt);
 }
 
 static void _retire_sparseobj(struct kgsl_drawobj_sparse *sparseobj,
@@ -502,6 +541,7 @@ static inline int adreno_dispatcher_requeue_cmdobj(
 
 	/* Reset the command queue head to reflect the newly requeued change */
 	drawctxt->drawqueue_head = prev;
+	_update_head_deadline(drawctxt);
 	spin_unlock(&drawctxt->lock);
 	return 0;
 }
@@ -551,6 +591,7 @@ static int sendcmd(struct adreno_device *adreno_dev,
 	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
 	struct adreno_dispatcher_drawqueue *dispatch_q =
 				ADRENO_DRAWOBJ_DISPATCH_DRAWQUEUE(drawobj);
+	struct adreno_context *drawctxt = ADRENO_CONTEXT(drawobj->context);
 	int ret;
 
 	mutex_lock(&device->mutex);
@@ -584,6 +625,16 @@ static int sendcmd(struct adreno_device *adreno_dev,
 			ADRENO_DRAWOBJ_PROFILE_COUNT;
 	}
 
+	/*
+	 * Raise the power level ahead of the first command of a frame if the
+	 * predicted work of the frame would not fit in its budget otherwise
+	 */
+	if (drawctxt->frame_budget_us && !drawctxt->frame_hinted) {
+		kgsl_pwrscale_frame_start(device, &drawctxt->frame_history,
+			drawctxt->frame_budget_us);
+		drawctxt->frame_hinted = true;
+	}
+
 	ret = adreno_ringbuffer_submitcmd(adreno_dev, cmdobj, NULL);
 
 	/*
@@ -655,6 +706,11 @@ static int sendcmd(struct adreno_device *adreno_dev,
 		dispatch_q->expires = jiffies +
 			msecs_to_jiffies(adreno_drawobj_timeout);
 
+	cmdobj->submit_time = ktime_get();
+
+	if (drawobj->flags & KGSL_DRAWOBJ_END_OF_FRAME)
+		drawctxt->frame_hinted = false;
+
 	mutex_unlock(&device->mutex);
 
 	dispatch_q->cmd_q[dispatch_q->tail] = cmdobj;
@@ -857,6 +913,40 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 	return ret;
 }
 
+/**
+ * _dispatcher_next_context() - Pick the next context to issue commands from
+ * @adreno_dev: Pointer to the adreno device struct
+ *
+ * In the default mode this is the highest priority pending context. In the
+ * deadline scheduling mode it is the pending context whose next command has
+ * the earliest deadline. Must be called with the plist_lock held and the
+ * pending list not empty.
+ */
+static struct adreno_context *_dispatcher_next_context(
+		struct adreno_device *adreno_dev)
+{
+	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
+	struct adreno_context *drawctxt, *next;
+	ktime_t deadline, earliest = KTIME_MAX;
+
+	next = plist_first_entry(&dispatcher->pending,
+		struct adreno_context, pending);
+
+	if (!adreno_dev->deadline_sched)
+		return next;
+
+	plist_for_each_entry(drawctxt, &dispatcher->pending, pending) {
+		deadline = READ_ONCE(drawctxt->head_deadline);
+
+		if (deadline < earliest) {
+			earliest = deadline;
+			next = drawctxt;
+		}
+	}
+
+	return next;
+}
+
 /**
  * _adreno_dispatcher_issuecmds() - Issue commmands from pending contexts
  * @adreno_dev: Pointer to the adreno device struct
@@ -896,8 +986,7 @@ static void _adreno_dispatcher_issuecmds(struct adreno_device *adreno_dev)
 		}
 
 		/* Get the next entry on the list */
-		drawctxt = plist_first_entry(&dispatcher->pending,
-			struct adreno_context, pending);
+		drawctxt = _dispatcher_next_context(adreno_dev);
 
 		plist_del(&drawctxt->pending, &dispatcher->pending);
 
@@ -1186,6 +1275,12 @@ static inline int _wait_for_room_in_context_queue(
 		trace_adreno_drawctxt_sleep(drawctxt);
 		spin_unlock(&drawctxt->lock);
 
+		/*
+		 * Deferred submissions do not kick the dispatcher so make sure
+		 * it is running to drain the queue we are waiting on
+		 */
+		adreno_dispatcher_schedule(drawctxt->base.device);
+
 		ret = wait_event_interruptible_timeout(drawctxt->wq,
 			_check_context_queue(drawctxt),
 			msecs_to_jiffies(_context_queue_wait));
@@ -1223,14 +1318,49 @@ static unsigned int _check_context_state_to_queue_cmds(
 static void _queue_drawobj(struct adreno_context *drawctxt,
 	struct kgsl_drawobj *drawobj)
 {
+	bool empty = (drawctxt->drawqueue_head == drawctxt->drawqueue_tail);
+
 	/* Put the command into the queue */
 	drawctxt->drawqueue[drawctxt->drawqueue_tail] = drawobj;
 	drawctxt->drawqueue_tail = (drawctxt->drawqueue_tail + 1) %
 			ADRENO_CONTEXT_DRAWQUEUE_SIZE;
 	drawctxt->queued++;
+
+	if (empty)
+		_update_head_deadline(drawctxt);
+
 	trace_adreno_cmdbatch_queued(drawobj, drawctxt->queued);
 }
 
+/*
+ * Assign the deadline of a command. Commands of a context with a frame budget
+ * share the deadline of their frame, which starts with the first command
+ * queued after an end of frame marker (or after the previous frame deadline
+ * has passed) and ends with the next end of frame command. Other commands
+ * get the implicit default deadline.
+ */
+static void _cmdobj_set_deadline(struct adreno_context *drawctxt,
+		struct kgsl_drawobj_cmd *cmdobj)
+{
+	ktime_t now = ktime_get();
+
+	if (!drawctxt->frame_budget_us) {
+		cmdobj->deadline = ktime_add_ms(now,
+			_dispatcher_deadline_default_ms);
+		return;
+	}
+
+	if (!drawctxt->frame_deadline ||
+		ktime_after(now, drawctxt->frame_deadline))
+		drawctxt->frame_deadline = ktime_add_us(now,
+			drawctxt->frame_budget_us);
+
+	cmdobj->deadline = drawctxt->frame_deadline;
+
+	if (cmdobj->base.flags & KGSL_DRAWOBJ_END_OF_FRAME)
+		drawctxt->frame_deadline = 0;
+}
+
 static int _queue_sparseobj(struct adreno_device *adreno_dev,
 	struct adreno_context *drawctxt, struct kgsl_drawobj_sparse *sparseobj,
 	uint32_t *timestamp, unsigned int user_ts)
@@ -1302,6 +1432,7 @@ static int drawctxt_queue_markerobj(struct adreno_device *adreno_dev,
 	drawctxt->queued_timestamp = *timestamp;
 	_set_ft_policy(adreno_dev, drawctxt, markerobj);
 	_cmdobj_set_flags(drawctxt, markerobj);
+	_cmdobj_set_deadline(drawctxt, markerobj);
 
 	_queue_drawobj(drawctxt, drawobj);
 
@@ -1340,6 +1471,7 @@ static int drawctxt_queue_cmdobj(struct adreno_device *adreno_dev,
 	drawctxt->queued_timestamp = *timestamp;
 	_set_ft_policy(adreno_dev, drawctxt, cmdobj);
 	_cmdobj_set_flags(drawctxt, cmdobj);
+	_cmdobj_set_deadline(drawctxt, cmdobj);
 
 	_queue_drawobj(drawctxt, drawobj);
 
@@ -1355,21 +1487,9 @@ static void drawctxt_queue_syncobj(struct adreno_context *drawctxt,
 	_queue_drawobj(drawctxt, drawobj);
 }
 
-/**
- * adreno_dispactcher_queue_cmds() - Queue a new draw object in the context
- * @dev_priv: Pointer to the device private struct
- * @context: Pointer to the kgsl draw context
- * @drawobj: Pointer to the array of drawobj's being submitted
- * @count: Number of drawobj's being submitted
- * @timestamp: Pointer to the requested timestamp
- *
- * Queue a command in the context - if there isn't any room in the queue, then
- * block until there is
- */
-int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
+static int _adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 		struct kgsl_context *context, struct kgsl_drawobj *drawobj[],
-		uint32_t count, uint32_t *timestamp)
-
+		uint32_t count, uint32_t *timestamp, bool issue)
 {
 	struct kgsl_device *device = dev_priv->device;
 	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
@@ -1490,7 +1610,7 @@ int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 	 * queue will try to schedule new commands anyway.
 	 */
 
-	if (dispatch_q->inflight < _context_drawobj_burst)
+	if (issue && dispatch_q->inflight < _context_drawobj_burst)
 		adreno_dispatcher_issuecmds(adreno_dev);
 done:
 	if (test_and_clear_bit(ADRENO_CONTEXT_FAULT, &context->priv))
@@ -1499,6 +1619,58 @@ int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 	return 0;
 }
 
+/**
+ * adreno_dispactcher_queue_cmds() - Queue a new draw object in the context
+ * @dev_priv: Pointer to the device private struct
+ * @context: Pointer to the kgsl draw context
+ * @drawobj: Pointer to the array of drawobj's being submitted
+ * @count: Number of drawobj's being submitted
+ * @timestamp: Pointer to the requested timestamp
+ *
+ * Queue a command in the context - if there isn't any room in the queue, then
+ * block until there is
+ */
+int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
+		struct kgsl_context *context, struct kgsl_drawobj *drawobj[],
+		uint32_t count, uint32_t *timestamp)
+{
+	return _adreno_dispatcher_queue_cmds(dev_priv, context, drawobj,
+		count, timestamp, true);
+}
+
+/**
+ * adreno_dispatcher_queue_cmds_deferred() - Queue a new draw object in the
+ * context without issuing it
+ * @dev_priv: Pointer to the device private struct
+ * @context: Pointer to the kgsl draw context
+ * @drawobj: Pointer to the array of drawobj's being submitted
+ * @count: Number of drawobj's being submitted
+ * @timestamp: Pointer to the requested timestamp
+ *
+ * Same as adreno_dispatcher_queue_cmds() but the context is only added to the
+ * dispatcher pending list. The caller is expected to call
+ * adreno_dispatcher_issue_cmds() once it has queued all of its commands so
+ * that a batch of submissions costs a single dispatcher kick.
+ */
+int adreno_dispatcher_queue_cmds_deferred(struct kgsl_device_private *dev_priv,
+		struct kgsl_context *context, struct kgsl_drawobj *drawobj[],
+		uint32_t count, uint32_t *timestamp)
+{
+	return _adreno_dispatcher_queue_cmds(dev_priv, context, drawobj,
+		count, timestamp, false);
+}
+
+/**
+ * adreno_dispatcher_issue_cmds() - Issue the commands queued on the dispatcher
+ * @device: Pointer to the KGSL device
+ *
+ * Kick the dispatcher after a batch of deferred submissions.
+ */
+void adreno_dispatcher_issue_cmds(struct kgsl_device *device)
+{
+	adreno_dispatcher_issuecmds(ADRENO_DEVICE(device));
+}
+
 static int _mark_context(int id, void *ptr, void *data)
 {
 	unsigned int guilty = *((unsigned int *) data);
@@ -2367,6 +2539,14 @@ static void retire_cmdobj(struct adreno_device *adreno_dev,
 	if (test_bit(CMDOBJ_PROFILE, &cmdobj->priv))
 		cmdobj_profile_ticks(adreno_dev, cmdobj, &start, &end);
 
+	/* Account the frame against the frame budget of the context */
+	if (drawctxt->frame_budget_us &&
+		(drawobj->flags & KGSL_DRAWOBJ_END_OF_FRAME)) {
+		drawctxt->deadline_frames++;
+		if (ktime_after(ktime_get(), cmdobj->deadline))
+			drawctxt->deadline_misses++;
+	}
+
 	/*
 	 * For A3xx we still get the rptr from the CP_RB_RPTR instead of
 	 * rptr scratch out address. At this point GPU clocks turned off.
@@ -2385,6 +2565,35 @@ static void retire_cmdobj(struct adreno_device *adreno_dev,
 	kgsl_drawobj_destroy(drawobj);
 }
 
+/*
+ * Account the GPU time of a retired command to the frame history of its
+ * context. The commands of a drawqueue run back to back so the busy time is
+ * the time since the command was submitted or since the previous command of
+ * the queue retired, whichever is later.
+ */
+static void _retire_frame_work(struct adreno_device *adreno_dev,
+		struct adreno_dispatcher_drawqueue *drawqueue,
+		struct kgsl_drawobj_cmd *cmdobj)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct kgsl_drawobj *drawobj = DRAWOBJ(cmdobj);
+	struct adreno_context *drawctxt = ADRENO_CONTEXT(drawobj->context);
+	ktime_t now = ktime_get();
+	ktime_t start = ktime_after(cmdobj->submit_time, drawqueue->last_retire) ?
+		cmdobj->submit_time : drawqueue->last_retire;
+
+	drawqueue->last_retire = now;
+
+	if (!device->pwrscale.predict_enable)
+		return;
+
+	kgsl_pwrscale_frame_work(device, &drawctxt->frame_history,
+		ktime_us_delta(now, start));
+
+	if (drawobj->flags & KGSL_DRAWOBJ_END_OF_FRAME)
+		kgsl_pwrscale_frame_end(device, &drawctxt->frame_history);
+}
+
 static int adreno_dispatch_retire_drawqueue(struct adreno_device *adreno_dev,
 		struct adreno_dispatcher_drawqueue *drawqueue)
 {
@@ -2401,6 +2610,8 @@ static int adreno_dispatch_retire_drawqueue(struct adreno_device *adreno_dev,
 			drawobj->timestamp))
 			break;
 
+		_retire_frame_work(adreno_dev, drawqueue, cmdobj);
+
 		retire_cmdobj(adreno_dev, cmdobj);
 
 		dispatcher->inflight--;
@@ -2803,6 +3014,8 @@ static DISPATCHER_UINT_ATTR(fault_throttle_time, 0644, 0,
 	_fault_throttle_time);
 static DISPATCHER_UINT_ATTR(fault_throttle_burst, 0644, 0,
 	_fault_throttle_burst);
+static DISPATCHER_UINT_ATTR(deadline_default, 0644, 0,
+	_dispatcher_deadline_default_ms);
 
 static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_inflight.attr,
@@ -2814,6 +3027,7 @@ static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_fault_detect_interval.attr,
 	&dispatcher_attr_fault_throttle_time.attr,
 	&dispatcher_attr_fault_throttle_burst.attr,
+	&dispatcher_attr_deadline_default.attr,
 	NULL,
 };
 
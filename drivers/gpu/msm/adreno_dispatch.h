@@ -29,6 +29,7 @@ extern unsigned int adreno_drawobj_timeout;
  * @tail: Queues tail pointer
  * @active_context_count: Number of active contexts seen in this rb drawqueue
  * @expires: The jiffies value at which this drawqueue has run too long
+ * @last_retire: Time at which the last command of this q was retired
  */
 struct adreno_dispatcher_drawqueue {
 	struct kgsl_drawobj_cmd *cmd_q[ADRENO_DISPATCH_DRAWQUEUE_SIZE];
@@ -37,6 +38,7 @@ struct adreno_dispatcher_drawqueue {
 	unsigned int tail;
 	int active_context_count;
 	unsigned long expires;
+	ktime_t last_retire;
 };
 
 /**
@@ -92,6 +94,10 @@ struct kgsl_drawobj;
 int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 		struct kgsl_context *context, struct kgsl_drawobj *drawobj[],
 		uint32_t count, uint32_t *timestamp);
+int adreno_dispatcher_queue_cmds_deferred(struct kgsl_device_private *dev_priv,
+		struct kgsl_context *context, struct kgsl_drawobj *drawobj[],
+		uint32_t count, uint32_t *timestamp);
+void adreno_dispatcher_issue_cmds(struct kgsl_device *device);
 
 void adreno_dispatcher_schedule(struct kgsl_device *device);
 void adreno_dispatcher_pause(struct adreno_device *adreno_dev);
@@ -221,6 +221,8 @@ static int drawctxt_detach_drawobjs(struct adreno_context *drawctxt,
 		list[count++] = drawobj;
 	}
 
+	WRITE_ONCE(drawctxt->head_deadline, KTIME_MAX);
+
 	return count;
 }
 
@@ -364,6 +366,7 @@ adreno_drawctxt_create(struct kgsl_device_private *dev_priv,
 	drawctxt->base.flags |= KGSL_CONTEXT_PER_CONTEXT_TS;
 	drawctxt->type = (drawctxt->base.flags & KGSL_CONTEXT_TYPE_MASK)
 		>> KGSL_CONTEXT_TYPE_SHIFT;
+	drawctxt->head_deadline = KTIME_MAX;
 	spin_lock_init(&drawctxt->lock);
 	init_waitqueue_head(&drawctxt->wq);
 	init_waitqueue_head(&drawctxt->waiting);
@@ -431,6 +434,44 @@ void adreno_drawctxt_sched(struct kgsl_device *device,
 	adreno_dispatcher_queue_context(device, ADRENO_CONTEXT(context));
 }
 
+/**
+ * adreno_drawctxt_set_frame_budget() - Set the frame budget of a context
+ * @dev_priv: pointer to the KGSL device private structure of the caller
+ * @value: User pointer to a struct kgsl_context_frame_budget
+ * @sizebytes: Size of the user buffer
+ *
+ * Set the time budget for each frame submitted on the context. The deadline
+ * scheduling mode of the dispatcher uses it to order the contexts. A budget of
+ * zero reverts the context to the implicit default deadline.
+ */
+int adreno_drawctxt_set_frame_budget(struct kgsl_device_private *dev_priv,
+		void __user *value, unsigned int sizebytes)
+{
+	struct kgsl_context_frame_budget budget;
+	struct kgsl_context *context;
+	struct adreno_context *drawctxt;
+
+	if (sizebytes != sizeof(budget))
+		return -EINVAL;
+
+	if (copy_from_user(&budget, value, sizeof(budget)))
+		return -EFAULT;
+
+	context = kgsl_context_get_owner(dev_priv, budget.context_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	drawctxt = ADRENO_CONTEXT(context);
+
+	spin_lock(&drawctxt->lock);
+	drawctxt->frame_budget_us = budget.budget_us;
+	drawctxt->frame_deadline = 0;
+	spin_unlock(&drawctxt->lock);
+
+	kgsl_context_put(context);
+	return 0;
+}
+
 /**
  * adreno_drawctxt_detach(): detach a context from the GPU
  * @context: Generic KGSL context container for the context
@@ -43,6 +43,15 @@ struct kgsl_device_private;
  * @submitted_timestamp: The last timestamp that was submitted for this context
  * @active_node: Linkage for nodes in active_list
  * @active_time: Time when this context last seen
+ * @frame_budget_us: Target frame time set by userspace, 0 if none
+ * @frame_deadline: Deadline of the frame currently being queued, 0 if the
+ * next command starts a new frame
+ * @head_deadline: Deadline of the drawobj at the head of the drawqueue
+ * @deadline_frames: Number of frames retired with a frame budget
+ * @deadline_misses: Number of those frames that retired after their deadline
+ * @frame_history: GPU work of the last frames, used to predict the next one
+ * @frame_hinted: True if the power level was already checked against the
+ * prediction for the frame currently being submitted
  */
 struct adreno_context {
 	struct kgsl_context base;
@@ -70,6 +79,14 @@ struct adreno_context {
 
 	struct list_head active_node;
 	unsigned long active_time;
+
+	unsigned int frame_budget_us;
+	ktime_t frame_deadline;
+	ktime_t head_deadline;
+	unsigned long deadline_frames;
+	unsigned long deadline_misses;
+	struct kgsl_pwrscale_frame_history frame_history;
+	bool frame_hinted;
 };
 
 /* Flag definitions for flag field in adreno_context */
@@ -123,6 +140,9 @@ void adreno_drawctxt_invalidate(struct kgsl_device *device,
 void adreno_drawctxt_dump(struct kgsl_device *device,
 		struct kgsl_context *context);
 
+int adreno_drawctxt_set_frame_budget(struct kgsl_device_private *dev_priv,
+		void __user *value, unsigned int sizebytes);
+
 static struct adreno_context_type ctxt_type_table[] = {KGSL_CONTEXT_TYPES};
 
 static inline const char *get_api_type_str(unsigned int type)
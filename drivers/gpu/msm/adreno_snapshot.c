@@ -147,6 +147,9 @@ static int snapshot_freeze_obj_list(struct kgsl_snapshot *snapshot,
 		int index;
 		int freeze = 1;
 
+		if (kgsl_snapshot_over_budget(snapshot))
+			break;
+
 		ib_objs = &(ib_obj_list->obj_list[i]);
 		/* Make sure this object is not going to be saved statically */
 		for (index = 0; index < objbufptr; index++) {
@@ -211,6 +214,10 @@ static inline void parse_ib(struct kgsl_device *device,
 		return;
 	}
 
+	/* Parsing IBs is slow so give up on the rest when out of time */
+	if (kgsl_snapshot_over_budget(snapshot))
+		return;
+
 	if (kgsl_snapshot_have_object(snapshot, process,
 					gpuaddr, dwords << 2))
 		return;
@@ -349,6 +349,48 @@ static int _perfcounter_store(struct adreno_device *adreno_dev,
 	return 0;
 }
 
+static int _deadline_sched_store(struct adreno_device *adreno_dev,
+		unsigned int val)
+{
+	adreno_dev->deadline_sched = val ? true : false;
+	return 0;
+}
+
+static unsigned int _deadline_sched_show(struct adreno_device *adreno_dev)
+{
+	return adreno_dev->deadline_sched;
+}
+
+static ssize_t deadline_stats_show(struct device *dev,
+		struct device_attribute *attr,
+		char *buf)
+{
+	struct kgsl_device *device = dev_get_drvdata(dev);
+	struct kgsl_context *context;
+	struct adreno_context *drawctxt;
+	ssize_t count = 0;
+	int id;
+
+	read_lock(&device->context_lock);
+	idr_for_each_entry(&device->context_idr, context, id) {
+		drawctxt = ADRENO_CONTEXT(context);
+
+		if (!drawctxt->frame_budget_us)
+			continue;
+
+		count += scnprintf(buf + count, PAGE_SIZE - count,
+			"%u %d %u %lu %lu\n", context->id,
+			pid_nr(context->proc_priv->pid),
+			drawctxt->frame_budget_us, drawctxt->deadline_frames,
+			drawctxt->deadline_misses);
+	}
+	read_unlock(&device->context_lock);
+
+	return count;
+}
+
+static DEVICE_ATTR_RO(deadline_stats);
+
 static ssize_t _sysfs_store_u32(struct device *dev,
 		struct device_attribute *attr,
 		const char *buf, size_t count)
@@ -442,6 +484,7 @@ static ADRENO_SYSFS_BOOL(ifpc);
 static ADRENO_SYSFS_RO_U32(ifpc_count);
 static ADRENO_SYSFS_BOOL(acd);
 static ADRENO_SYSFS_BOOL(perfcounter);
+static ADRENO_SYSFS_BOOL(deadline_sched);
 
 
 static const struct attribute *_attr_list[] = {
@@ -465,6 +508,8 @@ static const struct attribute *_attr_list[] = {
 	&adreno_attr_preempt_count.attr.attr,
 	&adreno_attr_acd.attr.attr,
 	&adreno_attr_perfcounter.attr.attr,
+	&adreno_attr_deadline_sched.attr.attr,
+	&dev_attr_deadline_stats.attr,
 	NULL,
 };
 
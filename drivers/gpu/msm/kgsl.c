@@ -519,6 +519,8 @@ static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
 	atomic_sub(entry->memdesc.reclaimed_page_count,
 			&entry->priv->reclaimed_page_count);
 
+	kgsl_reclaim_memdesc_detach(entry->priv, &entry->memdesc);
+
 
 	kgsl_process_private_put(entry->priv);
 
@@ -2029,30 +2031,18 @@ long kgsl_ioctl_submit_commands(struct kgsl_device_private *dev_priv,
 	return result;
 }
 
-long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
-		unsigned int cmd, void *data)
+/*
+ * Create the drawobjs described by a struct kgsl_gpu_command. Returns the
+ * number of drawobjs stored in @drawobj or a negative error code, in which
+ * case any drawobjs that were created have already been destroyed.
+ */
+static int _gpu_command_create(struct kgsl_device_private *dev_priv,
+		struct kgsl_context *context, struct kgsl_gpu_command *param,
+		unsigned int type, bool pin, struct kgsl_drawobj *drawobj[2])
 {
-	struct kgsl_gpu_command *param = data;
 	struct kgsl_device *device = dev_priv->device;
-	struct kgsl_context *context;
-	struct kgsl_drawobj *drawobj[2];
-	unsigned int type;
-	long result;
 	unsigned int i = 0;
-
-	type = _process_command_input(device, param->flags, param->numcmds,
-			param->numobjs, param->numsyncs);
-	if (!type)
-		return -EINVAL;
-
-	context = kgsl_context_get_owner(dev_priv, param->context_id);
-	if (context == NULL)
-		return -EINVAL;
-
-	if (_check_context_is_sparse(context, param->flags)) {
-		kgsl_context_put(context);
-		return -EINVAL;
-	}
+	int result = 0;
 
 	if (type & SYNCOBJ_TYPE) {
 		struct kgsl_drawobj_sync *syncobj =
@@ -2060,7 +2050,7 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 
 		if (IS_ERR(syncobj)) {
 			result = PTR_ERR(syncobj);
-			goto done;
+			goto err;
 		}
 
 		drawobj[i++] = DRAWOBJ(syncobj);
@@ -2069,7 +2059,7 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 				to_user_ptr(param->synclist),
 				param->syncsize, param->numsyncs);
 		if (result)
-			goto done;
+			goto err;
 	}
 
 	if (type & (CMDOBJ_TYPE | MARKEROBJ_TYPE)) {
@@ -2079,7 +2069,7 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 
 		if (IS_ERR(cmdobj)) {
 			result = PTR_ERR(cmdobj);
-			goto done;
+			goto err;
 		}
 
 		drawobj[i++] = DRAWOBJ(cmdobj);
@@ -2088,43 +2078,270 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 			to_user_ptr(param->cmdlist),
 			param->cmdsize, param->numcmds);
 		if (result)
-			goto done;
+			goto err;
 
 		result = kgsl_drawobj_cmd_add_memlist(device, cmdobj,
 			to_user_ptr(param->objlist),
 			param->objsize, param->numobjs);
 		if (result)
-			goto done;
+			goto err;
 
 		/* If no profiling buffer was specified, clear the flag */
 		if (cmdobj->profiling_buf_entry == NULL)
 			DRAWOBJ(cmdobj)->flags &=
 				~(unsigned long)KGSL_DRAWOBJ_PROFILING;
 
-		if (type & CMDOBJ_TYPE) {
+		if (pin && (type & CMDOBJ_TYPE)) {
 			result = kgsl_reclaim_to_pinned_state(
 					dev_priv->process_priv);
 			if (result)
-				goto done;
+				goto err;
 		}
 	}
 
+	return i;
+
+err:
+	while (i--)
+		kgsl_drawobj_destroy(drawobj[i]);
+
+	return result;
+}
+
+long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data)
+{
+	struct kgsl_gpu_command *param = data;
+	struct kgsl_device *device = dev_priv->device;
+	struct kgsl_context *context;
+	struct kgsl_drawobj *drawobj[2];
+	unsigned int type;
+	long result;
+	int count;
+
+	type = _process_command_input(device, param->flags, param->numcmds,
+			param->numobjs, param->numsyncs);
+	if (!type)
+		return -EINVAL;
+
+	context = kgsl_context_get_owner(dev_priv, param->context_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	if (_check_context_is_sparse(context, param->flags)) {
+		kgsl_context_put(context);
+		return -EINVAL;
+	}
+
+	count = _gpu_command_create(dev_priv, context, param, type, true,
+			drawobj);
+	if (count < 0) {
+		kgsl_context_put(context);
+		return count;
+	}
+
 	result = device->ftbl->queue_cmds(dev_priv, context, drawobj,
-				i, &param->timestamp);
+				count, &param->timestamp);
 
-done:
 	/*
 	 * -EPROTO is a "success" error - it just tells the user that the
 	 * context had previously faulted
 	 */
 	if (result && result != -EPROTO)
-		while (i--)
-			kgsl_drawobj_destroy(drawobj[i]);
+		while (count--)
+			kgsl_drawobj_destroy(drawobj[count]);
 
 	kgsl_context_put(context);
 	return result;
 }
 
+/*
+ * Copy in the array of struct kgsl_gpu_command for a batch. If the user
+ * structure matches the kernel one the whole array is copied at once,
+ * otherwise each entry is copied and truncated or zero extended.
+ */
+static int _gpu_command_batch_copy_in(struct kgsl_gpu_command *cmds,
+		void __user *ptr, unsigned int cmdsize, unsigned int numcmds)
+{
+	unsigned int i;
+	int ret;
+
+	if (cmdsize == sizeof(*cmds))
+		return copy_from_user(cmds, ptr, numcmds * sizeof(*cmds)) ?
+			-EFAULT : 0;
+
+	for (i = 0; i < numcmds; i++) {
+		ret = kgsl_copy_from_user(&cmds[i], ptr, sizeof(*cmds),
+			cmdsize);
+		if (ret)
+			return ret;
+
+		ptr += cmdsize;
+	}
+
+	return 0;
+}
+
+/* Per entry state kept between the create and the queue pass of a batch */
+struct gpu_command_batch_entry {
+	struct kgsl_context *context;
+	struct kgsl_drawobj *drawobj[2];
+	unsigned int type;
+	int count;
+};
+
+static void _gpu_command_batch_release(struct gpu_command_batch_entry *entry)
+{
+	while (entry->count > 0)
+		kgsl_drawobj_destroy(entry->drawobj[--entry->count]);
+
+	kgsl_context_put(entry->context);
+}
+
+long kgsl_ioctl_gpu_command_batch(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data)
+{
+	struct kgsl_gpu_command_batch *param = data;
+	struct kgsl_device *device = dev_priv->device;
+	struct kgsl_gpu_command *cmds;
+	struct gpu_command_batch_entry *entries;
+	void __user *ptr = to_user_ptr(param->cmdlist);
+	bool deferred = device->ftbl->queue_cmds_deferred &&
+		device->ftbl->issue_cmds;
+	bool pin = false, faulted = false;
+	long result = 0;
+	unsigned int i;
+
+	param->count = 0;
+
+	if (param->flags || !param->cmdsize || !param->numcmds ||
+		param->numcmds > KGSL_MAX_BATCH_CMDS)
+		return -EINVAL;
+
+	cmds = kvcalloc(param->numcmds, sizeof(*cmds) + sizeof(*entries),
+		GFP_KERNEL);
+	if (cmds == NULL)
+		return -ENOMEM;
+
+	entries = (struct gpu_command_batch_entry *) &cmds[param->numcmds];
+
+	result = _gpu_command_batch_copy_in(cmds, ptr, param->cmdsize,
+		param->numcmds);
+	if (result)
+		goto out;
+
+	/* Validate the whole batch before anything is queued */
+	for (i = 0; i < param->numcmds; i++) {
+		entries[i].type = _process_command_input(device, cmds[i].flags,
+			cmds[i].numcmds, cmds[i].numobjs, cmds[i].numsyncs);
+		if (!entries[i].type ||
+			(cmds[i].flags & KGSL_DRAWOBJ_SPARSE)) {
+			result = -EINVAL;
+			goto out;
+		}
+
+		if (entries[i].type & CMDOBJ_TYPE)
+			pin = true;
+	}
+
+	/* Bring back reclaimed memory once for the whole batch */
+	if (pin) {
+		result = kgsl_reclaim_to_pinned_state(dev_priv->process_priv);
+		if (result)
+			goto out;
+	}
+
+	/*
+	 * Resolve every context and create every drawobj up front so that a
+	 * bad entry anywhere in the list fails the ioctl with nothing queued
+	 */
+	for (i = 0; i < param->numcmds; i++) {
+		struct gpu_command_batch_entry *entry = &entries[i];
+
+		entry->context = kgsl_context_get_owner(dev_priv,
+			cmds[i].context_id);
+		if (entry->context == NULL) {
+			result = -EINVAL;
+			goto release;
+		}
+
+		if (_check_context_is_sparse(entry->context, cmds[i].flags)) {
+			result = -EINVAL;
+			goto release;
+		}
+
+		entry->count = _gpu_command_create(dev_priv, entry->context,
+				&cmds[i], entry->type, false, entry->drawobj);
+		if (entry->count < 0) {
+			result = entry->count;
+			entry->count = 0;
+			goto release;
+		}
+	}
+
+	for (i = 0; i < param->numcmds; i++) {
+		struct gpu_command_batch_entry *entry = &entries[i];
+
+		if (deferred)
+			result = device->ftbl->queue_cmds_deferred(dev_priv,
+				entry->context, entry->drawobj, entry->count,
+				&cmds[i].timestamp);
+		else
+			result = device->ftbl->queue_cmds(dev_priv,
+				entry->context, entry->drawobj, entry->count,
+				&cmds[i].timestamp);
+
+		/* The commands were queued but the context had faulted */
+		if (result == -EPROTO) {
+			faulted = true;
+			result = 0;
+		}
+
+		if (result)
+			goto release;
+
+		/* The drawobjs belong to the dispatcher now */
+		entry->count = 0;
+		kgsl_context_put(entry->context);
+		entry->context = NULL;
+		param->count++;
+
+		/* Return the assigned timestamp to the user */
+		if (copy_to_user(ptr + i * param->cmdsize +
+			offsetof(struct kgsl_gpu_command, timestamp),
+			&cmds[i].timestamp, sizeof(cmds[i].timestamp))) {
+			result = -EFAULT;
+			goto release;
+		}
+	}
+
+release:
+	/* Drop everything that was created but never queued */
+	for (i = 0; i < param->numcmds; i++)
+		if (entries[i].context)
+			_gpu_command_batch_release(&entries[i]);
+
+	/* Kick the dispatcher once for everything that was queued */
+	if (deferred && param->count)
+		device->ftbl->issue_cmds(device);
+
+	/*
+	 * Like a short write, a partially queued batch is a success and count
+	 * tells the user where to resubmit from to find out what went wrong.
+	 * Faulted contexts are reported in the flags instead of with -EPROTO
+	 * so that the count still makes it back to the user.
+	 */
+	if (param->count)
+		result = 0;
+
+	if (faulted)
+		param->flags |= KGSL_GPU_COMMAND_BATCH_FAULT;
+
+out:
+	kvfree(cmds);
+	return result;
+}
+
 long kgsl_ioctl_gpu_aux_command(struct kgsl_device_private *dev_priv,
 		unsigned int cmd, void *data)
 {
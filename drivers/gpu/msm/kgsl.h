@@ -93,6 +93,7 @@ static inline void KGSL_STATS_ADD(uint64_t size, atomic_long_t *stat,
 
 #define KGSL_MAX_NUMIBS 100000
 #define KGSL_MAX_SYNCPOINTS 32
+#define KGSL_MAX_BATCH_CMDS 64
 #define KGSL_MAX_SPARSE 1000
 
 struct kgsl_device;
@@ -158,6 +159,7 @@ extern struct mutex kgsl_mmu_sync;
 
 struct kgsl_pagetable;
 struct kgsl_memdesc;
+struct kgsl_reclaim_cstore;
 
 struct kgsl_memdesc_ops {
 	unsigned int vmflags;
@@ -246,6 +248,10 @@ struct kgsl_memdesc {
 	 * multiple entities trying to map the same SVM region at once
 	 */
 	spinlock_t gpuaddr_lock;
+	/**
+	 * @cstore: Compressed copy of the pages reclaimed in compressed mode
+	 */
+	struct kgsl_reclaim_cstore *cstore;
 };
 
 /*
@@ -431,6 +437,8 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 				unsigned int cmd, void *data);
 long kgsl_ioctl_gpuobj_set_info(struct kgsl_device_private *dev_priv,
 				unsigned int cmd, void *data);
+long kgsl_ioctl_gpu_command_batch(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data);
 long kgsl_ioctl_gpu_aux_command(struct kgsl_device_private *dev_priv,
 		unsigned int cmd, void *data);
 long kgsl_ioctl_timeline_create(struct kgsl_device_private *dev_priv,
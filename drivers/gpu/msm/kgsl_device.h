@@ -185,6 +185,16 @@ struct kgsl_functable {
 	int (*query_property_list)(struct kgsl_device *device, u32 *list,
 		u32 count);
 	bool (*is_hwcg_on)(struct kgsl_device *device);
+	/**
+	 * @queue_cmds_deferred: Like queue_cmds but do not kick the
+	 * dispatcher. Must be paired with @issue_cmds once the caller has
+	 * queued all of its commands.
+	 */
+	int (*queue_cmds_deferred)(struct kgsl_device_private *dev_priv,
+		struct kgsl_context *context, struct kgsl_drawobj *drawobj[],
+		uint32_t count, uint32_t *timestamp);
+	/** @issue_cmds: Kick the dispatcher after deferred submissions */
+	void (*issue_cmds)(struct kgsl_device *device);
 };
 
 struct kgsl_ioctl {
@@ -302,6 +312,12 @@ struct kgsl_device {
 	bool snapshot_crashdumper;
 	/* Use HOST side register reads to get GPU snapshot*/
 	bool snapshot_legacy;
+	/* Time budget for a whole snapshot in ms, 0 for no limit */
+	u32 snapshot_budget_ms;
+	/* Time budget for each snapshot section in us, 0 for no limit */
+	u32 snapshot_section_budget_us;
+	/* Let readers stream the snapshot while IB objects are saved */
+	bool snapshot_stream;
 
 	struct kobject snapshot_kobj;
 
@@ -486,6 +502,22 @@ struct kgsl_process_private {
 	 * @cmd_count: The number of cmds that are active for the process
 	 */
 	atomic_t cmd_count;
+	/**
+	 * @compressed_page_count: The number of reclaimed pages held compressed
+	 */
+	atomic_t compressed_page_count;
+	/**
+	 * @compressed_size: Bytes used by the compressed reclaimed pages
+	 */
+	atomic_long_t compressed_size;
+	/**
+	 * @restore_latency_us: Duration of the last restore to pinned state
+	 */
+	u64 restore_latency_us;
+	/**
+	 * @restore_latency_max_us: Longest restore to pinned state
+	 */
+	u64 restore_latency_max_us;
 };
 
 /**
@@ -515,7 +547,8 @@ struct kgsl_device_private {
  * @remain: Bytes left in the snapshot region
  * @timestamp: Timestamp of the snapshot instance (in seconds since boot)
  * @mempool: Pointer to the memory pool for storing memory objects
- * @mempool_size: Size of the memory pool
+ * @mempool_size: Size of the memory pool. Published as the worker fills the
+ * pool so that streaming readers can copy out the objects saved so far
  * @obj_list: List of frozen GPU buffers that are waiting to be dumped.
  * @cp_list: List of IB's to be dumped.
  * @work: worker to dump the frozen memory
@@ -525,6 +558,14 @@ struct kgsl_device_private {
  * @first_read: True until the snapshot read is started
  * @gmu_fault: Snapshot collected when GMU fault happened
  * @recovered: True if GPU was recovered after previous snapshot
+ * @device: Device that the snapshot was taken on
+ * @deadline: Time by which the snapshot has to finish, 0 for no limit
+ * @section_deadline: Time by which the current section has to finish
+ * @skipped: Number of sections skipped because the snapshot ran out of time
+ * @slowest_id: Identifier of the section that took the longest to dump
+ * @slowest_us: Time taken by the slowest section in us
+ * @elapsed_us: Total time taken to build the snapshot in us
+ * @stream_wq: Wait queue for streaming readers waiting for the worker
  */
 struct kgsl_snapshot {
 	uint64_t ib1base;
@@ -550,6 +591,13 @@ struct kgsl_snapshot {
 	bool gmu_fault;
 	bool recovered;
 	struct kgsl_device *device;
+	ktime_t deadline;
+	ktime_t section_deadline;
+	unsigned int skipped;
+	u16 slowest_id;
+	s64 slowest_us;
+	s64 elapsed_us;
+	wait_queue_head_t stream_wq;
 };
 
 /**
@@ -947,6 +995,8 @@ void kgsl_snapshot_add_section(struct kgsl_device *device, u16 id,
 	size_t (*func)(struct kgsl_device *, u8 *, size_t, void *),
 	void *priv);
 
+bool kgsl_snapshot_over_budget(struct kgsl_snapshot *snapshot);
+
 /**
  * kgsl_of_property_read_ddrtype - Get property from devicetree based on
  * the type of DDR.
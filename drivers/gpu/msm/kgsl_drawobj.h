@@ -71,6 +71,9 @@ struct kgsl_drawobj {
  * for easy access
  * @profile_index: Index to store the start/stop ticks in the kernel profiling
  * buffer
+ * @deadline: Time by which the command should retire, used by the deadline
+ * scheduling mode of the dispatcher
+ * @submit_time: Time at which the command was submitted to the ringbuffer
 
  */
 struct kgsl_drawobj_cmd {
@@ -85,6 +88,8 @@ struct kgsl_drawobj_cmd {
 	struct kgsl_mem_entry *profiling_buf_entry;
 	uint64_t profiling_buffer_gpuaddr;
 	unsigned int profile_index;
+	ktime_t deadline;
+	ktime_t submit_time;
 };
 
 /**
@@ -99,6 +99,8 @@ static const struct kgsl_ioctl kgsl_ioctl_funcs[] = {
 			kgsl_ioctl_timeline_signal),
 	KGSL_IOCTL_FUNC(IOCTL_KGSL_TIMELINE_DESTROY,
 			kgsl_ioctl_timeline_destroy),
+	KGSL_IOCTL_FUNC(IOCTL_KGSL_GPU_COMMAND_BATCH,
+			kgsl_ioctl_gpu_command_batch),
 };
 
 long kgsl_ioctl_copy_in(unsigned int kernel_cmd, unsigned int user_cmd,
@@ -171,7 +173,8 @@ static long __kgsl_ioctl(struct file *filep, unsigned int cmd,
 	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
 	long ret;
 
-	if (cmd == IOCTL_KGSL_GPU_COMMAND &&
+	if ((cmd == IOCTL_KGSL_GPU_COMMAND ||
+		cmd == IOCTL_KGSL_GPU_COMMAND_BATCH) &&
 	    READ_ONCE(device->state) != KGSL_STATE_ACTIVE)
 		kgsl_schedule_work(&adreno_dev->pwr_on_work);
 
@@ -6,18 +6,52 @@
 
 #include <asm/cacheflush.h>
 #include <linux/highmem.h>
+#include <linux/kthread.h>
 #include <linux/of.h>
+#include <linux/percpu.h>
 #include <linux/scatterlist.h>
 #include <linux/swap.h>
 
 #include "kgsl_device.h"
 #include "kgsl_pool.h"
 #include "kgsl_sharedmem.h"
+#include "kgsl_trace.h"
 
 #define KGSL_MAX_POOLS 4
 #define KGSL_MAX_POOL_ORDER 8
 #define KGSL_MAX_RESERVED_PAGES 4096
 
+/*
+ * Upper bound on the number of 4K pages a single per-CPU magazine may cache
+ * for one pool and on the number of entries it may hold. Orders large enough
+ * that not even one entry fits bypass the magazine and use the shared list.
+ */
+#define KGSL_POOL_MAG_PAGES 128
+#define KGSL_POOL_MAG_MAX 16
+
+/* Time to hold off the background refill after the shrinker ran */
+#define KGSL_POOL_REFILL_BACKOFF_MS 1000
+
+/**
+ * struct kgsl_pool_magazine - Per-CPU page cache in front of a pool
+ * @lock: Protects the magazine. Only contended when another CPU drains it
+ * @count: Number of pages currently held in the magazine
+ * @hits: Allocations served directly from the magazine
+ * @misses: Allocations that found the magazine empty
+ * @refills: Bulk transfers from the shared pool into the magazine
+ * @drains: Bulk transfers from the magazine back to the shared pool
+ * @pages: Cached pages
+ */
+struct kgsl_pool_magazine {
+	spinlock_t lock;
+	unsigned int count;
+	u64 hits;
+	u64 misses;
+	u64 refills;
+	u64 drains;
+	struct page *pages[KGSL_POOL_MAG_MAX];
+};
+
 /**
  * struct kgsl_page_pool - Structure to hold information for the pool
  * @pool_order: Page order describing the size of the page
@@ -28,6 +62,16 @@
  * @max_pages: Limit on number of pages this pool can hold
  * @list_lock: Spinlock for page list in the pool
  * @page_list: List of pages held/reserved in this pool
+ * @mag_size: Number of entries in each per-CPU magazine, 0 if disabled
+ * @mag_batch: Number of pages moved per magazine refill or drain
+ * @mag: Per-CPU magazines caching pages of this pool
+ * @refill_watermark: Number of pages the background refill keeps the pool
+ * topped up to, 0 if the pool is not refilled
+ * @refilled: Number of pages added to the pool by the background refill
+ * @kobj: Kobject for the pool statistics in sysfs
+ *
+ * @page_count includes the pages parked in the per-CPU magazines so that
+ * the pool limits and the shrinker see the full footprint of the pool.
  */
 struct kgsl_page_pool {
 	unsigned int pool_order;
@@ -37,11 +81,24 @@ struct kgsl_page_pool {
 	unsigned int max_pages;
 	spinlock_t list_lock;
 	struct llist_head page_list;
+	unsigned int mag_size;
+	unsigned int mag_batch;
+	struct kgsl_pool_magazine __percpu *mag;
+	unsigned int refill_watermark;
+	atomic_long_t refilled;
+	struct kobject kobj;
 };
 
 static struct kgsl_page_pool kgsl_pools[KGSL_MAX_POOLS];
 static int kgsl_num_pools;
 static int kgsl_pool_max_pages;
+static struct kobject *kgsl_pools_kobj;
+
+/* Background worker that keeps the pools stocked with zeroed pages */
+static struct kthread_worker *kgsl_pool_refill_worker;
+static struct kthread_work kgsl_pool_refill_work;
+/* Jiffies of the last shrinker scan, used to back off the refill */
+static unsigned long kgsl_pool_shrink_time;
 
 
 /* Returns KGSL pool corresponding to input page order*/
@@ -58,10 +115,118 @@ _kgsl_get_pool_from_order(unsigned int order)
 	return NULL;
 }
 
+/* Push a page onto the shared list of the pool */
+static void
+__kgsl_pool_list_add(struct kgsl_page_pool *pool, struct page *p)
+{
+	llist_add((struct llist_node *)&p->lru, &pool->page_list);
+}
+
+/* Pop a page from the shared list of the pool. Caller holds list_lock */
+static struct page *
+__kgsl_pool_list_del(struct kgsl_page_pool *pool)
+{
+	struct llist_node *node = llist_del_first(&pool->page_list);
+
+	if (!node)
+		return NULL;
+
+	return container_of((struct list_head *)node, struct page, lru);
+}
+
+/*
+ * Move up to mag_batch pages from the shared list into an empty magazine
+ * under a single acquisition of the pool lock. Caller holds the magazine
+ * lock.
+ */
+static void
+_kgsl_pool_mag_refill(struct kgsl_page_pool *pool,
+		struct kgsl_pool_magazine *mag)
+{
+	struct page *p;
+
+	spin_lock(&pool->list_lock);
+	while (mag->count < pool->mag_batch) {
+		p = __kgsl_pool_list_del(pool);
+		if (!p)
+			break;
+		mag->pages[mag->count++] = p;
+	}
+	spin_unlock(&pool->list_lock);
+
+	if (mag->count)
+		mag->refills++;
+}
+
+/*
+ * Give nr_pages pages from the top of the magazine back to the shared list
+ * with a single batched llist insertion. Caller holds the magazine lock.
+ */
+static void
+_kgsl_pool_mag_drain(struct kgsl_page_pool *pool,
+		struct kgsl_pool_magazine *mag, unsigned int nr_pages)
+{
+	struct llist_node *first, *last;
+	unsigned int i;
+
+	if (!nr_pages)
+		return;
+
+	first = last = (struct llist_node *)&mag->pages[--mag->count]->lru;
+	for (i = 1; i < nr_pages; i++) {
+		struct llist_node *node =
+			(struct llist_node *)&mag->pages[--mag->count]->lru;
+
+		last->next = node;
+		last = node;
+	}
+
+	llist_add_batch(first, last, &pool->page_list);
+	mag->drains++;
+}
+
+/* Drain the magazines of all CPUs back to the shared list of the pool */
+static void
+kgsl_pool_drain_magazines(struct kgsl_page_pool *pool)
+{
+	int cpu;
+
+	if (!pool->mag)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct kgsl_pool_magazine *mag = per_cpu_ptr(pool->mag, cpu);
+
+		spin_lock(&mag->lock);
+		_kgsl_pool_mag_drain(pool, mag, mag->count);
+		spin_unlock(&mag->lock);
+	}
+}
+
+/* Update the pool accounting for a page entering the pool */
+static void
+_kgsl_pool_page_added(struct kgsl_page_pool *pool, struct page *p)
+{
+	atomic_inc(&pool->page_count);
+	mod_node_page_state(page_pgdat(p), NR_KERNEL_MISC_RECLAIMABLE,
+			    (1 << pool->pool_order));
+}
+
+/* Update the pool accounting for a page leaving the pool */
+static void
+_kgsl_pool_page_removed(struct kgsl_page_pool *pool, struct page *p)
+{
+	atomic_dec(&pool->page_count);
+	mod_node_page_state(page_pgdat(p), NR_KERNEL_MISC_RECLAIMABLE,
+			    -(1 << pool->pool_order));
+}
+
 /* Add a page to specified pool */
 static void
 _kgsl_pool_add_page(struct kgsl_page_pool *pool, struct page *p)
 {
+	struct kgsl_pool_magazine *mag;
+
 	/*
 	 * Sanity check to make sure we don't re-pool a page that
 	 * somebody else has a reference to.
@@ -73,30 +238,66 @@ _kgsl_pool_add_page(struct kgsl_page_pool *pool, struct page *p)
 
 	kgsl_zero_page(p, pool->pool_order);
 
-	llist_add((struct llist_node *)&p->lru, &pool->page_list);
-	atomic_inc(&pool->page_count);
-	mod_node_page_state(page_pgdat(p), NR_KERNEL_MISC_RECLAIMABLE,
-			    (1 << pool->pool_order));
+	if (pool->mag) {
+		/*
+		 * The magazine lock makes it safe to be migrated after
+		 * picking the magazine, so preemption can stay enabled.
+		 */
+		mag = raw_cpu_ptr(pool->mag);
+
+		spin_lock(&mag->lock);
+		if (mag->count == pool->mag_size)
+			_kgsl_pool_mag_drain(pool, mag, pool->mag_batch);
+		mag->pages[mag->count++] = p;
+		spin_unlock(&mag->lock);
+	} else
+		__kgsl_pool_list_add(pool, p);
+
+	_kgsl_pool_page_added(pool, p);
+}
+
+/*
+ * Add a freshly allocated page straight to the shared list of the pool so
+ * that it is available to every CPU rather than to the caller's magazine.
+ */
+static void
+_kgsl_pool_stock_page(struct kgsl_page_pool *pool, struct page *p)
+{
+	kgsl_zero_page(p, pool->pool_order);
+	__kgsl_pool_list_add(pool, p);
+	_kgsl_pool_page_added(pool, p);
 }
 
 /* Returns a page from specified pool */
 static struct page *
 _kgsl_pool_get_page(struct kgsl_page_pool *pool)
 {
-	struct llist_node *node;
+	struct kgsl_pool_magazine *mag;
 	struct page *p = NULL;
 
-	spin_lock(&pool->list_lock);
-	node = llist_del_first(&pool->page_list);
-	spin_unlock(&pool->list_lock);
+	if (pool->mag) {
+		mag = raw_cpu_ptr(pool->mag);
+
+		spin_lock(&mag->lock);
+		if (mag->count) {
+			mag->hits++;
+		} else {
+			mag->misses++;
+			_kgsl_pool_mag_refill(pool, mag);
+		}
 
-	if (node) {
-		atomic_dec(&pool->page_count);
-		p = container_of((struct list_head *)node, typeof(*p), lru);
-		mod_node_page_state(page_pgdat(p),
-				    NR_KERNEL_MISC_RECLAIMABLE,
-				    -(1 << pool->pool_order));
+		if (mag->count)
+			p = mag->pages[--mag->count];
+		spin_unlock(&mag->lock);
+	} else {
+		spin_lock(&pool->list_lock);
+		p = __kgsl_pool_list_del(pool);
+		spin_unlock(&pool->list_lock);
 	}
+
+	if (p)
+		_kgsl_pool_page_removed(pool, p);
+
 	return p;
 }
 
@@ -131,10 +332,18 @@ _kgsl_pool_shrink(struct kgsl_page_pool *pool, int num_pages)
 	if (pool == NULL || num_pages <= 0)
 		return pcount;
 
+	/* Make the pages cached on each CPU visible to the shrinker */
+	kgsl_pool_drain_magazines(pool);
+
 	for (j = 0; j < num_pages >> pool->pool_order; j++) {
-		struct page *page = _kgsl_pool_get_page(pool);
+		struct page *page;
+
+		spin_lock(&pool->list_lock);
+		page = __kgsl_pool_list_del(pool);
+		spin_unlock(&pool->list_lock);
 
 		if (page != NULL) {
+			_kgsl_pool_page_removed(pool, page);
 			__free_pages(page, pool->pool_order);
 			pcount += (1 << pool->pool_order);
 		} else {
@@ -246,6 +455,70 @@ static int kgsl_pool_get_retry_order(unsigned int order)
 	return 0;
 }
 
+/* Return true if the shrinker asked the pools to give memory back recently */
+static bool kgsl_pool_under_pressure(void)
+{
+	unsigned long last = READ_ONCE(kgsl_pool_shrink_time);
+
+	return last && time_before(jiffies,
+		last + msecs_to_jiffies(KGSL_POOL_REFILL_BACKOFF_MS));
+}
+
+/* Return true if the pool is below its refill watermark */
+static bool kgsl_pool_needs_refill(struct kgsl_page_pool *pool)
+{
+	if (atomic_read(&pool->page_count) >= pool->refill_watermark)
+		return false;
+
+	return !kgsl_pool_max_pages ||
+		(kgsl_pool_size_total() < kgsl_pool_max_pages);
+}
+
+/* Schedule the background refill if the pool dropped below its watermark */
+static void kgsl_pool_kick_refill(struct kgsl_page_pool *pool)
+{
+	if (!kgsl_pool_refill_worker || !kgsl_pool_needs_refill(pool))
+		return;
+
+	if (kgsl_pool_under_pressure())
+		return;
+
+	kthread_queue_work(kgsl_pool_refill_worker, &kgsl_pool_refill_work);
+}
+
+/*
+ * Allocate, zero and flush pages for each refillable pool until it reaches
+ * its watermark. The allocations never enter direct reclaim so the refill
+ * cannot itself create memory pressure, and the loop bails out as soon as
+ * the shrinker reports that the system wants memory back.
+ */
+static void kgsl_pool_refill_fn(struct kthread_work *work)
+{
+	int i;
+
+	for (i = 0; i < kgsl_num_pools; i++) {
+		struct kgsl_page_pool *pool = &kgsl_pools[i];
+		gfp_t gfp_mask = (kgsl_gfp_mask(pool->pool_order) |
+			__GFP_NOWARN) & ~__GFP_DIRECT_RECLAIM;
+
+		while (kgsl_pool_needs_refill(pool)) {
+			struct page *page;
+
+			if (kgsl_pool_under_pressure())
+				return;
+
+			page = alloc_pages(gfp_mask, pool->pool_order);
+			if (!page)
+				break;
+
+			_kgsl_pool_stock_page(pool, page);
+			atomic_long_inc(&pool->refilled);
+
+			cond_resched();
+		}
+	}
+}
+
 /**
  * kgsl_pool_alloc_page() - Allocate a page of requested size
  * @page_size: Size of the page to be allocated
@@ -313,6 +586,11 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 	pool_idx = kgsl_pool_idx_lookup(order);
 	page = _kgsl_pool_get_page(pool);
 
+	trace_kgsl_pool_alloc_page(order, page != NULL,
+		atomic_read(&pool->page_count));
+
+	kgsl_pool_kick_refill(pool);
+
 	/* Allocate a new page if not allocated from pool */
 	if (page == NULL) {
 		gfp_t gfp_mask = kgsl_gfp_mask(order);
@@ -417,7 +695,7 @@ static void kgsl_pool_reserve_pages(void)
 
 			page = alloc_pages(gfp_mask, order);
 			if (page != NULL)
-				_kgsl_pool_add_page(&kgsl_pools[i], page);
+				_kgsl_pool_stock_page(&kgsl_pools[i], page);
 		}
 	}
 }
@@ -436,6 +714,9 @@ kgsl_pool_shrink_scan_objects(struct shrinker *shrinker,
 	/* Target pages represents new  pool size */
 	int target_pages = (nr > total_pages) ? 0 : (total_pages - nr);
 
+	/* Hold off the background refill while the system needs memory */
+	WRITE_ONCE(kgsl_pool_shrink_time, jiffies);
+
 	/* Reduce pool size to target_pages */
 	ret = kgsl_pool_reduce(target_pages, false);
 
@@ -462,8 +743,50 @@ static struct shrinker kgsl_pool_shrinker = {
 	.batch = 0,
 };
 
-static void kgsl_pool_config(unsigned int order, unsigned int reserved_pages,
+/* Set up the per-CPU magazines of a pool, if its order allows them */
+static void kgsl_pool_init_magazines(struct kgsl_page_pool *pool)
+{
+	int cpu;
+
+	pool->mag_size = min_t(unsigned int,
+			KGSL_POOL_MAG_PAGES >> pool->pool_order,
+			KGSL_POOL_MAG_MAX);
+	if (!pool->mag_size)
+		return;
+
+	pool->mag = alloc_percpu(struct kgsl_pool_magazine);
+	if (!pool->mag) {
+		pool->mag_size = 0;
+		return;
+	}
+
+	pool->mag_batch = max_t(unsigned int, pool->mag_size >> 1, 1);
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(pool->mag, cpu)->lock);
+}
+
+/*
+ * Pick the level the background refill keeps the pool at. Pools that may
+ * not allocate from the system once their reservation is gone are never
+ * refilled. The watermark stays below max_pages so that freed pages can
+ * still be returned to the pool.
+ */
+static unsigned int kgsl_pool_refill_watermark(unsigned int refill_pages,
 		bool allocation_allowed, unsigned int max_pages)
+{
+	if (!allocation_allowed || !max_pages)
+		return 0;
+
+	if (refill_pages >= max_pages)
+		refill_pages = max_pages - DIV_ROUND_UP(max_pages, 4);
+
+	return refill_pages;
+}
+
+static void kgsl_pool_config(unsigned int order, unsigned int reserved_pages,
+		bool allocation_allowed, unsigned int max_pages,
+		unsigned int refill_pages)
 {
 #ifdef CONFIG_ALLOC_BUFFERS_IN_4K_CHUNKS
 	if (order > 0) {
@@ -479,8 +802,12 @@ static void kgsl_pool_config(unsigned int order, unsigned int reserved_pages,
 	kgsl_pools[kgsl_num_pools].reserved_pages = reserved_pages;
 	kgsl_pools[kgsl_num_pools].allocation_allowed = allocation_allowed;
 	kgsl_pools[kgsl_num_pools].max_pages = max_pages;
+	kgsl_pools[kgsl_num_pools].refill_watermark =
+		kgsl_pool_refill_watermark(refill_pages, allocation_allowed,
+			max_pages);
 	spin_lock_init(&kgsl_pools[kgsl_num_pools].list_lock);
 	init_llist_head(&kgsl_pools[kgsl_num_pools].page_list);
+	kgsl_pool_init_magazines(&kgsl_pools[kgsl_num_pools]);
 	kgsl_num_pools++;
 }
 
@@ -488,6 +815,7 @@ static void kgsl_of_parse_mempools(struct device_node *node)
 {
 	struct device_node *child;
 	unsigned int page_size, reserved_pages = 0, max_pages = UINT_MAX;
+	unsigned int refill_pages;
 	bool allocation_allowed;
 
 	for_each_child_of_node(node, child) {
@@ -512,8 +840,13 @@ static void kgsl_of_parse_mempools(struct device_node *node)
 		of_property_read_u32(child, "qcom,mempool-max-pages",
 				&max_pages);
 
+		/* Refill back up to the reserved level unless told otherwise */
+		refill_pages = reserved_pages;
+		of_property_read_u32(child, "qcom,mempool-refill-pages",
+				&refill_pages);
+
 		kgsl_pool_config(ilog2(page_size >> PAGE_SHIFT), reserved_pages,
-				allocation_allowed, max_pages);
+				allocation_allowed, max_pages, refill_pages);
 	}
 }
 
@@ -543,6 +876,223 @@ static void kgsl_of_get_mempools(struct device_node *parent)
 	}
 }
 
+/**
+ * struct kgsl_pool_attribute - Sysfs attribute for a page pool
+ * @attr: Underlying struct attribute
+ * @show: Attribute show function
+ * @store: Attribute store function
+ */
+struct kgsl_pool_attribute {
+	struct attribute attr;
+	ssize_t (*show)(struct kgsl_page_pool *pool, char *buf);
+	ssize_t (*store)(struct kgsl_page_pool *pool, const char *buf,
+		size_t count);
+};
+
+#define POOL_ATTR(_name) \
+	static struct kgsl_pool_attribute pool_attr_##_name = \
+		__ATTR(_name, 0444, _name##_show, NULL)
+
+#define POOL_ATTR_RW(_name) \
+	static struct kgsl_pool_attribute pool_attr_##_name = \
+		__ATTR(_name, 0644, _name##_show, _name##_store)
+
+/* Sum a magazine counter across all CPUs */
+#define POOL_MAG_STAT(_pool, _field) \
+({ \
+	u64 __val = 0; \
+	int __cpu; \
+	if ((_pool)->mag) \
+		for_each_possible_cpu(__cpu) \
+			__val += per_cpu_ptr((_pool)->mag, __cpu)->_field; \
+	__val; \
+})
+
+static ssize_t page_count_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%d\n",
+		atomic_read(&pool->page_count));
+}
+
+static ssize_t max_pages_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", pool->max_pages);
+}
+
+static ssize_t magazine_size_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", pool->mag_size);
+}
+
+static ssize_t magazine_hits_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+		POOL_MAG_STAT(pool, hits));
+}
+
+static ssize_t magazine_misses_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+		POOL_MAG_STAT(pool, misses));
+}
+
+static ssize_t magazine_refills_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+		POOL_MAG_STAT(pool, refills));
+}
+
+static ssize_t magazine_drains_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+		POOL_MAG_STAT(pool, drains));
+}
+
+static ssize_t refill_watermark_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", pool->refill_watermark);
+}
+
+static ssize_t refill_watermark_store(struct kgsl_page_pool *pool,
+		const char *buf, size_t count)
+{
+	unsigned int val;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	pool->refill_watermark = kgsl_pool_refill_watermark(val,
+		pool->allocation_allowed, pool->max_pages);
+	kgsl_pool_kick_refill(pool);
+
+	return count;
+}
+
+static ssize_t refilled_show(struct kgsl_page_pool *pool, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%ld\n",
+		atomic_long_read(&pool->refilled));
+}
+
+POOL_ATTR(page_count);
+POOL_ATTR(max_pages);
+POOL_ATTR(magazine_size);
+POOL_ATTR(magazine_hits);
+POOL_ATTR(magazine_misses);
+POOL_ATTR(magazine_refills);
+POOL_ATTR(magazine_drains);
+POOL_ATTR_RW(refill_watermark);
+POOL_ATTR(refilled);
+
+static struct attribute *pool_attrs[] = {
+	&pool_attr_page_count.attr,
+	&pool_attr_max_pages.attr,
+	&pool_attr_magazine_size.attr,
+	&pool_attr_magazine_hits.attr,
+	&pool_attr_magazine_misses.attr,
+	&pool_attr_magazine_refills.attr,
+	&pool_attr_magazine_drains.attr,
+	&pool_attr_refill_watermark.attr,
+	&pool_attr_refilled.attr,
+	NULL,
+};
+
+static ssize_t pool_sysfs_show(struct kobject *kobj,
+		struct attribute *attr, char *buf)
+{
+	struct kgsl_page_pool *pool =
+		container_of(kobj, struct kgsl_page_pool, kobj);
+	struct kgsl_pool_attribute *pattr =
+		container_of(attr, struct kgsl_pool_attribute, attr);
+
+	return pattr->show(pool, buf);
+}
+
+static ssize_t pool_sysfs_store(struct kobject *kobj,
+		struct attribute *attr, const char *buf, size_t count)
+{
+	struct kgsl_page_pool *pool =
+		container_of(kobj, struct kgsl_page_pool, kobj);
+	struct kgsl_pool_attribute *pattr =
+		container_of(attr, struct kgsl_pool_attribute, attr);
+
+	if (!pattr->store)
+		return -EIO;
+
+	return pattr->store(pool, buf, count);
+}
+
+static const struct sysfs_ops pool_sysfs_ops = {
+	.show = pool_sysfs_show,
+	.store = pool_sysfs_store,
+};
+
+static struct kobj_type ktype_pool = {
+	.sysfs_ops = &pool_sysfs_ops,
+	.default_attrs = pool_attrs,
+};
+
+/*
+ * Export the statistics of each pool under /sys/class/kgsl/kgsl/page_pools,
+ * one directory per pool named after its page size in bytes.
+ */
+static void kgsl_pool_init_sysfs(void)
+{
+	int i;
+
+	kgsl_pools_kobj = kobject_create_and_add("page_pools",
+			&kgsl_driver.virtdev.kobj);
+	if (!kgsl_pools_kobj)
+		return;
+
+	for (i = 0; i < kgsl_num_pools; i++)
+		WARN_ON(kobject_init_and_add(&kgsl_pools[i].kobj, &ktype_pool,
+			kgsl_pools_kobj, "%lu",
+			PAGE_SIZE << kgsl_pools[i].pool_order));
+}
+
+static void kgsl_pool_uninit_sysfs(void)
+{
+	int i;
+
+	if (!kgsl_pools_kobj)
+		return;
+
+	for (i = 0; i < kgsl_num_pools; i++)
+		kobject_put(&kgsl_pools[i].kobj);
+
+	kobject_put(kgsl_pools_kobj);
+	kgsl_pools_kobj = NULL;
+}
+
+/* Start the low priority worker that refills the pools in the background */
+static void kgsl_pool_init_refill(void)
+{
+	struct kthread_worker *worker;
+	int i;
+
+	for (i = 0; i < kgsl_num_pools; i++)
+		if (kgsl_pools[i].allocation_allowed)
+			break;
+
+	/* Nothing to do if no pool can ever be refilled */
+	if (i == kgsl_num_pools)
+		return;
+
+	kthread_init_work(&kgsl_pool_refill_work, kgsl_pool_refill_fn);
+
+	worker = kthread_create_worker(0, "kgsl_pool_refill");
+	if (IS_ERR(worker)) {
+		pr_err("kgsl: unable to start pool refill thread\n");
+		return;
+	}
+
+	set_user_nice(worker->task, MAX_NICE);
+	kgsl_pool_refill_worker = worker;
+}
+
 void kgsl_init_page_pools(struct kgsl_device *device)
 {
 	if (device->flags & KGSL_FLAG_USE_SHMEM)
@@ -556,14 +1106,32 @@ void kgsl_init_page_pools(struct kgsl_device *device)
 
 	/* Initialize shrinker */
 	register_shrinker(&kgsl_pool_shrinker);
+
+	kgsl_pool_init_refill();
+
+	kgsl_pool_init_sysfs();
 }
 
 void kgsl_exit_page_pools(void)
 {
+	int i;
+
+	kgsl_pool_uninit_sysfs();
+
+	if (kgsl_pool_refill_worker) {
+		kthread_destroy_worker(kgsl_pool_refill_worker);
+		kgsl_pool_refill_worker = NULL;
+	}
+
 	/* Release all pages in pools, if any.*/
 	kgsl_pool_reduce(0, true);
 
 	/* Unregister shrinker */
 	unregister_shrinker(&kgsl_pool_shrinker);
+
+	for (i = 0; i < kgsl_num_pools; i++) {
+		free_percpu(kgsl_pools[i].mag);
+		kgsl_pools[i].mag = NULL;
+	}
 }
 
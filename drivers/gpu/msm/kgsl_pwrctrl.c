@@ -1435,6 +1435,46 @@ static ssize_t temp_show(struct device *dev,
 			max_temp);
 }
 
+static ssize_t predict_dcvs_store(struct device *dev,
+			struct device_attribute *attr,
+			const char *buf, size_t count)
+{
+	struct kgsl_device *device = dev_get_drvdata(dev);
+	unsigned int enable = 0;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &enable);
+	if (ret)
+		return ret;
+
+	device->pwrscale.predict_enable = enable ? true : false;
+
+	return count;
+}
+
+static ssize_t predict_dcvs_show(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct kgsl_device *device = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+		device->pwrscale.predict_enable);
+}
+
+static ssize_t predict_stats_show(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct kgsl_device *device = dev_get_drvdata(dev);
+	struct kgsl_pwrscale *psc = &device->pwrscale;
+	u64 frames = psc->predict_frames;
+
+	return scnprintf(buf, PAGE_SIZE,
+		"frames: %llu\nunder: %llu\nover: %llu\navg_error_pct: %llu\nboosts: %llu\n",
+		frames, psc->predict_under, psc->predict_over,
+		frames ? div64_u64(psc->predict_err_pct, frames) : 0,
+		psc->predict_boosts);
+}
+
 static ssize_t pwrscale_store(struct device *dev,
 			struct device_attribute *attr,
 			const char *buf, size_t count)
@@ -1493,6 +1533,8 @@ static DEVICE_ATTR_RW(max_clock_mhz);
 static DEVICE_ATTR_RO(clock_mhz);
 static DEVICE_ATTR_RO(freq_table_mhz);
 static DEVICE_ATTR_RW(pwrscale);
+static DEVICE_ATTR_RW(predict_dcvs);
+static DEVICE_ATTR_RO(predict_stats);
 
 static const struct attribute *pwrctrl_attr_list[] = {
 	&dev_attr_gpuclk.attr,
@@ -1520,6 +1562,8 @@ static const struct attribute *pwrctrl_attr_list[] = {
 	&dev_attr_freq_table_mhz.attr,
 	&dev_attr_temp.attr,
 	&dev_attr_pwrscale.attr,
+	&dev_attr_predict_dcvs.attr,
+	&dev_attr_predict_stats.attr,
 	NULL,
 };
 
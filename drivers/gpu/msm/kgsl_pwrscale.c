@@ -259,6 +259,119 @@ void kgsl_pwrscale_enable(struct kgsl_device *device)
 }
 EXPORT_SYMBOL(kgsl_pwrscale_enable);
 
+/**
+ * kgsl_pwrscale_frame_work() - Account GPU work to the current frame
+ * @device: The device
+ * @hist: Frame history of the context that did the work
+ * @busy_us: Time in microseconds the GPU was busy with the work
+ *
+ * Convert the busy time to cycles at the current frequency so that frames
+ * run at different power levels can be compared.
+ */
+void kgsl_pwrscale_frame_work(struct kgsl_device *device,
+		struct kgsl_pwrscale_frame_history *hist, s64 busy_us)
+{
+	unsigned long mhz = kgsl_pwrctrl_active_freq(&device->pwrctrl) /
+		1000000;
+
+	if (busy_us > 0)
+		hist->frame_cycles += (u64) busy_us * mhz;
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame_work);
+
+/**
+ * kgsl_pwrscale_frame_end() - Close the current frame of a context
+ * @device: The device
+ * @hist: Frame history of the context
+ *
+ * Record the work of the frame that just retired, account the error of the
+ * prediction made for it and predict the work of the next frame. The
+ * prediction sits halfway between the average and the maximum of the recent
+ * frames to err on the side of not missing a frame.
+ */
+void kgsl_pwrscale_frame_end(struct kgsl_device *device,
+		struct kgsl_pwrscale_frame_history *hist)
+{
+	struct kgsl_pwrscale *psc = &device->pwrscale;
+	u64 actual = hist->frame_cycles, sum = 0, max = 0, avg;
+	unsigned int i;
+
+	hist->frame_cycles = 0;
+
+	if (!actual)
+		return;
+
+	if (hist->predicted) {
+		u64 err;
+
+		if (hist->predicted < actual) {
+			err = actual - hist->predicted;
+			psc->predict_under++;
+		} else {
+			err = hist->predicted - actual;
+			psc->predict_over++;
+		}
+
+		psc->predict_frames++;
+		psc->predict_err_pct += div64_u64(min_t(u64, err, actual) * 100,
+			actual);
+	}
+
+	hist->cycles[hist->index] = actual;
+	hist->index = (hist->index + 1) % KGSL_FRAME_HISTORY;
+	if (hist->count < KGSL_FRAME_HISTORY)
+		hist->count++;
+
+	for (i = 0; i < hist->count; i++) {
+		sum += hist->cycles[i];
+		max = max(max, hist->cycles[i]);
+	}
+
+	avg = div_u64(sum, hist->count);
+	hist->predicted = avg + ((max - avg) >> 1);
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame_end);
+
+/**
+ * kgsl_pwrscale_frame_start() - Raise the power level ahead of a frame
+ * @device: The device
+ * @hist: Frame history of the context submitting the frame
+ * @budget_us: Time in microseconds the frame has to finish in
+ *
+ * Pick the lowest power level that can do the predicted work of the frame
+ * within @budget_us and switch to it if it is faster than the current one.
+ * Lowering the level is left to the governor. This function must be called
+ * with the device mutex locked.
+ */
+void kgsl_pwrscale_frame_start(struct kgsl_device *device,
+		struct kgsl_pwrscale_frame_history *hist, u32 budget_us)
+{
+	struct kgsl_pwrscale *psc = &device->pwrscale;
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	u64 freq;
+	int i, level;
+
+	if (!psc->enabled || !psc->predict_enable || !hist->predicted ||
+		!budget_us)
+		return;
+
+	freq = div_u64(hist->predicted * 1000000, budget_us);
+
+	level = pwr->max_pwrlevel;
+	for (i = pwr->min_pwrlevel; i >= (int) pwr->max_pwrlevel; i--) {
+		if (pwr->pwrlevels[i].gpu_freq >= freq) {
+			level = i;
+			break;
+		}
+	}
+
+	if (level < pwr->active_pwrlevel) {
+		psc->predict_boosts++;
+		kgsl_pwrctrl_pwrlevel_change(device, level);
+	}
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame_start);
+
 static int _thermal_adjust(struct kgsl_pwrctrl *pwr, int level)
 {
 	if (level < pwr->active_pwrlevel)
@@ -43,6 +43,25 @@ struct kgsl_pwr_history {
 	unsigned int size;
 };
 
+/* Number of frames kept to predict the work of the next frame */
+#define KGSL_FRAME_HISTORY	8
+
+/**
+ * struct kgsl_pwrscale_frame_history - GPU work history of a context
+ * @cycles - GPU cycles used by each of the last frames
+ * @index - Next slot to write in @cycles
+ * @count - Number of valid entries in @cycles
+ * @frame_cycles - GPU cycles used so far by the current frame
+ * @predicted - Predicted GPU cycles of the next frame, 0 if unknown
+ */
+struct kgsl_pwrscale_frame_history {
+	u64 cycles[KGSL_FRAME_HISTORY];
+	unsigned int index;
+	unsigned int count;
+	u64 frame_cycles;
+	u64 predicted;
+};
+
 /**
  * struct kgsl_pwrscale - Power scaling settings for a KGSL device
  * @devfreqptr - Pointer to the devfreq device
@@ -69,6 +88,15 @@ struct kgsl_pwr_history {
  * ctxt aware power level jump
  * @ctxt_aware_target_pwrlevel - pwrlevel to jump on in case of ctxt aware
  * power level jump
+ * @predict_enable - Whether or not the frame work prediction may raise the
+ * power level before a frame is submitted
+ * @predict_frames - Number of frames that were predicted
+ * @predict_under - Number of frames that needed more work than predicted
+ * @predict_over - Number of frames that needed less work than predicted
+ * @predict_err_pct - Sum of the absolute prediction error of all predicted
+ * frames in percent of the actual work
+ * @predict_boosts - Number of times the power level was raised ahead of a
+ * frame
  */
 struct kgsl_pwrscale {
 	struct devfreq *devfreqptr;
@@ -92,6 +120,12 @@ struct kgsl_pwrscale {
 	bool ctxt_aware_enable;
 	unsigned int ctxt_aware_target_pwrlevel;
 	unsigned int ctxt_aware_busy_penalty;
+	bool predict_enable;
+	u64 predict_frames;
+	u64 predict_under;
+	u64 predict_over;
+	u64 predict_err_pct;
+	u64 predict_boosts;
 };
 
 int kgsl_pwrscale_init(struct device *dev, const char *governor);
@@ -109,6 +143,13 @@ void kgsl_pwrscale_midframe_timer_cancel(struct kgsl_device *device);
 void kgsl_pwrscale_enable(struct kgsl_device *device);
 void kgsl_pwrscale_disable(struct kgsl_device *device, bool turbo);
 
+void kgsl_pwrscale_frame_work(struct kgsl_device *device,
+		struct kgsl_pwrscale_frame_history *hist, s64 busy_us);
+void kgsl_pwrscale_frame_end(struct kgsl_device *device,
+		struct kgsl_pwrscale_frame_history *hist);
+void kgsl_pwrscale_frame_start(struct kgsl_device *device,
+		struct kgsl_pwrscale_frame_history *hist, u32 budget_us);
+
 int kgsl_devfreq_target(struct device *dev, unsigned long *freq, u32 flags);
 int kgsl_devfreq_get_dev_status(struct device *dev,
 			struct devfreq_dev_status *stat);
@@ -3,6 +3,8 @@
  * Copyright (c) 2020-2021, The Linux Foundation. All rights reserved.
  */
 
+#include <linux/crypto.h>
+#include <linux/highmem.h>
 #include <linux/kthread.h>
 #include <linux/notifier.h>
 #include <linux/pagevec.h>
@@ -24,6 +26,298 @@ static bool kgsl_reclaim;
  */
 static u32 kgsl_reclaim_max_page_limit = 7680;
 
+/* Compression algorithms to try for the compressed reclaim mode */
+static const char * const kgsl_reclaim_comp_algs[] = { "lz4", "zstd" };
+
+/**
+ * struct kgsl_reclaim_compressor - Compressor shared by all processes
+ * @lock: Serializes users of the transform and the scratch buffer
+ * @tfm: Compression transform, NULL if the compressed mode is unavailable
+ * @buf: Scratch buffer big enough for the worst case output of one page
+ */
+static struct kgsl_reclaim_compressor {
+	struct mutex lock;
+	struct crypto_comp *tfm;
+	u8 *buf;
+} kgsl_reclaim_comp;
+
+/**
+ * struct kgsl_reclaim_cpage - A compressed page
+ * @data: Compressed data, NULL if the page is not held in the store
+ * @len: Length of @data. PAGE_SIZE means the page was stored uncompressed
+ */
+struct kgsl_reclaim_cpage {
+	void *data;
+	unsigned int len;
+};
+
+/**
+ * struct kgsl_reclaim_cstore - Compressed copy of a reclaimed memdesc
+ * @lock: Protects the store against concurrent restore and release
+ * @nr_pages: Number of pages currently held in the store
+ * @size: Number of bytes used by the compressed data
+ * @cpages: One slot per page of the memdesc
+ */
+struct kgsl_reclaim_cstore {
+	struct mutex lock;
+	unsigned int nr_pages;
+	size_t size;
+	struct kgsl_reclaim_cpage cpages[];
+};
+
+static void kgsl_release_page_vec(struct pagevec *pvec)
+{
+	check_move_unevictable_pages(pvec->pages, pvec->nr);
+	__pagevec_release(pvec);
+}
+
+/* Compress one page into a newly allocated buffer */
+static int kgsl_reclaim_compress_page(struct page *page,
+		struct kgsl_reclaim_cpage *cpage)
+{
+	unsigned int dlen = 2 * PAGE_SIZE;
+	void *src;
+	int ret;
+
+	mutex_lock(&kgsl_reclaim_comp.lock);
+
+	src = kmap(page);
+	ret = crypto_comp_compress(kgsl_reclaim_comp.tfm, src, PAGE_SIZE,
+			kgsl_reclaim_comp.buf, &dlen);
+
+	/* Keep pages that do not compress as they are */
+	if (ret || dlen >= PAGE_SIZE)
+		dlen = PAGE_SIZE;
+
+	cpage->data = kmalloc(dlen, GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN);
+	if (cpage->data) {
+		memcpy(cpage->data, dlen == PAGE_SIZE ? src :
+			kgsl_reclaim_comp.buf, dlen);
+		cpage->len = dlen;
+		ret = 0;
+	} else
+		ret = -ENOMEM;
+
+	kunmap(page);
+
+	mutex_unlock(&kgsl_reclaim_comp.lock);
+	return ret;
+}
+
+/* Decompress a stored page into page */
+static int kgsl_reclaim_decompress_page(struct kgsl_reclaim_cpage *cpage,
+		struct page *page)
+{
+	unsigned int dlen = PAGE_SIZE;
+	void *dst = kmap(page);
+	int ret = 0;
+
+	if (cpage->len == PAGE_SIZE)
+		memcpy(dst, cpage->data, PAGE_SIZE);
+	else {
+		mutex_lock(&kgsl_reclaim_comp.lock);
+		ret = crypto_comp_decompress(kgsl_reclaim_comp.tfm, cpage->data,
+			cpage->len, dst, &dlen);
+		mutex_unlock(&kgsl_reclaim_comp.lock);
+
+		if (!ret && dlen != PAGE_SIZE)
+			ret = -EINVAL;
+	}
+
+	kunmap(page);
+	return ret;
+}
+
+/* Drop a page from the store and from the statistics of the process */
+static void kgsl_reclaim_cstore_drop(struct kgsl_reclaim_cstore *cstore,
+		unsigned int i, struct kgsl_process_private *process)
+{
+	struct kgsl_reclaim_cpage *cpage = &cstore->cpages[i];
+
+	cstore->nr_pages--;
+	cstore->size -= cpage->len;
+
+	if (process) {
+		atomic_dec(&process->compressed_page_count);
+		atomic_long_sub(cpage->len, &process->compressed_size);
+	}
+
+	kfree(cpage->data);
+	cpage->data = NULL;
+	cpage->len = 0;
+}
+
+/**
+ * kgsl_reclaim_restore_page() - Fill a page brought back from shmem
+ * @process: Process owning the memdesc
+ * @memdesc: Memory descriptor the page belongs to
+ * @index: Index of the page in the memdesc
+ * @page: Page read back from the shmem file of the memdesc
+ *
+ * If the page was reclaimed in the compressed mode, its shmem copy was
+ * truncated so decompress the stored contents into the fresh page.
+ * Return: 0 on success or negative error if the contents were lost
+ */
+int kgsl_reclaim_restore_page(struct kgsl_process_private *process,
+		struct kgsl_memdesc *memdesc, unsigned int index,
+		struct page *page)
+{
+	struct kgsl_reclaim_cstore *cstore = memdesc->cstore;
+	int ret = 0;
+
+	if (!cstore || !READ_ONCE(cstore->nr_pages))
+		return 0;
+
+	mutex_lock(&cstore->lock);
+	if (cstore->cpages[index].data) {
+		ret = kgsl_reclaim_decompress_page(&cstore->cpages[index], page);
+		kgsl_reclaim_cstore_drop(cstore, index, process);
+		set_page_dirty_lock(page);
+	}
+	mutex_unlock(&cstore->lock);
+
+	return ret;
+}
+
+/**
+ * kgsl_reclaim_memdesc_detach() - Drop the compressed statistics of a memdesc
+ * @process: Process the memdesc is being detached from
+ * @memdesc: Memory descriptor being detached
+ */
+void kgsl_reclaim_memdesc_detach(struct kgsl_process_private *process,
+		struct kgsl_memdesc *memdesc)
+{
+	struct kgsl_reclaim_cstore *cstore = memdesc->cstore;
+
+	if (!cstore)
+		return;
+
+	mutex_lock(&cstore->lock);
+	atomic_sub(cstore->nr_pages, &process->compressed_page_count);
+	atomic_long_sub(cstore->size, &process->compressed_size);
+	mutex_unlock(&cstore->lock);
+}
+
+/**
+ * kgsl_reclaim_memdesc_free() - Free the compressed store of a memdesc
+ * @memdesc: Memory descriptor being freed
+ */
+void kgsl_reclaim_memdesc_free(struct kgsl_memdesc *memdesc)
+{
+	struct kgsl_reclaim_cstore *cstore = memdesc->cstore;
+	unsigned int i;
+
+	if (!cstore)
+		return;
+
+	for (i = 0; i < memdesc->page_count; i++)
+		kfree(cstore->cpages[i].data);
+
+	kvfree(cstore);
+	memdesc->cstore = NULL;
+}
+
+/*
+ * Compress all pages of a memdesc that was just unmapped from the GPU, then
+ * release them and truncate the shmem file so that the memory actually goes
+ * back to the system. Returns an error without touching the pages if the
+ * memdesc could not be compressed, so the caller can fall back to swap.
+ */
+static int kgsl_reclaim_compress_memdesc(struct kgsl_process_private *process,
+		struct kgsl_mem_entry *entry)
+{
+	struct kgsl_memdesc *memdesc = &entry->memdesc;
+	struct kgsl_reclaim_cstore *cstore = memdesc->cstore;
+	struct page **pages;
+	struct pagevec pvec;
+	size_t size = 0;
+	int i, ret = 0;
+
+	/* Pages mapped by the CPU must stay backed by the shmem file */
+	if (!kgsl_reclaim_comp.tfm || atomic_read(&entry->map_count) ||
+			memdesc->hostptr)
+		return -EBUSY;
+
+	if (!cstore) {
+		cstore = kvzalloc(struct_size(cstore, cpages,
+			memdesc->page_count), GFP_KERNEL);
+		if (!cstore)
+			return -ENOMEM;
+
+		mutex_init(&cstore->lock);
+		memdesc->cstore = cstore;
+	}
+
+	pages = kvmalloc_array(memdesc->page_count, sizeof(*pages),
+		GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	mutex_lock(&cstore->lock);
+
+	/* All pages were restored when the memdesc was pinned again */
+	if (WARN_ON(cstore->nr_pages)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	for (i = 0; i < memdesc->page_count; i++) {
+		ret = kgsl_reclaim_compress_page(memdesc->pages[i],
+			&cstore->cpages[i]);
+		if (ret)
+			break;
+		size += cstore->cpages[i].len;
+	}
+
+	/*
+	 * Once the pages array is cleared a CPU fault reads the page back
+	 * through the shmem file and restores it from the store, so only a
+	 * mapping created before this point could see a page that is about
+	 * to be truncated.
+	 */
+	spin_lock(&memdesc->lock);
+	if (!ret && atomic_read(&entry->map_count))
+		ret = -EBUSY;
+	if (!ret) {
+		memcpy(pages, memdesc->pages,
+			memdesc->page_count * sizeof(*pages));
+		memset(memdesc->pages, 0,
+			memdesc->page_count * sizeof(*pages));
+	}
+	spin_unlock(&memdesc->lock);
+
+	if (ret) {
+		for (i = 0; i < memdesc->page_count; i++) {
+			kfree(cstore->cpages[i].data);
+			cstore->cpages[i].data = NULL;
+			cstore->cpages[i].len = 0;
+		}
+		goto out;
+	}
+
+	cstore->nr_pages = memdesc->page_count;
+	cstore->size = size;
+	atomic_add(memdesc->page_count, &process->compressed_page_count);
+	atomic_long_add(size, &process->compressed_size);
+
+	pagevec_init(&pvec);
+	for (i = 0; i < memdesc->page_count; i++) {
+		pagevec_add(&pvec, pages[i]);
+		if (pagevec_count(&pvec) == PAGEVEC_SIZE)
+			kgsl_release_page_vec(&pvec);
+	}
+	if (pagevec_count(&pvec))
+		kgsl_release_page_vec(&pvec);
+
+	/* The contents live in the store now, give the memory back */
+	shmem_truncate_range(file_inode(memdesc->shmem_filp), 0, (loff_t)-1);
+
+out:
+	mutex_unlock(&cstore->lock);
+	kvfree(pages);
+	return ret;
+}
+
 static int kgsl_memdesc_get_reclaimed_pages(struct kgsl_mem_entry *entry)
 {
 	struct kgsl_memdesc *memdesc = &entry->memdesc;
@@ -40,6 +334,12 @@ static int kgsl_memdesc_get_reclaimed_pages(struct kgsl_mem_entry *entry)
 		if (IS_ERR(page))
 			return PTR_ERR(page);
 
+		ret = kgsl_reclaim_restore_page(entry->priv, memdesc, i, page);
+		if (ret) {
+			put_page(page);
+			return ret;
+		}
+
 		kgsl_flush_page(page);
 
 		/*
@@ -70,6 +370,7 @@ int kgsl_reclaim_to_pinned_state(
 {
 	struct kgsl_mem_entry *entry;
 	int next = 0, valid_entry, ret = 0;
+	ktime_t start;
 
 	if (!kgsl_reclaim)
 		return 0;
@@ -79,6 +380,8 @@ int kgsl_reclaim_to_pinned_state(
 	if (test_bit(KGSL_PROC_PINNED_STATE, &process->state))
 		goto done;
 
+	start = ktime_get();
+
 	for ( ; ; ) {
 		valid_entry = 0;
 		spin_lock(&process->mem_lock);
@@ -104,6 +407,10 @@ int kgsl_reclaim_to_pinned_state(
 	}
 
 	set_bit(KGSL_PROC_PINNED_STATE, &process->state);
+
+	process->restore_latency_us = ktime_us_delta(ktime_get(), start);
+	if (process->restore_latency_us > process->restore_latency_max_us)
+		process->restore_latency_max_us = process->restore_latency_us;
 done:
 	mutex_unlock(&process->reclaim_lock);
 	return ret;
@@ -159,12 +466,99 @@ static ssize_t gpumem_reclaimed_show(struct kobject *kobj,
 		atomic_read(&process->reclaimed_page_count) << PAGE_SHIFT);
 }
 
+static ssize_t reclaim_mode_show(struct kobject *kobj,
+		struct kgsl_process_attribute *attr, char *buf)
+{
+	struct kgsl_process_private *process =
+		container_of(kobj, struct kgsl_process_private, kobj);
+
+	if (test_bit(KGSL_PROC_RECLAIM_COMPRESS, &process->state))
+		return scnprintf(buf, PAGE_SIZE, "compress\n");
+	else
+		return scnprintf(buf, PAGE_SIZE, "swap\n");
+}
+
+static ssize_t reclaim_mode_store(struct kobject *kobj,
+	struct kgsl_process_attribute *attr, const char *buf, ssize_t count)
+{
+	struct kgsl_process_private *process =
+		container_of(kobj, struct kgsl_process_private, kobj);
+
+	if (sysfs_streq(buf, "compress")) {
+		if (!kgsl_reclaim_comp.tfm)
+			return -EOPNOTSUPP;
+		set_bit(KGSL_PROC_RECLAIM_COMPRESS, &process->state);
+	} else if (sysfs_streq(buf, "swap"))
+		clear_bit(KGSL_PROC_RECLAIM_COMPRESS, &process->state);
+	else
+		return -EINVAL;
+
+	return count;
+}
+
+static ssize_t gpumem_compressed_show(struct kobject *kobj,
+		struct kgsl_process_attribute *attr, char *buf)
+{
+	struct kgsl_process_private *process =
+		container_of(kobj, struct kgsl_process_private, kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n",
+		(unsigned long)atomic_read(&process->compressed_page_count)
+			<< PAGE_SHIFT);
+}
+
+static ssize_t gpumem_compressed_size_show(struct kobject *kobj,
+		struct kgsl_process_attribute *attr, char *buf)
+{
+	struct kgsl_process_private *process =
+		container_of(kobj, struct kgsl_process_private, kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%ld\n",
+		atomic_long_read(&process->compressed_size));
+}
+
+/* Ratio of the original to the compressed size, with two decimals */
+static ssize_t gpumem_compression_ratio_show(struct kobject *kobj,
+		struct kgsl_process_attribute *attr, char *buf)
+{
+	struct kgsl_process_private *process =
+		container_of(kobj, struct kgsl_process_private, kobj);
+	u64 orig = (u64)atomic_read(&process->compressed_page_count)
+		<< PAGE_SHIFT;
+	u64 size = atomic_long_read(&process->compressed_size);
+	u32 ratio = size ? (u32)div64_u64(orig * 100, size) : 0;
+
+	return scnprintf(buf, PAGE_SIZE, "%u.%02u\n",
+		ratio / 100, ratio % 100);
+}
+
+static ssize_t gpumem_restore_latency_show(struct kobject *kobj,
+		struct kgsl_process_attribute *attr, char *buf)
+{
+	struct kgsl_process_private *process =
+		container_of(kobj, struct kgsl_process_private, kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu %llu\n",
+		process->restore_latency_us, process->restore_latency_max_us);
+}
+
 PROCESS_ATTR(state, 0644, kgsl_proc_state_show, kgsl_proc_state_store);
 PROCESS_ATTR(gpumem_reclaimed, 0444, gpumem_reclaimed_show, NULL);
+PROCESS_ATTR(reclaim_mode, 0644, reclaim_mode_show, reclaim_mode_store);
+PROCESS_ATTR(gpumem_compressed, 0444, gpumem_compressed_show, NULL);
+PROCESS_ATTR(gpumem_compressed_size, 0444, gpumem_compressed_size_show, NULL);
+PROCESS_ATTR(gpumem_compression_ratio, 0444, gpumem_compression_ratio_show,
+	NULL);
+PROCESS_ATTR(gpumem_restore_latency, 0444, gpumem_restore_latency_show, NULL);
 
 static const struct attribute *proc_reclaim_attrs[] = {
 	&attr_state.attr,
 	&attr_gpumem_reclaimed.attr,
+	&attr_reclaim_mode.attr,
+	&attr_gpumem_compressed.attr,
+	&attr_gpumem_compressed_size.attr,
+	&attr_gpumem_compression_ratio.attr,
+	&attr_gpumem_restore_latency.attr,
 	NULL,
 };
 
@@ -195,10 +589,44 @@ ssize_t kgsl_proc_max_reclaim_limit_show(struct device *dev,
 	return scnprintf(buf, PAGE_SIZE, "%d\n", kgsl_reclaim_max_page_limit);
 }
 
-static void kgsl_release_page_vec(struct pagevec *pvec)
+/*
+ * Release the pages of a memdesc to the shmem file and ask the VM to swap
+ * them out. Returns the notifier status of reclaim_address_space().
+ */
+static int kgsl_reclaim_swap_memdesc(struct kgsl_memdesc *memdesc, void *data)
 {
-	check_move_unevictable_pages(pvec->pages, pvec->nr);
-	__pagevec_release(pvec);
+	int i, ret;
+	struct pagevec pvec;
+
+	/*
+	 * Pages that are first allocated are by default added
+	 * to unevictable list. To reclaim them, we first clear
+	 * the AS_UNEVICTABLE flag of the shmem file address
+	 * space thus check_move_unevictable_pages() places
+	 * them on the evictable list.
+	 *
+	 * Once reclaim is done, hint that further shmem
+	 * allocations will have to be on the unevictable list.
+	 */
+	mapping_clear_unevictable(memdesc->shmem_filp->f_mapping);
+	pagevec_init(&pvec);
+	for (i = 0; i < memdesc->page_count; i++) {
+		set_page_dirty_lock(memdesc->pages[i]);
+		spin_lock(&memdesc->lock);
+		pagevec_add(&pvec, memdesc->pages[i]);
+		memdesc->pages[i] = NULL;
+		spin_unlock(&memdesc->lock);
+		if (pagevec_count(&pvec) == PAGEVEC_SIZE)
+			kgsl_release_page_vec(&pvec);
+	}
+	if (pagevec_count(&pvec))
+		kgsl_release_page_vec(&pvec);
+
+	ret = reclaim_address_space(memdesc->shmem_filp->f_mapping, data);
+
+	mapping_set_unevictable(memdesc->shmem_filp->f_mapping);
+
+	return ret;
 }
 
 static int kgsl_reclaim_callback(struct notifier_block *nb,
@@ -273,40 +701,12 @@ static int kgsl_reclaim_callback(struct notifier_block *nb,
 		}
 
 		if (!kgsl_mmu_unmap(memdesc->pagetable, memdesc)) {
-			int i;
-			struct pagevec pvec;
-
-			/*
-			 * Pages that are first allocated are by default added
-			 * to unevictable list. To reclaim them, we first clear
-			 * the AS_UNEVICTABLE flag of the shmem file address
-			 * space thus check_move_unevictable_pages() places
-			 * them on the evictable list.
-			 *
-			 * Once reclaim is done, hint that further shmem
-			 * allocations will have to be on the unevictable list.
-			 */
-			mapping_clear_unevictable(
-					memdesc->shmem_filp->f_mapping);
-			pagevec_init(&pvec);
-			for (i = 0; i < memdesc->page_count; i++) {
-				set_page_dirty_lock(memdesc->pages[i]);
-				spin_lock(&memdesc->lock);
-				pagevec_add(&pvec, memdesc->pages[i]);
-				memdesc->pages[i] = NULL;
-				spin_unlock(&memdesc->lock);
-				if (pagevec_count(&pvec) == PAGEVEC_SIZE)
-					kgsl_release_page_vec(&pvec);
-			}
-			if (pagevec_count(&pvec))
-				kgsl_release_page_vec(&pvec);
+			if (!test_bit(KGSL_PROC_RECLAIM_COMPRESS,
+					&process->state) ||
+				kgsl_reclaim_compress_memdesc(process, entry))
+				ret = kgsl_reclaim_swap_memdesc(memdesc, data);
 
 			memdesc->priv |= KGSL_MEMDESC_RECLAIMED;
-
-			ret = reclaim_address_space
-				(memdesc->shmem_filp->f_mapping, data);
-
-			mapping_set_unevictable(memdesc->shmem_filp->f_mapping);
 			memdesc->reclaimed_page_count += memdesc->page_count;
 			atomic_add(memdesc->page_count,
 					&process->reclaimed_page_count);
@@ -338,6 +738,31 @@ void kgsl_reclaim_proc_private_init(struct kgsl_process_private *process)
 	set_bit(KGSL_PROC_STATE, &process->state);
 }
 
+/* Set up the compressor used by the compressed reclaim mode, if any */
+static void kgsl_reclaim_comp_init(void)
+{
+	int i;
+
+	mutex_init(&kgsl_reclaim_comp.lock);
+
+	kgsl_reclaim_comp.buf = kmalloc(2 * PAGE_SIZE, GFP_KERNEL);
+	if (!kgsl_reclaim_comp.buf)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(kgsl_reclaim_comp_algs); i++) {
+		struct crypto_comp *tfm =
+			crypto_alloc_comp(kgsl_reclaim_comp_algs[i], 0, 0);
+
+		if (!IS_ERR(tfm)) {
+			kgsl_reclaim_comp.tfm = tfm;
+			return;
+		}
+	}
+
+	kfree(kgsl_reclaim_comp.buf);
+	kgsl_reclaim_comp.buf = NULL;
+}
+
 int kgsl_reclaim_init(struct kgsl_device *device)
 {
 	if (!(device->flags & KGSL_FLAG_PROCESS_RECLAIM))
@@ -345,6 +770,8 @@ int kgsl_reclaim_init(struct kgsl_device *device)
 
 	kgsl_reclaim = true;
 
+	kgsl_reclaim_comp_init();
+
 	kgsl_reclaim_nb.notifier_call = kgsl_reclaim_callback;
 	return proc_reclaim_notifier_register(&kgsl_reclaim_nb);
 }
@@ -352,4 +779,12 @@ int kgsl_reclaim_init(struct kgsl_device *device)
 void kgsl_reclaim_close(void)
 {
 	proc_reclaim_notifier_unregister(&kgsl_reclaim_nb);
+
+	if (kgsl_reclaim_comp.tfm) {
+		crypto_free_comp(kgsl_reclaim_comp.tfm);
+		kgsl_reclaim_comp.tfm = NULL;
+	}
+
+	kfree(kgsl_reclaim_comp.buf);
+	kgsl_reclaim_comp.buf = NULL;
 }
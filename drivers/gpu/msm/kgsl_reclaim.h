@@ -12,6 +12,8 @@
 #define KGSL_PROC_PINNED_STATE 0
 /* Process foreground/background state. Set if process is in foreground */
 #define KGSL_PROC_STATE 1
+/* Reclaim mode. Set if reclaimed memory is compressed instead of swapped */
+#define KGSL_PROC_RECLAIM_COMPRESS 2
 
 int kgsl_reclaim_init(struct kgsl_device *device);
 void kgsl_reclaim_close(void);
@@ -22,4 +24,10 @@ ssize_t kgsl_proc_max_reclaim_limit_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t count);
 ssize_t kgsl_proc_max_reclaim_limit_show(struct device *dev,
 		struct device_attribute *attr, char *buf);
+int kgsl_reclaim_restore_page(struct kgsl_process_private *process,
+		struct kgsl_memdesc *memdesc, unsigned int index,
+		struct page *page);
+void kgsl_reclaim_memdesc_detach(struct kgsl_process_private *process,
+		struct kgsl_memdesc *memdesc);
+void kgsl_reclaim_memdesc_free(struct kgsl_memdesc *memdesc);
 #endif /* __KGSL_RECLAIM_H */
@@ -498,6 +498,12 @@ static int kgsl_page_alloc_vmfault(struct kgsl_memdesc *memdesc,
 			kgsl_gfp_mask(0));
 		if (IS_ERR(page))
 			return VM_FAULT_SIGBUS;
+
+		if (kgsl_reclaim_restore_page(priv, memdesc, pgoff, page)) {
+			put_page(page);
+			return VM_FAULT_SIGBUS;
+		}
+
 		kgsl_flush_page(page);
 
 		spin_lock(&memdesc->lock);
@@ -630,6 +636,8 @@ static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 	else
 		kgsl_free_pages_from_sgt(memdesc);
 
+	kgsl_reclaim_memdesc_free(memdesc);
+
 	if (memdesc->shmem_filp) {
 		fput(memdesc->shmem_filp);
 		memdesc->shmem_filp = NULL;
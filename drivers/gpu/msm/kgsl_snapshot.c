@@ -557,11 +557,32 @@ void kgsl_snapshot_add_section(struct kgsl_device *device, u16 id,
 	if (snapshot->remain < sizeof(*header))
 		return;
 
+	/* Bound the time the GPU is held frozen by skipping what is left */
+	if (snapshot->deadline && ktime_after(ktime_get(), snapshot->deadline)) {
+		snapshot->skipped++;
+		return;
+	}
+
 	/* It is legal to have no function (i.e. - make an empty section) */
 	if (func) {
+		ktime_t start = ktime_get();
+		s64 us;
+
+		if (device->snapshot_section_budget_us)
+			snapshot->section_deadline = ktime_add_us(start,
+				device->snapshot_section_budget_us);
+
 		ret = func(device, data, snapshot->remain - sizeof(*header),
 			priv);
 
+		snapshot->section_deadline = 0;
+
+		us = ktime_us_delta(ktime_get(), start);
+		if (us > snapshot->slowest_us) {
+			snapshot->slowest_us = us;
+			snapshot->slowest_id = id;
+		}
+
 		/*
 		 * If there wasn't enough room for the data then don't bother
 		 * setting up the header.
@@ -580,6 +601,30 @@ void kgsl_snapshot_add_section(struct kgsl_device *device, u16 id,
 	snapshot->size += header->size;
 }
 
+/**
+ * kgsl_snapshot_over_budget() - Check if a snapshot has run out of time
+ * @snapshot: Pointer to the snapshot instance
+ *
+ * Return true if either the snapshot or the section currently being dumped
+ * has used up its time budget. Section callbacks that loop over a potentially
+ * large amount of data, such as IB parsing, should stop when this is true.
+ */
+bool kgsl_snapshot_over_budget(struct kgsl_snapshot *snapshot)
+{
+	ktime_t now;
+
+	if (!snapshot->deadline && !snapshot->section_deadline)
+		return false;
+
+	now = ktime_get();
+
+	if (snapshot->deadline && ktime_after(now, snapshot->deadline))
+		return true;
+
+	return snapshot->section_deadline &&
+		ktime_after(now, snapshot->section_deadline);
+}
+
 static void kgsl_free_snapshot(struct kgsl_snapshot *snapshot)
 {
 	struct kgsl_snapshot_object *obj, *tmp;
@@ -655,6 +700,7 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 	struct kgsl_snapshot *snapshot;
 	struct timespec boot;
 	phys_addr_t pa;
+	ktime_t start = ktime_get();
 
 	set_isdb_breakpoint_registers(device);
 
@@ -702,6 +748,7 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 		return;
 
 	init_completion(&snapshot->dump_gate);
+	init_waitqueue_head(&snapshot->stream_wq);
 	INIT_LIST_HEAD(&snapshot->obj_list);
 	INIT_LIST_HEAD(&snapshot->cp_list);
 	INIT_WORK(&snapshot->work, kgsl_snapshot_save_frozen_objs);
@@ -714,6 +761,10 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 	snapshot->first_read = true;
 	snapshot->sysfs_read = 0;
 
+	if (device->snapshot_budget_ms)
+		snapshot->deadline = ktime_add_ms(start,
+			device->snapshot_budget_ms);
+
 	header = (struct kgsl_snapshot_header *) snapshot->ptr;
 
 	header->magic = SNAPSHOT_MAGIC;
@@ -747,6 +798,12 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 	getboottime(&boot);
 	snapshot->timestamp = get_seconds() - boot.tv_sec;
 
+	snapshot->elapsed_us = ktime_us_delta(ktime_get(), start);
+	if (snapshot->skipped)
+		dev_err(device->dev,
+			"snapshot: out of time after %lldus, skipped %u sections\n",
+			snapshot->elapsed_us, snapshot->skipped);
+
 	/* Store the instance in the device until it gets dumped */
 	device->snapshot = snapshot;
 	snapshot->device = device;
@@ -835,6 +892,23 @@ static int snapshot_release(struct kgsl_device *device,
 	return ret;
 }
 
+/*
+ * Wait until a streaming reader at @off has something to copy: either the
+ * read starts in the static region, the worker has saved objects past the
+ * offset, or the worker is done.
+ */
+static int snapshot_stream_wait(struct kgsl_snapshot *snapshot, loff_t off)
+{
+	size_t moff = (off > snapshot->size) ? off - snapshot->size : 0;
+
+	if (off < snapshot->size)
+		return 0;
+
+	return wait_event_interruptible(snapshot->stream_wq,
+		completion_done(&snapshot->dump_gate) ||
+		smp_load_acquire(&snapshot->mempool_size) > moff);
+}
+
 /* Dump the sysfs binary data to the user */
 static ssize_t snapshot_show(struct file *filep, struct kobject *kobj,
 	struct bin_attribute *attr, char *buf, loff_t off,
@@ -844,6 +918,7 @@ static ssize_t snapshot_show(struct file *filep, struct kobject *kobj,
 	struct kgsl_snapshot *snapshot;
 	struct kgsl_snapshot_section_header head;
 	struct snapshot_obj_itr itr;
+	bool stream = READ_ONCE(device->snapshot_stream);
 	int ret = 0;
 
 	mutex_lock(&device->mutex);
@@ -875,8 +950,12 @@ static ssize_t snapshot_show(struct file *filep, struct kobject *kobj,
 	/*
 	 * Wait for the dump worker to finish. This is interruptible
 	 * to allow userspace to bail if things go horribly wrong.
+	 * Streaming readers only wait if there is nothing to copy yet.
 	 */
-	ret = wait_for_completion_interruptible(&snapshot->dump_gate);
+	if (stream)
+		ret = snapshot_stream_wait(snapshot, off);
+	else
+		ret = wait_for_completion_interruptible(&snapshot->dump_gate);
 	if (ret) {
 		snapshot_release(device, snapshot);
 		return ret;
@@ -888,8 +967,22 @@ static ssize_t snapshot_show(struct file *filep, struct kobject *kobj,
 	if (ret == 0)
 		goto done;
 
-	/* Dump the memory pool if it exists */
-	if (snapshot->mempool) {
+	if (stream) {
+		/* Check for completion first so the size read is final */
+		bool complete = completion_done(&snapshot->dump_gate);
+		size_t size = smp_load_acquire(&snapshot->mempool_size);
+
+		if (size) {
+			ret = obj_itr_out(&itr, snapshot->mempool, size);
+			if (ret == 0)
+				goto done;
+		}
+
+		/* Return what we have and let the reader come back for more */
+		if (!complete)
+			goto done;
+	} else if (snapshot->mempool) {
+		/* Dump the memory pool if it exists */
 		ret = obj_itr_out(&itr, snapshot->mempool,
 				snapshot->mempool_size);
 		if (ret == 0)
@@ -1038,6 +1131,67 @@ static ssize_t snapshot_legacy_store(struct kgsl_device *device,
 	return count;
 }
 
+static ssize_t budget_ms_show(struct kgsl_device *device, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", device->snapshot_budget_ms);
+}
+
+static ssize_t budget_ms_store(struct kgsl_device *device,
+	const char *buf, size_t count)
+{
+	int ret = kstrtou32(buf, 0, &device->snapshot_budget_ms);
+
+	return ret ? ret : count;
+}
+
+static ssize_t section_budget_us_show(struct kgsl_device *device, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+		device->snapshot_section_budget_us);
+}
+
+static ssize_t section_budget_us_store(struct kgsl_device *device,
+	const char *buf, size_t count)
+{
+	int ret = kstrtou32(buf, 0, &device->snapshot_section_budget_us);
+
+	return ret ? ret : count;
+}
+
+static ssize_t stream_show(struct kgsl_device *device, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%d\n", device->snapshot_stream);
+}
+
+static ssize_t stream_store(struct kgsl_device *device,
+	const char *buf, size_t count)
+{
+	if (strtobool(buf, &device->snapshot_stream))
+		return -EINVAL;
+
+	return count;
+}
+
+/* Show how long the last snapshot took and what was skipped */
+static ssize_t last_stats_show(struct kgsl_device *device, char *buf)
+{
+	struct kgsl_snapshot *snapshot;
+	ssize_t ret;
+
+	mutex_lock(&device->mutex);
+	snapshot = device->snapshot;
+	if (snapshot)
+		ret = scnprintf(buf, PAGE_SIZE,
+			"elapsed_us: %lld\nskipped: %u\nslowest_section: 0x%x %lldus\n",
+			snapshot->elapsed_us, snapshot->skipped,
+			snapshot->slowest_id, snapshot->slowest_us);
+	else
+		ret = 0;
+	mutex_unlock(&device->mutex);
+
+	return ret;
+}
+
 static struct bin_attribute snapshot_attr = {
 	.attr.name = "dump",
 	.attr.mode = 0444,
@@ -1063,6 +1217,11 @@ static SNAPSHOT_ATTR(snapshot_legacy, 0644, snapshot_legacy_show,
 	snapshot_legacy_store);
 static SNAPSHOT_ATTR(skip_ib_capture, 0644, skip_ib_capture_show,
 		skip_ib_capture_store);
+static SNAPSHOT_ATTR(budget_ms, 0644, budget_ms_show, budget_ms_store);
+static SNAPSHOT_ATTR(section_budget_us, 0644, section_budget_us_show,
+		section_budget_us_store);
+static SNAPSHOT_ATTR(stream, 0644, stream_show, stream_store);
+static SNAPSHOT_ATTR(last_stats, 0444, last_stats_show, NULL);
 
 static ssize_t snapshot_sysfs_show(struct kobject *kobj,
 	struct attribute *attr, char *buf)
@@ -1109,6 +1268,10 @@ static const struct attribute *snapshot_attrs[] = {
 	&attr_snapshot_crashdumper.attr,
 	&attr_snapshot_legacy.attr,
 	&attr_skip_ib_capture.attr,
+	&attr_budget_ms.attr,
+	&attr_section_budget_us.attr,
+	&attr_stream.attr,
+	&attr_last_stats.attr,
 	NULL,
 };
 
@@ -1156,6 +1319,9 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 	device->force_panic = false;
 	device->snapshot_crashdumper = false;
 	device->snapshot_legacy = false;
+	device->snapshot_budget_ms = 0;
+	device->snapshot_section_budget_us = 0;
+	device->snapshot_stream = false;
 
 	/*
 	 * Set this to false so that we only ever keep the first snapshot around
@@ -1310,7 +1476,11 @@ static void kgsl_snapshot_save_frozen_objs(struct work_struct *work)
 			size_t ret = _mempool_add_object(snapshot, ptr, obj);
 
 			ptr += ret;
-			snapshot->mempool_size += ret;
+
+			/* Publish the object to streaming readers */
+			smp_store_release(&snapshot->mempool_size,
+				snapshot->mempool_size + ret);
+			wake_up_all(&snapshot->stream_wq);
 		}
 
 		kgsl_snapshot_put_object(obj);
@@ -1336,4 +1506,5 @@ static void kgsl_snapshot_save_frozen_objs(struct work_struct *work)
 	BUG_ON(!snapshot->device->skip_ib_capture &
 				snapshot->device->force_panic);
 	complete_all(&snapshot->dump_gate);
+	wake_up_all(&snapshot->stream_wq);
 }
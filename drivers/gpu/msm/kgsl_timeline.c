@@ -143,7 +143,7 @@ static struct kgsl_timeline *kgsl_timeline_alloc(
 	timeline->context = dma_fence_context_alloc(1);
 	timeline->id = id;
 	INIT_LIST_HEAD(&timeline->fences);
-	timeline->value = initial;
+	atomic64_set(&timeline->value, initial);
 	timeline->dev_priv = dev_priv;
 
 	snprintf((char *) timeline->name, sizeof(timeline->name),
@@ -168,19 +168,15 @@ static void timeline_fence_release(struct dma_fence *fence)
 {
 	struct kgsl_timeline_fence *f = to_timeline_fence(fence);
 	struct kgsl_timeline *timeline = f->timeline;
-	struct kgsl_timeline_fence *cur, *temp;
 	unsigned long flags;
 
+	/*
+	 * Fences are always removed with list_del_init() so the node is only
+	 * non-empty while the fence is still on the active list
+	 */
 	spin_lock_irqsave(&timeline->fence_lock, flags);
-
-	/* If the fence is still on the active list, remove it */
-	list_for_each_entry_safe(cur, temp, &timeline->fences, node) {
-		if (f != cur)
-			continue;
-
+	if (!list_empty(&f->node))
 		list_del_init(&f->node);
-		break;
-	}
 	spin_unlock_irqrestore(&timeline->fence_lock, flags);
 
 	trace_kgsl_timeline_fence_release(f->timeline->id, fence->seqno);
@@ -193,7 +189,8 @@ static bool timeline_fence_signaled(struct dma_fence *fence)
 {
 	struct kgsl_timeline_fence *f = to_timeline_fence(fence);
 
-	return !__dma_fence_is_later(fence->seqno, f->timeline->value);
+	return !__dma_fence_is_later(fence->seqno,
+		atomic64_read(&f->timeline->value));
 }
 
 static bool timeline_fence_enable_signaling(struct dma_fence *fence)
@@ -223,7 +220,8 @@ static void timeline_get_value_str(struct dma_fence *fence,
 {
 	struct kgsl_timeline_fence *f = to_timeline_fence(fence);
 
-	snprintf(str, size, "%lld", f->timeline->value);
+	snprintf(str, size, "%lld",
+		(long long) atomic64_read(&f->timeline->value));
 }
 
 static const struct dma_fence_ops timeline_fence_ops = {
@@ -241,48 +239,96 @@ static void kgsl_timeline_add_fence(struct kgsl_timeline *timeline,
 	struct kgsl_timeline_fence *entry;
 	unsigned long flags;
 
+	/*
+	 * Fences are mostly created in seqno order so search from the tail to
+	 * make the common case an append
+	 */
 	spin_lock_irqsave(&timeline->fence_lock, flags);
-	list_for_each_entry(entry, &timeline->fences, node) {
-		if (fence->base.seqno < entry->base.seqno) {
-			list_add_tail(&fence->node, &entry->node);
+	list_for_each_entry_reverse(entry, &timeline->fences, node) {
+		if (fence->base.seqno >= entry->base.seqno) {
+			list_add(&fence->node, &entry->node);
 			spin_unlock_irqrestore(&timeline->fence_lock, flags);
 			return;
 		}
 	}
 
-	list_add_tail(&fence->node, &timeline->fences);
+	list_add(&fence->node, &timeline->fences);
 	spin_unlock_irqrestore(&timeline->fence_lock, flags);
 }
 
+static void kgsl_timeline_remove_fence(struct kgsl_timeline *timeline,
+		struct kgsl_timeline_fence *fence)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&timeline->fence_lock, flags);
+	list_del_init(&fence->node);
+	spin_unlock_irqrestore(&timeline->fence_lock, flags);
+}
+
+/* Move the timeline forward to @seqno. Return false if it is already past it */
+static bool kgsl_timeline_advance(struct kgsl_timeline *timeline, u64 seqno)
+{
+	u64 cur = atomic64_read(&timeline->value);
+
+	for (;;) {
+		u64 old;
+
+		if (seqno < cur)
+			return false;
+
+		old = atomic64_cmpxchg(&timeline->value, cur, seqno);
+		if (old == cur)
+			return true;
+
+		cur = old;
+	}
+}
+
 void kgsl_timeline_signal(struct kgsl_timeline *timeline, u64 seqno)
 {
 	struct kgsl_timeline_fence *fence, *tmp;
 	struct list_head temp;
 
-	INIT_LIST_HEAD(&temp);
+	/*
+	 * The value is advanced without any locks. The cmpxchg orders the
+	 * update before the check for waiters below and pairs with the barrier
+	 * in kgsl_timeline_fence_alloc(), so either we see a new fence on the
+	 * list or the fence sees the new value and signals itself.
+	 */
+	if (!kgsl_timeline_advance(timeline, seqno))
+		return;
 
-	spin_lock_irq(&timeline->lock);
+	trace_kgsl_timeline_signal(timeline->id, seqno);
 
-	if (seqno < timeline->value)
-		goto unlock;
+	/* Nobody is waiting so there is nothing else to do */
+	if (list_empty(&timeline->fences))
+		return;
 
-	trace_kgsl_timeline_signal(timeline->id, seqno);
+	INIT_LIST_HEAD(&temp);
 
-	timeline->value = seqno;
+	spin_lock_irq(&timeline->lock);
 
+	/*
+	 * The list is sorted by seqno so stop at the first fence that hasn't
+	 * expired. This makes a signal O(k) in the number of retired fences.
+	 */
 	spin_lock(&timeline->fence_lock);
-	list_for_each_entry_safe(fence, tmp, &timeline->fences, node)
-		if (timeline_fence_signaled(&fence->base) &&
-				kref_get_unless_zero(&fence->base.refcount))
-			list_move(&fence->node, &temp);
+	list_for_each_entry_safe(fence, tmp, &timeline->fences, node) {
+		if (!timeline_fence_signaled(&fence->base))
+			break;
+
+		if (kref_get_unless_zero(&fence->base.refcount))
+			list_move_tail(&fence->node, &temp);
+	}
 	spin_unlock(&timeline->fence_lock);
 
 	list_for_each_entry_safe(fence, tmp, &temp, node) {
+		list_del_init(&fence->node);
 		dma_fence_signal_locked(&fence->base);
 		dma_fence_put(&fence->base);
 	}
 
-unlock:
 	spin_unlock_irq(&timeline->lock);
 }
 
@@ -307,13 +353,18 @@ struct dma_fence *kgsl_timeline_fence_alloc(struct kgsl_timeline *timeline,
 	INIT_LIST_HEAD(&fence->node);
 
 	/*
-	 * Once fence is checked as not signaled, allow it to be added
-	 * in the list before other thread such as kgsl_timeline_signal
-	 * can get chance to signal.
+	 * Add the fence to the list before checking the timeline value. This
+	 * pairs with the lockless update in kgsl_timeline_signal(): if the
+	 * signaler didn't see the fence on the list we are guaranteed to see
+	 * the new value here and signal the fence ourselves.
 	 */
 	spin_lock_irq(&timeline->lock);
-	if (!dma_fence_is_signaled_locked(&fence->base))
+	if (!dma_fence_is_signaled_locked(&fence->base)) {
 		kgsl_timeline_add_fence(timeline, fence);
+		smp_mb();
+		if (dma_fence_is_signaled_locked(&fence->base))
+			kgsl_timeline_remove_fence(timeline, fence);
+	}
 
 	trace_kgsl_timeline_fence_alloc(timeline->id, seqno);
 	spin_unlock_irq(&timeline->lock);
@@ -356,6 +407,48 @@ struct kgsl_timeline *kgsl_timeline_by_id(struct kgsl_device *device,
 	return ret ? timeline : NULL;
 }
 
+/*
+ * Check if a wait on a list of timelines is already satisfied without
+ * allocating any fences. Return 1 if it is, 0 if the caller needs to wait or
+ * a negative error code.
+ */
+static int kgsl_timelines_expired(struct kgsl_device *device,
+		u64 timelines, u32 count, u64 usize, bool any)
+{
+	void __user *uptr = u64_to_user_ptr(timelines);
+	u32 i;
+
+	for (i = 0; i < count; i++) {
+		struct kgsl_timeline_val val;
+		struct kgsl_timeline *timeline;
+		bool expired;
+
+		if (copy_struct_from_user(&val, sizeof(val), uptr, usize))
+			return -EFAULT;
+
+		if (val.padding)
+			return -EINVAL;
+
+		timeline = kgsl_timeline_by_id(device, val.timeline);
+		if (!timeline)
+			return -ENOENT;
+
+		expired = !__dma_fence_is_later(val.seqno,
+			atomic64_read(&timeline->value));
+		kgsl_timeline_put(timeline);
+
+		if (any && expired)
+			return 1;
+
+		if (!any && !expired)
+			return 0;
+
+		uptr += usize;
+	}
+
+	return (!any && count) ? 1 : 0;
+}
+
 long kgsl_ioctl_timeline_wait(struct kgsl_device_private *dev_priv,
 		unsigned int cmd, void *data)
 {
@@ -372,6 +465,13 @@ long kgsl_ioctl_timeline_wait(struct kgsl_device_private *dev_priv,
 	if (param->padding)
 		return -EINVAL;
 
+	/* Most waits are for work that is already done so skip the fences */
+	ret = kgsl_timelines_expired(device, param->timelines, param->count,
+		param->timelines_size,
+		(param->flags == KGSL_TIMELINE_WAIT_ANY));
+	if (ret)
+		return ret < 0 ? ret : 0;
+
 	fence = kgsl_timelines_to_fence_array(device, param->timelines,
 		param->count, param->timelines_size,
 		(param->flags == KGSL_TIMELINE_WAIT_ANY));
@@ -419,7 +519,7 @@ long kgsl_ioctl_timeline_query(struct kgsl_device_private *dev_priv,
 	if (!timeline)
 		return -ENODEV;
 
-	param->seqno = timeline->value;
+	param->seqno = atomic64_read(&timeline->value);
 	kgsl_timeline_put(timeline);
 
 	return 0;
@@ -554,6 +654,7 @@ long kgsl_ioctl_timeline_destroy(struct kgsl_device_private *dev_priv,
 
 	spin_lock_irq(&timeline->lock);
 	list_for_each_entry_safe(fence, tmp, &temp, node) {
+		list_del_init(&fence->node);
 		dma_fence_set_error(&fence->base, -ENOENT);
 		dma_fence_signal_locked(&fence->base);
 		dma_fence_put(&fence->base);
@@ -14,15 +14,18 @@ struct kgsl_timeline {
 	u64 context;
 	/** @id: Timeline identifier */
 	int id;
-	/** @value: Current value of the timeline */
-	u64 value;
+	/**
+	 * @value: Current value of the timeline. Only ever moves forward and
+	 * is updated without a lock by kgsl_timeline_signal()
+	 */
+	atomic64_t value;
 	/** @fence_lock: Lock to protect @fences */
 	spinlock_t fence_lock;
 	/** @lock: Lock to use for locking each fence in @fences */
 	spinlock_t lock;
 	/** @ref: Reference count for the struct */
 	struct kref ref;
-	/** @fences: sorted list of active fences */
+	/** @fences: list of active fences sorted by seqno */
 	struct list_head fences;
 	/** @name: Name of the timeline for debugging */
 	const char name[32];
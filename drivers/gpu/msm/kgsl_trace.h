@@ -517,6 +517,35 @@ TRACE_EVENT(kgsl_mem_map,
 	)
 );
 
+/*
+ * Tracepoint for page pool allocations, hit is set when the pool had a
+ * zeroed page ready and the allocating thread did not have to get one
+ * from the system
+ */
+TRACE_EVENT(kgsl_pool_alloc_page,
+
+	TP_PROTO(unsigned int order, bool hit, int pool_pages),
+
+	TP_ARGS(order, hit, pool_pages),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, order)
+		__field(bool, hit)
+		__field(int, pool_pages)
+	),
+
+	TP_fast_assign(
+		__entry->order = order;
+		__entry->hit = hit;
+		__entry->pool_pages = pool_pages;
+	),
+
+	TP_printk(
+		"order=%u hit=%d pool_pages=%d",
+		__entry->order, __entry->hit, __entry->pool_pages
+	)
+);
+
 TRACE_EVENT(kgsl_mem_free,
 
 	TP_PROTO(struct kgsl_mem_entry *mem_entry),
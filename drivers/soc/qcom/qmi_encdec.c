@@ -158,20 +158,18 @@ static int qmi_calc_min_msg_len(struct qmi_elem_info *ei_array,
  * This function encodes the "elem_len" number of data elements, each of
  * size "elem_size" bytes from the source buffer "buf_src" and stores the
  * encoded information in the destination buffer "buf_dst". The elements are
- * of primary data type which include u8 - u64 or similar. This
- * function returns the number of bytes of encoded information.
+ * of primary data type which include u8 - u64 or similar. The elements are
+ * laid out back to back on both sides, so they are copied as a single span.
+ * This function returns the number of bytes of encoded information.
  *
  * Return: The number of bytes of encoded information.
  */
 static int qmi_encode_basic_elem(void *buf_dst, const void *buf_src,
 				 u32 elem_len, u32 elem_size)
 {
-	u32 i, rc = 0;
+	u32 rc = elem_len * elem_size;
 
-	for (i = 0; i < elem_len; i++) {
-		QMI_ENCDEC_ENCODE_N_BYTES(buf_dst, buf_src, elem_size);
-		rc += elem_size;
-	}
+	QMI_ENCDEC_ENCODE_N_BYTES(buf_dst, buf_src, rc);
 
 	return rc;
 }
@@ -432,23 +430,21 @@ static int qmi_encode(struct qmi_elem_info *ei_array, void *out_buf,
  * This function decodes the "elem_len" number of elements in QMI wire format,
  * each of size "elem_size" bytes from the source buffer "buf_src" and stores
  * the decoded elements in the destination buffer "buf_dst". The elements are
- * of primary data type which include u8 - u64 or similar. This
- * function returns the number of bytes of decoded information.
+ * of primary data type which include u8 - u64 or similar. As with encoding,
+ * the elements are copied as a single span. This function returns the number
+ * of bytes of decoded information.
  *
  * Return: The total size of the decoded data elements, in bytes.
  */
 static int qmi_decode_basic_elem(void *buf_dst, const void *buf_src,
 				 u32 elem_len, u32 elem_size, u32 src_len)
 {
-	u32 i, rc = 0;
+	u32 rc = elem_len * elem_size;
 
-	if (elem_len * elem_size > src_len)
+	if (rc > src_len)
 		return -EINVAL;
 
-	for (i = 0; i < elem_len; i++) {
-		QMI_ENCDEC_DECODE_N_BYTES(buf_dst, buf_src, elem_size);
-		rc += elem_size;
-	}
+	QMI_ENCDEC_DECODE_N_BYTES(buf_dst, buf_src, rc);
 
 	return rc;
 }
@@ -572,6 +568,7 @@ static int qmi_decode_string_elem(struct qmi_elem_info *ei_array,
 /**
  * find_ei() - Find element info corresponding to TLV Type
  * @ei_array: Struct info array of the message being decoded.
+ * @hint: Element to start searching from, must begin a TLV or be NULL.
  * @type: TLV Type of the element being searched.
  *
  * Every element that got encoded in the QMI message will have a type
@@ -579,12 +576,17 @@ static int qmi_decode_string_elem(struct qmi_elem_info *ei_array,
  * this function is used to find the struct info regarding the element
  * that corresponds to the type being decoded.
  *
+ * Peers encode TLVs in the order of the struct info array, so the search
+ * starts right after the previously decoded TLV and only wraps around to
+ * the start of the array when that misses. This keeps decoding linear in
+ * the number of elements instead of quadratic.
+ *
  * Return: Pointer to struct info, if found
  */
 static struct qmi_elem_info *find_ei(struct qmi_elem_info *ei_array,
-				     u32 type)
+				     struct qmi_elem_info *hint, u32 type)
 {
-	struct qmi_elem_info *temp_ei = ei_array;
+	struct qmi_elem_info *temp_ei = hint ? hint : ei_array;
 
 	while (temp_ei->data_type != QMI_EOTI) {
 		if (temp_ei->tlv_type == (u8)type)
@@ -592,6 +594,11 @@ static struct qmi_elem_info *find_ei(struct qmi_elem_info *ei_array,
 		temp_ei = temp_ei + 1;
 	}
 
+	for (temp_ei = ei_array; temp_ei != hint && hint; temp_ei++) {
+		if (temp_ei->tlv_type == (u8)type)
+			return temp_ei;
+	}
+
 	return NULL;
 }
 
@@ -612,6 +619,7 @@ static int qmi_decode(struct qmi_elem_info *ei_array, void *out_c_struct,
 		      int dec_level)
 {
 	struct qmi_elem_info *temp_ei = ei_array;
+	struct qmi_elem_info *next_ei = NULL;
 	u8 opt_flag_value = 1;
 	u32 data_len_value = 0, data_len_sz = 0;
 	u8 *buf_dst = out_c_struct;
@@ -636,7 +644,7 @@ static int qmi_decode(struct qmi_elem_info *ei_array, void *out_c_struct,
 					      &tlv_len, tlv_pointer);
 			buf_src += (TLV_TYPE_SIZE + TLV_LEN_SIZE);
 			decoded_bytes += (TLV_TYPE_SIZE + TLV_LEN_SIZE);
-			temp_ei = find_ei(ei_array, tlv_type);
+			temp_ei = find_ei(ei_array, next_ei, tlv_type);
 			if (!temp_ei && tlv_type < OPTIONAL_TLV_TYPE_START) {
 				pr_err("%s: Inval element info\n", __func__);
 				return -EINVAL;
@@ -729,6 +737,7 @@ static int qmi_decode(struct qmi_elem_info *ei_array, void *out_c_struct,
 			return -EINVAL;
 		}
 		temp_ei = temp_ei + 1;
+		next_ei = temp_ei;
 	}
 
 	return decoded_bytes;
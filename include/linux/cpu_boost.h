@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CPU_BOOST_H_
+#define _CPU_BOOST_H_
+
+#if IS_REACHABLE(CONFIG_CPU_BOOST)
+void cpu_boost_frame_committed(void);
+#else
+static inline void cpu_boost_frame_committed(void)
+{
+}
+#endif
+
+#endif /* _CPU_BOOST_H_ */
@@ -1087,6 +1087,8 @@ struct task_struct {
 #endif
 	u64				gtime;
 #ifdef CONFIG_CPU_FREQ_TIMES
+	/* Protects time_in_state and max_state: */
+	spinlock_t			time_in_state_lock;
 	u64				*time_in_state;
 	unsigned int			max_state;
 #endif
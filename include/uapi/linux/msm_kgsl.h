@@ -342,6 +342,7 @@ enum kgsl_timestamp_type {
 #define KGSL_PROP_CONTEXT_PROPERTY	0x28
 #define KGSL_PROP_GPU_MODEL		0x29
 #define KGSL_PROP_VK_DEVICE_ID		0x2A
+#define KGSL_PROP_CONTEXT_FRAME_BUDGET	0x2B
 
 /*
  * kgsl_capabilties_properties returns a list of supported properties.
@@ -431,6 +432,17 @@ struct kgsl_gpu_model {
 /* Context property sub types */
 #define KGSL_CONTEXT_PROP_FAULTS 1
 
+/**
+ * struct kgsl_context_frame_budget - Argument for KGSL_PROP_CONTEXT_FRAME_BUDGET
+ * @context_id: Context to set the frame budget for
+ * @budget_us: Target time in microseconds from the first submission of a
+ * frame to the retirement of its end of frame command. 0 clears the budget
+ */
+struct kgsl_context_frame_budget {
+	__u32 context_id;
+	__u32 budget_us;
+};
+
 /* Performance counter groups */
 
 #define KGSL_PERFCOUNTER_GROUP_CP 0x0
@@ -1871,6 +1883,39 @@ struct kgsl_timeline_fence_get {
  */
 #define IOCTL_KGSL_TIMELINE_DESTROY _IOW(KGSL_IOC_TYPE, 0x5D, __u32)
 
+#define KGSL_GPU_COMMAND_BATCH_FAULT 0x1
+
+/**
+ * struct kgsl_gpu_command_batch - Argument for IOCTL_KGSL_GPU_COMMAND_BATCH
+ * @cmdlist: List of &struct kgsl_gpu_command objects to submit
+ * @cmdsize: Size of each entry in @cmdlist
+ * @numcmds: Number of entries in @cmdlist
+ * @flags: Must be zero on input. On output KGSL_GPU_COMMAND_BATCH_FAULT is set
+ * if one of the contexts had previously faulted
+ * @count: Number of entries in @cmdlist that were queued [out]
+ *
+ * Submit several GPU commands, for one or more contexts, in a single call.
+ * Each entry is handled like an IOCTL_KGSL_GPU_COMMAND and its timestamp is
+ * written back to the entry in @cmdlist. Every entry is validated and its
+ * context and commands are set up before anything is queued, so a bad entry
+ * fails the ioctl with @count set to zero. The dispatcher is kicked once for
+ * the batch.
+ *
+ * If the dispatcher refuses an entry after some entries were queued the
+ * ioctl still succeeds and @count tells how many were queued. Submitting the
+ * remaining entries again reports the error.
+ */
+struct kgsl_gpu_command_batch {
+	__u64 cmdlist;
+	__u32 cmdsize;
+	__u32 numcmds;
+	__u32 flags;
+	__u32 count;
+};
+
+#define IOCTL_KGSL_GPU_COMMAND_BATCH \
+	_IOWR(KGSL_IOC_TYPE, 0x5E, struct kgsl_gpu_command_batch)
+
 /**
  * struct kgsl_gpu_aux_command_timeline - An aux command for timeline signals
  * @timelines: An array of &struct kgsl_timeline_val elements
@@ -82,6 +82,11 @@
 /* Bit-1 - 0 : Disable perf mode */
 #define COMPRESSED_PERF_MODE_FLAG 0x0002
 
+/* Shared ring flag */
+/* Bit-2 - 1 : Userspace fills the mmapped DSP buffer, write() commits */
+/* Bit-2 - 0 : write() copies the data into the DSP buffer */
+#define COMPRESSED_SHARED_RING_FLAG 0x0004
+
 /* Codecs are listed linearly to allow for extensibility */
 #define SND_AUDIOCODEC_PCM                   ((__u32) 0x00000001)
 #define SND_AUDIOCODEC_MP3                   ((__u32) 0x00000002)
@@ -0,0 +1,527 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Test cases for the QMI encoder/decoder in drivers/soc/qcom/qmi_encdec.c.
+ *
+ * The expected wire image of every message is built here one element at a
+ * time, the way the encoder used to copy them, and compared byte for byte
+ * against what qmi_encode_message() produces. The same image, with the TLVs
+ * reordered and an unknown optional TLV added, must decode back to the
+ * original structure.
+ *
+ * Once all tests pass, the encode/decode throughput of both messages is
+ * measured and reported in messages per second.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/soc/qcom/qmi.h>
+
+#define TEST_QMI_WORDS		4
+#define TEST_QMI_DATA_MAX	32
+#define TEST_QMI_PAIR_VALS	3
+#define TEST_QMI_PAIRS_MAX	4
+#define TEST_QMI_NAME_MAX	16
+#define TEST_QMI_BUF_LEN	512
+#define TEST_QMI_MSG_ID		0x42
+#define TEST_QMI_TXN_ID		7
+#define TEST_QMI_BENCH_ITERS	10000
+
+struct test_qmi_pair {
+	u8 id;
+	u16 vals[TEST_QMI_PAIR_VALS];
+	u32 flags;
+};
+
+struct test_qmi_msg {
+	u16 words[TEST_QMI_WORDS];
+	struct qmi_response_type_v01 resp;
+	u32 data_len;
+	u8 data[TEST_QMI_DATA_MAX];
+	u8 opt_val_valid;
+	u32 opt_val;
+	u8 opt_wide_valid;
+	u64 opt_wide;
+	u8 pairs_valid;
+	u32 pairs_len;
+	struct test_qmi_pair pairs[TEST_QMI_PAIRS_MAX];
+	u8 name_valid;
+	char name[TEST_QMI_NAME_MAX + 1];
+};
+
+static struct qmi_elem_info test_qmi_pair_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+		.offset		= offsetof(struct test_qmi_pair, id),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_2_BYTE,
+		.elem_len	= TEST_QMI_PAIR_VALS,
+		.elem_size	= sizeof(u16),
+		.array_type	= STATIC_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+		.offset		= offsetof(struct test_qmi_pair, vals),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+		.offset		= offsetof(struct test_qmi_pair, flags),
+	},
+	{
+		.data_type	= QMI_EOTI,
+		.array_type	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+	},
+};
+
+static struct qmi_elem_info test_qmi_msg_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_2_BYTE,
+		.elem_len	= TEST_QMI_WORDS,
+		.elem_size	= sizeof(u16),
+		.array_type	= STATIC_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct test_qmi_msg, words),
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct test_qmi_msg, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{
+		.data_type	= QMI_DATA_LEN,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x03,
+		.offset		= offsetof(struct test_qmi_msg, data_len),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= TEST_QMI_DATA_MAX,
+		.elem_size	= sizeof(u8),
+		.array_type	= VAR_LEN_ARRAY,
+		.tlv_type	= 0x03,
+		.offset		= offsetof(struct test_qmi_msg, data),
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct test_qmi_msg, opt_val_valid),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct test_qmi_msg, opt_val),
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x11,
+		.offset		= offsetof(struct test_qmi_msg, opt_wide_valid),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_8_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u64),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x11,
+		.offset		= offsetof(struct test_qmi_msg, opt_wide),
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x12,
+		.offset		= offsetof(struct test_qmi_msg, pairs_valid),
+	},
+	{
+		.data_type	= QMI_DATA_LEN,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u16),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x12,
+		.offset		= offsetof(struct test_qmi_msg, pairs_len),
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= TEST_QMI_PAIRS_MAX,
+		.elem_size	= sizeof(struct test_qmi_pair),
+		.array_type	= VAR_LEN_ARRAY,
+		.tlv_type	= 0x12,
+		.offset		= offsetof(struct test_qmi_msg, pairs),
+		.ei_array	= test_qmi_pair_ei,
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x13,
+		.offset		= offsetof(struct test_qmi_msg, name_valid),
+	},
+	{
+		.data_type	= QMI_STRING,
+		.elem_len	= TEST_QMI_NAME_MAX + 1,
+		.elem_size	= sizeof(char),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x13,
+		.offset		= offsetof(struct test_qmi_msg, name),
+	},
+	{
+		.data_type	= QMI_EOTI,
+		.array_type	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+	},
+};
+
+/* Wire image of a message, starting with room for the QMI header */
+struct test_qmi_buf {
+	u8 data[TEST_QMI_BUF_LEN];
+	size_t len;
+	size_t tlv;
+};
+
+static unsigned total_tests __initdata;
+static unsigned failed_tests __initdata;
+
+static struct test_qmi_msg test_qmi_src __initdata;
+static struct test_qmi_msg test_qmi_dst __initdata;
+static struct test_qmi_buf test_qmi_expected __initdata;
+
+static void __init test_qmi_put(struct test_qmi_buf *b, const void *src,
+				u32 elem_len, u32 elem_size)
+{
+	u32 i;
+
+	for (i = 0; i < elem_len; i++) {
+		memcpy(&b->data[b->len], src, elem_size);
+		src += elem_size;
+		b->len += elem_size;
+	}
+}
+
+static void __init test_qmi_tlv_start(struct test_qmi_buf *b, u8 type)
+{
+	b->tlv = b->len;
+	b->data[b->len] = type;
+	b->len += 3;
+}
+
+static void __init test_qmi_tlv_end(struct test_qmi_buf *b)
+{
+	size_t len = b->len - b->tlv - 3;
+
+	b->data[b->tlv + 1] = len & 0xff;
+	b->data[b->tlv + 2] = len >> 8;
+}
+
+static void __init test_qmi_put_words(struct test_qmi_buf *b,
+				      const struct test_qmi_msg *m)
+{
+	test_qmi_tlv_start(b, 0x01);
+	test_qmi_put(b, m->words, TEST_QMI_WORDS, sizeof(u16));
+	test_qmi_tlv_end(b);
+}
+
+static void __init test_qmi_put_resp(struct test_qmi_buf *b,
+				     const struct test_qmi_msg *m)
+{
+	test_qmi_tlv_start(b, 0x02);
+	test_qmi_put(b, &m->resp.result, 1, sizeof(u16));
+	test_qmi_put(b, &m->resp.error, 1, sizeof(u16));
+	test_qmi_tlv_end(b);
+}
+
+static void __init test_qmi_put_data(struct test_qmi_buf *b,
+				     const struct test_qmi_msg *m)
+{
+	u8 len = m->data_len;
+
+	test_qmi_tlv_start(b, 0x03);
+	test_qmi_put(b, &len, 1, sizeof(u8));
+	test_qmi_put(b, m->data, m->data_len, sizeof(u8));
+	test_qmi_tlv_end(b);
+}
+
+static void __init test_qmi_put_opt_val(struct test_qmi_buf *b,
+					const struct test_qmi_msg *m)
+{
+	if (!m->opt_val_valid)
+		return;
+
+	test_qmi_tlv_start(b, 0x10);
+	test_qmi_put(b, &m->opt_val, 1, sizeof(u32));
+	test_qmi_tlv_end(b);
+}
+
+static void __init test_qmi_put_opt_wide(struct test_qmi_buf *b,
+					 const struct test_qmi_msg *m)
+{
+	if (!m->opt_wide_valid)
+		return;
+
+	test_qmi_tlv_start(b, 0x11);
+	test_qmi_put(b, &m->opt_wide, 1, sizeof(u64));
+	test_qmi_tlv_end(b);
+}
+
+static void __init test_qmi_put_pairs(struct test_qmi_buf *b,
+				      const struct test_qmi_msg *m)
+{
+	u16 len = m->pairs_len;
+	u32 i;
+
+	if (!m->pairs_valid)
+		return;
+
+	test_qmi_tlv_start(b, 0x12);
+	test_qmi_put(b, &len, 1, sizeof(u16));
+	for (i = 0; i < m->pairs_len; i++) {
+		test_qmi_put(b, &m->pairs[i].id, 1, sizeof(u8));
+		test_qmi_put(b, m->pairs[i].vals, TEST_QMI_PAIR_VALS,
+			     sizeof(u16));
+		test_qmi_put(b, &m->pairs[i].flags, 1, sizeof(u32));
+	}
+	test_qmi_tlv_end(b);
+}
+
+static void __init test_qmi_put_name(struct test_qmi_buf *b,
+				     const struct test_qmi_msg *m)
+{
+	if (!m->name_valid)
+		return;
+
+	test_qmi_tlv_start(b, 0x13);
+	test_qmi_put(b, m->name, strlen(m->name), sizeof(char));
+	test_qmi_tlv_end(b);
+}
+
+/* An optional TLV the struct info array does not know about */
+static void __init test_qmi_put_unknown(struct test_qmi_buf *b,
+					const struct test_qmi_msg *m)
+{
+	static const u8 junk[] __initconst = { 0xde, 0xad, 0xbe, 0xef, 0x55 };
+
+	test_qmi_tlv_start(b, 0x20);
+	test_qmi_put(b, junk, ARRAY_SIZE(junk), sizeof(u8));
+	test_qmi_tlv_end(b);
+}
+
+typedef void (*test_qmi_put_fn)(struct test_qmi_buf *b,
+				const struct test_qmi_msg *m);
+
+static const test_qmi_put_fn test_qmi_table_order[] __initconst = {
+	test_qmi_put_words,
+	test_qmi_put_resp,
+	test_qmi_put_data,
+	test_qmi_put_opt_val,
+	test_qmi_put_opt_wide,
+	test_qmi_put_pairs,
+	test_qmi_put_name,
+};
+
+static const test_qmi_put_fn test_qmi_shuffled_order[] __initconst = {
+	test_qmi_put_name,
+	test_qmi_put_unknown,
+	test_qmi_put_pairs,
+	test_qmi_put_data,
+	test_qmi_put_opt_wide,
+	test_qmi_put_words,
+	test_qmi_put_opt_val,
+	test_qmi_put_resp,
+};
+
+static void __init test_qmi_build(struct test_qmi_buf *b,
+				  const struct test_qmi_msg *m,
+				  const test_qmi_put_fn *order,
+				  unsigned int n)
+{
+	unsigned int i;
+
+	memset(b, 0, sizeof(*b));
+	b->len = sizeof(struct qmi_header);
+	for (i = 0; i < n; i++)
+		order[i](b, m);
+}
+
+static void __init test_qmi_fill(struct test_qmi_msg *m, bool full)
+{
+	u32 i, j;
+
+	memset(m, 0, sizeof(*m));
+
+	for (i = 0; i < TEST_QMI_WORDS; i++)
+		m->words[i] = 0x1234 + i * 0x1111;
+	m->resp.result = QMI_RESULT_FAILURE_V01;
+	m->resp.error = QMI_ERR_MALFORMED_MSG_V01;
+
+	m->data_len = full ? TEST_QMI_DATA_MAX : 1;
+	for (i = 0; i < m->data_len; i++)
+		m->data[i] = 0xa0 ^ i;
+
+	if (!full)
+		return;
+
+	m->opt_val_valid = 1;
+	m->opt_val = 0xcafef00d;
+	m->opt_wide_valid = 1;
+	m->opt_wide = 0x0123456789abcdefULL;
+
+	m->pairs_valid = 1;
+	m->pairs_len = TEST_QMI_PAIRS_MAX - 1;
+	for (i = 0; i < m->pairs_len; i++) {
+		m->pairs[i].id = i + 1;
+		for (j = 0; j < TEST_QMI_PAIR_VALS; j++)
+			m->pairs[i].vals[j] = (i << 8) | j;
+		m->pairs[i].flags = BIT(i) | 0x80000000;
+	}
+
+	m->name_valid = 1;
+	strscpy(m->name, "qmi-selftest", sizeof(m->name));
+}
+
+static void __init test_qmi_failed(const char *what, bool full)
+{
+	pr_err("test #%u %s failed on the %s message\n",
+	       total_tests, what, full ? "full" : "minimal");
+	failed_tests++;
+}
+
+static void __init test_qmi_decode(const char *what, bool full,
+				   const void *buf, size_t len)
+{
+	int ret;
+
+	total_tests++;
+	memset(&test_qmi_dst, 0, sizeof(test_qmi_dst));
+	ret = qmi_decode_message(buf, len, test_qmi_msg_ei, &test_qmi_dst);
+	if (ret < 0 ||
+	    memcmp(&test_qmi_dst, &test_qmi_src, sizeof(test_qmi_src)))
+		test_qmi_failed(what, full);
+}
+
+static void __init test_qmi_message(bool full)
+{
+	struct test_qmi_buf *b = &test_qmi_expected;
+	struct qmi_header *hdr;
+	size_t len = TEST_QMI_BUF_LEN - sizeof(*hdr);
+	void *msg;
+
+	test_qmi_fill(&test_qmi_src, full);
+	test_qmi_build(b, &test_qmi_src, test_qmi_table_order,
+		       ARRAY_SIZE(test_qmi_table_order));
+
+	/* Encoding must match the per element image byte for byte */
+	total_tests++;
+	msg = qmi_encode_message(QMI_REQUEST, TEST_QMI_MSG_ID, &len,
+				 TEST_QMI_TXN_ID, test_qmi_msg_ei,
+				 &test_qmi_src);
+	if (IS_ERR(msg)) {
+		test_qmi_failed("encode", full);
+		return;
+	}
+
+	hdr = msg;
+	if (len != b->len || hdr->msg_len != b->len - sizeof(*hdr) ||
+	    memcmp(msg + sizeof(*hdr), b->data + sizeof(*hdr),
+		   b->len - sizeof(*hdr)))
+		test_qmi_failed("encode compare", full);
+
+	test_qmi_decode("round trip", full, msg, len);
+	kfree(msg);
+
+	/* Peers may send TLVs in any order, and ones we do not know */
+	test_qmi_build(b, &test_qmi_src, test_qmi_shuffled_order,
+		       ARRAY_SIZE(test_qmi_shuffled_order));
+	test_qmi_decode("out of order decode", full, b->data, b->len);
+}
+
+/* Time encoding and decoding back the same message over many iterations */
+static void __init test_qmi_bench(bool full)
+{
+	size_t len;
+	u64 start, ns;
+	void *msg;
+	int i, ret;
+
+	test_qmi_fill(&test_qmi_src, full);
+
+	start = ktime_get_ns();
+	for (i = 0; i < TEST_QMI_BENCH_ITERS; i++) {
+		len = TEST_QMI_BUF_LEN - sizeof(struct qmi_header);
+		msg = qmi_encode_message(QMI_REQUEST, TEST_QMI_MSG_ID, &len,
+					 TEST_QMI_TXN_ID, test_qmi_msg_ei,
+					 &test_qmi_src);
+		if (IS_ERR(msg)) {
+			pr_err("benchmark encode failed: %ld\n", PTR_ERR(msg));
+			return;
+		}
+
+		ret = qmi_decode_message(msg, len, test_qmi_msg_ei,
+					 &test_qmi_dst);
+		kfree(msg);
+		if (ret < 0) {
+			pr_err("benchmark decode failed: %d\n", ret);
+			return;
+		}
+	}
+	ns = max_t(u64, ktime_get_ns() - start, 1);
+
+	pr_info("%s message: %llu encode+decode/sec (%zu bytes, %llu ns each)\n",
+		full ? "full" : "minimal",
+		div64_u64((u64)TEST_QMI_BENCH_ITERS * NSEC_PER_SEC, ns), len,
+		div_u64(ns, TEST_QMI_BENCH_ITERS));
+}
+
+static int __init test_qmi_encdec_init(void)
+{
+	test_qmi_message(false);
+	test_qmi_message(true);
+
+	if (failed_tests == 0) {
+		pr_info("all %u tests passed\n", total_tests);
+		test_qmi_bench(false);
+		test_qmi_bench(true);
+	} else {
+		pr_err("failed %u out of %u tests\n", failed_tests, total_tests);
+	}
+
+	return failed_tests ? -EINVAL : 0;
+}
+module_init(test_qmi_encdec_init);
+
+static void __exit test_qmi_encdec_exit(void)
+{
+	/* do nothing */
+}
+module_exit(test_qmi_encdec_exit);
+
+MODULE_DESCRIPTION("QMI encoder/decoder self-test");
+MODULE_LICENSE("GPL v2");
@@ -396,7 +396,37 @@ static ssize_t snd_compr_read(struct file *f, char __user *buf,
 
 static int snd_compr_mmap(struct file *f, struct vm_area_struct *vma)
 {
-	return -ENXIO;
+	struct snd_compr_file *data = f->private_data;
+	struct snd_compr_stream *stream;
+	int retval;
+
+	if (snd_BUG_ON(!data))
+		return -EFAULT;
+
+	stream = &data->stream;
+	if (!stream->ops->mmap)
+		return -ENXIO;
+
+	/*
+	 * mmap_sem is held here, and write/ioctl take device->lock before
+	 * touching user memory, so taking device->lock would invert the
+	 * lock order. Check the state without it, as snd_pcm_mmap() does:
+	 * the buffer is set up by set_params and only freed on release,
+	 * which cannot run while this file is being mapped or is mapped.
+	 */
+	switch (READ_ONCE(stream->runtime->state)) {
+	case SNDRV_PCM_STATE_SETUP:
+	case SNDRV_PCM_STATE_PREPARED:
+	case SNDRV_PCM_STATE_RUNNING:
+	case SNDRV_PCM_STATE_PAUSED:
+	case SNDRV_PCM_STATE_DRAINING:
+		retval = stream->ops->mmap(stream, vma);
+		break;
+	default:
+		retval = -EBADFD;
+		break;
+	}
+	return retval;
 }
 
 static __poll_t snd_compr_get_poll(struct snd_compr_stream *stream)
@@ -920,6 +920,29 @@ static int soc_compr_copy(struct snd_compr_stream *cstream,
 	return ret;
 }
 
+static int soc_compr_mmap(struct snd_compr_stream *cstream,
+			  struct vm_area_struct *vma)
+{
+	struct snd_soc_pcm_runtime *rtd = cstream->private_data;
+	struct snd_soc_component *component;
+	struct snd_soc_rtdcom_list *rtdcom;
+	int ret = -ENXIO;
+
+	/* called with mmap_sem held, so pcm_mutex must not be taken here */
+	for_each_rtdcom(rtd, rtdcom) {
+		component = rtdcom->component;
+
+		if (!component->driver->compr_ops ||
+		    !component->driver->compr_ops->mmap)
+			continue;
+
+		ret = component->driver->compr_ops->mmap(cstream, vma);
+		break;
+	}
+
+	return ret;
+}
+
 static int sst_compr_set_next_track_param(struct snd_compr_stream *cstream,
 				union snd_codec_options *codec_options)
 {
@@ -1135,6 +1158,17 @@ int snd_soc_new_compress(struct snd_soc_pcm_runtime *rtd, int num)
 		break;
 	}
 
+	for_each_rtdcom(rtd, rtdcom) {
+		component = rtdcom->component;
+
+		if (!component->driver->compr_ops ||
+		    !component->driver->compr_ops->mmap)
+			continue;
+
+		compr->ops->mmap = soc_compr_mmap;
+		break;
+	}
+
 	mutex_init(&compr->lock);
 	ret = snd_compress_new(rtd->card->snd_card, num, direction,
 				new_name, compr);
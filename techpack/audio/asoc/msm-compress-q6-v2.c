@@ -82,6 +82,10 @@ const DECLARE_TLV_DB_LINEAR(msm_compr_vol_gain, 0,
 #define COMPRESSED_PERF_MODE_FLAG 0
 #endif
 
+#ifndef COMPRESSED_SHARED_RING_FLAG
+#define COMPRESSED_SHARED_RING_FLAG 0
+#endif
+
 #define DSD_BLOCK_SIZE_4 4
 
 struct msm_compr_gapless_state {
@@ -138,6 +142,8 @@ struct msm_compr_audio {
 
 	uint32_t ts_header_offset; /* holds the timestamp header offset */
 
+	bool shared_ring; /* userspace writes the DSP buffer in place */
+
 	int32_t first_buffer;
 	int32_t last_buffer;
 	int32_t partial_drain_delay;
@@ -506,6 +512,20 @@ static int msm_compr_send_buffer(struct msm_compr_audio *prtd)
 	if (bytes_available < prtd->codec_param.buffer.fragment_size)
 		buffer_length = bytes_available;
 
+	/*
+	 * In shared ring mode the data is already in the DSP buffer, so
+	 * hand over every whole fragment committed so far in one write.
+	 * Cap it at half the ring to leave room for userspace to refill.
+	 */
+	if (prtd->shared_ring && !prtd->ts_header_offset &&
+	    !atomic_read(&prtd->drain) && bytes_available > buffer_length) {
+		uint32_t frag = prtd->codec_param.buffer.fragment_size;
+		uint64_t batch = max_t(uint32_t, prtd->buffer_size / 2, frag);
+
+		batch = min_t(uint64_t, batch, bytes_available);
+		buffer_length = batch - (batch % frag);
+	}
+
 	if (prtd->byte_offset + buffer_length > prtd->buffer_size) {
 		buffer_length = (prtd->buffer_size - prtd->byte_offset);
 		pr_debug("%s: wrap around situation, send partial data %d now",
@@ -1531,6 +1551,10 @@ static int msm_compr_configure_dsp_for_playback
 	else
 		prtd->ts_header_offset = 0;
 
+	/* Bit-2 of flags represent shared ring mode */
+	prtd->shared_ring = !!(prtd->codec_param.codec.flags &
+			       COMPRESSED_SHARED_RING_FLAG);
+
 	ret = msm_compr_send_media_format_block(cstream, ac->stream_id, false);
 	if (ret < 0)
 		pr_err("%s, failed to send media format block\n", __func__);
@@ -3041,7 +3065,15 @@ static int msm_compr_playback_copy(struct snd_compr_stream *cstream,
 	spin_unlock_irqrestore(&prtd->lock, flags);
 
 	dstn = prtd->buffer + prtd->app_pointer;
-	if (count < prtd->buffer_size - prtd->app_pointer) {
+	if (prtd->shared_ring) {
+		/*
+		 * Userspace has already written the data through its
+		 * mapping of the DSP buffer, only advance the write index.
+		 */
+		prtd->app_pointer += count;
+		if (prtd->app_pointer >= prtd->buffer_size)
+			prtd->app_pointer -= prtd->buffer_size;
+	} else if (count < prtd->buffer_size - prtd->app_pointer) {
 		if (copy_from_user(dstn, buf, count))
 			return -EFAULT;
 		prtd->app_pointer += count;
@@ -3134,6 +3166,54 @@ static int msm_compr_copy(struct snd_compr_stream *cstream,
 	return ret;
 }
 
+static int msm_compr_mmap(struct snd_compr_stream *cstream,
+			  struct vm_area_struct *vma)
+{
+	struct snd_compr_runtime *runtime = cstream->runtime;
+	struct msm_compr_audio *prtd = runtime->private_data;
+	struct audio_client *ac = prtd->audio_client;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	int ret;
+
+	if (cstream->direction != SND_COMPRESS_PLAYBACK) {
+		pr_err("%s: shared ring is only supported for playback\n",
+			__func__);
+		return -EINVAL;
+	}
+
+	if (!ac || !prtd->buffer) {
+		pr_err("%s: Buffer is not allocated yet ??\n", __func__);
+		return -EINVAL;
+	}
+
+	/*
+	 * write() keeps copying into the ring unless shared ring mode was
+	 * asked for in set_params, so refuse a mapping it would overwrite.
+	 */
+	if (!prtd->shared_ring) {
+		pr_err("%s: shared ring mode not enabled in set_params\n",
+			__func__);
+		return -EINVAL;
+	}
+
+	if (vma->vm_pgoff || size > PAGE_ALIGN(prtd->buffer_size)) {
+		pr_err("%s: invalid mapping, pgoff %lu size %lu\n",
+			__func__, vma->vm_pgoff, size);
+		return -EINVAL;
+	}
+
+	ret = msm_audio_ion_mmap(&ac->port[IN].buf[0], vma);
+	if (ret < 0) {
+		pr_err("%s: failed to map DSP buffer, ret %d\n",
+			__func__, ret);
+		return ret;
+	}
+
+	pr_debug("%s: mapped %lu bytes of %u byte ring\n",
+		 __func__, size, prtd->buffer_size);
+	return 0;
+}
+
 static int msm_compr_get_caps(struct snd_compr_stream *cstream,
 				struct snd_compr_caps *arg)
 {
@@ -5535,6 +5615,7 @@ static struct snd_compr_ops msm_compr_ops = {
 	.set_next_track_param	= msm_compr_set_next_track_param,
 	.ack			= msm_compr_ack,
 	.copy			= msm_compr_copy,
+	.mmap			= msm_compr_mmap,
 	.get_caps		= msm_compr_get_caps,
 	.get_codec_caps		= msm_compr_get_codec_caps,
 };
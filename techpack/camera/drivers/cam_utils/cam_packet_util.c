@@ -6,11 +6,25 @@
 
 #include <linux/types.h>
 #include <linux/slab.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "cam_mem_mgr.h"
 #include "cam_packet_util.h"
 #include "cam_debug_util.h"
 
+/* Patch counters summed over all packets, read from debugfs */
+static struct cam_packet_patch_stats {
+	atomic64_t packets;
+	atomic64_t patches;
+	atomic64_t src_lookups;
+	atomic64_t dst_lookups;
+	atomic_t   last_patches;
+	atomic_t   last_src_lookups;
+	atomic_t   last_dst_lookups;
+} cam_packet_patch_stats;
+
 int cam_packet_util_get_cmd_mem_addr(int handle, uint32_t **buf_addr,
 	size_t *len)
 {
@@ -227,9 +241,152 @@ void cam_packet_dump_patch_info(struct cam_packet *packet,
 	}
 }
 
+static int cam_packet_util_patch_get_src(
+	struct cam_packet_patch_cache *cache, int32_t src_hdl,
+	int32_t iommu_hdl, int32_t sec_mmu_hdl,
+	dma_addr_t *iova_addr, size_t *src_buf_size)
+{
+	struct cam_packet_patch_src *entry;
+	int32_t hdl;
+	int     i, rc;
+
+	/* consecutive patches usually point at the same buffer */
+	for (i = (int)cache->num_src - 1; i >= 0; i--) {
+		entry = &cache->src[i];
+		if (entry->hdl == src_hdl) {
+			*iova_addr = entry->iova;
+			*src_buf_size = entry->len;
+			return 0;
+		}
+	}
+
+	hdl = cam_mem_is_secure_buf(src_hdl) ? sec_mmu_hdl : iommu_hdl;
+	cache->src_lookups++;
+	rc = cam_mem_get_io_buf(src_hdl, hdl, iova_addr, src_buf_size);
+	if (rc < 0)
+		return rc;
+
+	if (cache->num_src < CAM_PACKET_PATCH_CACHE_SIZE) {
+		entry = &cache->src[cache->num_src++];
+		entry->hdl = src_hdl;
+		entry->iova = *iova_addr;
+		entry->len = *src_buf_size;
+	}
+
+	return rc;
+}
+
+static int cam_packet_util_patch_get_dst(
+	struct cam_packet_patch_cache *cache, int32_t dst_hdl,
+	uintptr_t *cpu_addr, size_t *dst_buf_len, bool *cached)
+{
+	struct cam_packet_patch_dst *entry;
+	int     i, rc;
+
+	for (i = (int)cache->num_dst - 1; i >= 0; i--) {
+		entry = &cache->dst[i];
+		if (entry->hdl == dst_hdl) {
+			*cpu_addr = entry->cpu_addr;
+			*dst_buf_len = entry->len;
+			*cached = true;
+			return 0;
+		}
+	}
+
+	*cached = false;
+	cache->dst_lookups++;
+	rc = cam_mem_get_cpu_buf(dst_hdl, cpu_addr, dst_buf_len);
+	if (rc < 0)
+		return rc;
+
+	if (!*cpu_addr || (*dst_buf_len == 0)) {
+		cam_mem_put_cpu_buf(dst_hdl);
+		return rc;
+	}
+
+	/* keep the mapping until every patch of the packet is applied */
+	if (cache->num_dst < CAM_PACKET_PATCH_CACHE_SIZE) {
+		entry = &cache->dst[cache->num_dst++];
+		entry->hdl = dst_hdl;
+		entry->cpu_addr = *cpu_addr;
+		entry->len = *dst_buf_len;
+		*cached = true;
+	}
+
+	return rc;
+}
+
+static void cam_packet_util_patch_cache_release(
+	struct cam_packet_patch_cache *cache)
+{
+	int i;
+
+	for (i = 0; i < cache->num_dst; i++)
+		cam_mem_put_cpu_buf(cache->dst[i].hdl);
+	cache->num_dst = 0;
+}
+
+static void cam_packet_util_patch_stats_update(uint32_t num_patches,
+	struct cam_packet_patch_cache *cache)
+{
+	struct cam_packet_patch_stats *stats = &cam_packet_patch_stats;
+
+	atomic64_inc(&stats->packets);
+	atomic64_add(num_patches, &stats->patches);
+	atomic64_add(cache->src_lookups, &stats->src_lookups);
+	atomic64_add(cache->dst_lookups, &stats->dst_lookups);
+	atomic_set(&stats->last_patches, num_patches);
+	atomic_set(&stats->last_src_lookups, cache->src_lookups);
+	atomic_set(&stats->last_dst_lookups, cache->dst_lookups);
+}
+
+static int cam_packet_util_patch_stats_show(struct seq_file *s, void *unused)
+{
+	struct cam_packet_patch_stats *stats = &cam_packet_patch_stats;
+
+	seq_printf(s, "packets: %lld\n",
+		(s64)atomic64_read(&stats->packets));
+	seq_printf(s, "patches: %lld\n",
+		(s64)atomic64_read(&stats->patches));
+	seq_printf(s, "src_lookups: %lld\n",
+		(s64)atomic64_read(&stats->src_lookups));
+	seq_printf(s, "dst_lookups: %lld\n",
+		(s64)atomic64_read(&stats->dst_lookups));
+	seq_printf(s, "last_patches: %d\n",
+		atomic_read(&stats->last_patches));
+	seq_printf(s, "last_src_lookups: %d\n",
+		atomic_read(&stats->last_src_lookups));
+	seq_printf(s, "last_dst_lookups: %d\n",
+		atomic_read(&stats->last_dst_lookups));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(cam_packet_util_patch_stats);
+
+static int __init cam_packet_util_debugfs_init(void)
+{
+	struct dentry *dentry;
+
+	dentry = debugfs_create_dir("cam_packet", NULL);
+	if (IS_ERR_OR_NULL(dentry)) {
+		CAM_DBG(CAM_UTIL, "debugfs not available");
+		return 0;
+	}
+
+	if (!debugfs_create_file("patch_stats", 0444, dentry, NULL,
+		&cam_packet_util_patch_stats_fops)) {
+		CAM_ERR(CAM_UTIL, "failed to create patch_stats");
+		debugfs_remove_recursive(dentry);
+	}
+
+	return 0;
+}
+late_initcall(cam_packet_util_debugfs_init);
+
 int cam_packet_util_process_patches(struct cam_packet *packet,
 	int32_t iommu_hdl, int32_t sec_mmu_hdl)
 {
+	struct cam_packet_patch_cache cache;
 	struct cam_patch_desc *patch_desc = NULL;
 	dma_addr_t iova_addr;
 	uintptr_t  cpu_addr = 0;
@@ -240,7 +397,7 @@ int cam_packet_util_process_patches(struct cam_packet *packet,
 	size_t     src_buf_size;
 	int        i;
 	int        rc = 0;
-	int32_t    hdl;
+	bool       dst_cached = false;
 
 	/* process patch descriptor */
 	patch_desc = (struct cam_patch_desc *)
@@ -250,23 +407,28 @@ int cam_packet_util_process_patches(struct cam_packet *packet,
 			(void *)packet, (void *)patch_desc,
 			sizeof(struct cam_patch_desc));
 
+	cache.num_src = 0;
+	cache.num_dst = 0;
+	cache.src_lookups = 0;
+	cache.dst_lookups = 0;
+
 	for (i = 0; i < packet->num_patches; i++) {
-		hdl = cam_mem_is_secure_buf(patch_desc[i].src_buf_hdl) ?
-			sec_mmu_hdl : iommu_hdl;
-		rc = cam_mem_get_io_buf(patch_desc[i].src_buf_hdl,
-			hdl, &iova_addr, &src_buf_size);
+		rc = cam_packet_util_patch_get_src(&cache,
+			patch_desc[i].src_buf_hdl, iommu_hdl, sec_mmu_hdl,
+			&iova_addr, &src_buf_size);
 		if (rc < 0) {
 			CAM_ERR(CAM_UTIL, "unable to get src buf address");
-			return rc;
+			goto end;
 		}
 		src_buf_iova_addr = (uint32_t *)iova_addr;
 		temp = iova_addr;
 
-		rc = cam_mem_get_cpu_buf(patch_desc[i].dst_buf_hdl,
-			&cpu_addr, &dst_buf_len);
+		rc = cam_packet_util_patch_get_dst(&cache,
+			patch_desc[i].dst_buf_hdl, &cpu_addr, &dst_buf_len,
+			&dst_cached);
 		if (rc < 0 || !cpu_addr || (dst_buf_len == 0)) {
 			CAM_ERR(CAM_UTIL, "unable to get dst buf address");
-			return rc;
+			goto end;
 		}
 		dst_cpu_addr = (uint32_t *)cpu_addr;
 
@@ -277,7 +439,8 @@ int cam_packet_util_process_patches(struct cam_packet *packet,
 		if ((size_t)patch_desc[i].src_offset >= src_buf_size) {
 			CAM_ERR(CAM_UTIL,
 				"Invalid src buf patch offset");
-			return -EINVAL;
+			rc = -EINVAL;
+			goto put_dst;
 		}
 
 		if ((dst_buf_len < sizeof(void *)) ||
@@ -285,8 +448,8 @@ int cam_packet_util_process_patches(struct cam_packet *packet,
 			(size_t)patch_desc[i].dst_offset)) {
 			CAM_ERR(CAM_UTIL,
 				"Invalid dst buf patch offset");
-			cam_mem_put_cpu_buf((int32_t)patch_desc[i].dst_buf_hdl);
-			return -EINVAL;
+			rc = -EINVAL;
+			goto put_dst;
 		}
 
 		dst_cpu_addr = (uint32_t *)((uint8_t *)dst_cpu_addr +
@@ -299,9 +462,23 @@ int cam_packet_util_process_patches(struct cam_packet *packet,
 			"patch is done for dst %pK with src %pK value %llx",
 			dst_cpu_addr, src_buf_iova_addr,
 			*((uint64_t *)dst_cpu_addr));
-		cam_mem_put_cpu_buf((int32_t)patch_desc[i].dst_buf_hdl);
+		if (!dst_cached)
+			cam_mem_put_cpu_buf((int32_t)patch_desc[i].dst_buf_hdl);
 	}
 
+	CAM_DBG(CAM_UTIL,
+		"packet %pK patches %u src lookups %u dst lookups %u",
+		(void *)packet, packet->num_patches,
+		cache.src_lookups, cache.dst_lookups);
+	cam_packet_util_patch_stats_update(packet->num_patches, &cache);
+	cam_packet_util_patch_cache_release(&cache);
+	return rc;
+
+put_dst:
+	if (!dst_cached)
+		cam_mem_put_cpu_buf((int32_t)patch_desc[i].dst_buf_hdl);
+end:
+	cam_packet_util_patch_cache_release(&cache);
 	return rc;
 }
 
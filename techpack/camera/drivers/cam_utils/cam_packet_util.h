@@ -27,6 +27,61 @@ struct cam_kmd_buf_info {
 	uint32_t   used_bytes;
 };
 
+/* Max distinct src/dst buffers resolved once per packet while patching */
+#define CAM_PACKET_PATCH_CACHE_SIZE 8
+
+/**
+ * @brief                  Resolved patch source buffer
+ *
+ * @hdl:                   Memory handle of the source buffer
+ * @iova:                  IO virtual address of the buffer
+ * @len:                   Size of the buffer
+ *
+ */
+struct cam_packet_patch_src {
+	int32_t     hdl;
+	dma_addr_t  iova;
+	size_t      len;
+};
+
+/**
+ * @brief                  Resolved patch destination buffer
+ *
+ * @hdl:                   Memory handle of the destination buffer
+ * @cpu_addr:              Kernel mapped address of the buffer
+ * @len:                   Size of the buffer
+ *
+ */
+struct cam_packet_patch_dst {
+	int32_t     hdl;
+	uintptr_t   cpu_addr;
+	size_t      len;
+};
+
+/**
+ * @brief                  Per packet handle resolution cache used while
+ *                         applying patches, so that every buffer referenced
+ *                         by the patch descriptors is looked up and mapped
+ *                         only once
+ *
+ * @src:                   Resolved source buffers
+ * @dst:                   Resolved destination buffers, a cpu buf reference
+ *                         is held on each until the packet is done
+ * @num_src:               Number of valid entries in @src
+ * @num_dst:               Number of valid entries in @dst
+ * @src_lookups:           Number of source lookups done in mem mgr
+ * @dst_lookups:           Number of destination lookups done in mem mgr
+ *
+ */
+struct cam_packet_patch_cache {
+	struct cam_packet_patch_src  src[CAM_PACKET_PATCH_CACHE_SIZE];
+	struct cam_packet_patch_dst  dst[CAM_PACKET_PATCH_CACHE_SIZE];
+	uint32_t                     num_src;
+	uint32_t                     num_dst;
+	uint32_t                     src_lookups;
+	uint32_t                     dst_lookups;
+};
+
 /* Generic Cmd Buffer blob callback function type */
 typedef int (*cam_packet_generic_blob_handler)(void *user_data,
 	uint32_t blob_type, uint32_t blob_size, uint8_t *blob_data);
@@ -722,6 +722,9 @@ static void DWC_ETH_QOS_wrapper_tx_descriptor_init_single_q(
 	desc_data->packet_count = 0;
 	desc_data->free_desc_cnt = pdata->tx_queue[qinx].desc_cnt;
 
+	/* a fresh ring has nothing in flight, start BQL from scratch too */
+	netdev_tx_reset_queue(netdev_get_tx_queue(pdata->dev, qinx));
+
 #ifdef DWC_ETH_QOS_CONFIG_PGTEST
 	hw_if->tx_desc_init_pg(pdata, qinx);
 #else
@@ -732,6 +735,145 @@ static void DWC_ETH_QOS_wrapper_tx_descriptor_init_single_q(
 	DBGPR("<--DWC_ETH_QOS_wrapper_tx_descriptor_init_single_q\n");
 }
 
+/*!
+ * \brief API to create the page pool backing split header payload pages.
+ *
+ * \details Payload pages are attached to received skbs as frags. The driver
+ * keeps its own reference to each page it hands up and returns it to the
+ * pool once the stack has dropped the last skb using it, so steady state
+ * RX refill does not go back to the page allocator. Only used from the
+ * channel's NAPI context, so the lockless pool cache is safe.
+ *
+ * \param[in] pdata - pointer to private data structure.
+ * \param[in] qinx - RX channel number.
+ *
+ * \return void.
+ */
+
+static void DWC_ETH_QOS_rx_pp_init(struct DWC_ETH_QOS_prv_data *pdata,
+				   UINT qinx)
+{
+	struct DWC_ETH_QOS_rx_queue *rx_queue = GET_RX_QUEUE_PTR(qinx);
+	struct page_pool_params params = {
+		.order = 0,
+		.pool_size = rx_queue->desc_cnt,
+		.nid = NUMA_NO_NODE,
+		.dma_dir = DMA_FROM_DEVICE,
+	};
+	struct page_pool *pool;
+
+	if (rx_queue->page_pool || !is_page_pool_compiled_in())
+		return;
+
+	rx_queue->pp_num_inflight = 0;
+	pool = page_pool_create(&params);
+	if (IS_ERR(pool)) {
+		EMACERR("RX page pool for channel %d not created: %ld\n",
+			qinx, PTR_ERR(pool));
+		return;
+	}
+
+	rx_queue->page_pool = pool;
+}
+
+/*!
+ * \brief API to return the split header pages the stack is done with.
+ *
+ * \details Every tracked page the driver holds the only reference to goes
+ * back into the pool's cache. Must be called from the channel's NAPI
+ * context.
+ *
+ * \param[in] pdata - pointer to private data structure.
+ * \param[in] qinx - RX channel number.
+ *
+ * \return void.
+ */
+
+static void DWC_ETH_QOS_rx_pp_reclaim(struct DWC_ETH_QOS_prv_data *pdata,
+				      UINT qinx)
+{
+	struct DWC_ETH_QOS_rx_queue *rx_queue = GET_RX_QUEUE_PTR(qinx);
+	u16 i, kept = 0;
+
+	for (i = 0; i < rx_queue->pp_num_inflight; i++) {
+		struct page *page = rx_queue->pp_inflight[i];
+
+		if (page_ref_count(page) == 1) {
+			page_pool_recycle_direct(rx_queue->page_pool, page);
+			pdata->xstats.q_rx_pp_recycle_n[qinx]++;
+			continue;
+		}
+
+		rx_queue->pp_inflight[kept++] = page;
+	}
+
+	rx_queue->pp_num_inflight = kept;
+}
+
+/*!
+ * \brief API to keep a reference to a split header page handed to the stack.
+ *
+ * \details Called when the payload page of a descriptor has been attached
+ * to an skb. The extra reference keeps the page out of the page allocator
+ * until the stack frees the skb, at which point reclaim recycles it. If
+ * the stack is sitting on more pages than can be tracked, the page is let
+ * go instead and freed normally by the stack.
+ *
+ * \param[in] pdata - pointer to private data structure.
+ * \param[in] qinx - RX channel number.
+ * \param[in] page - payload page attached to an skb.
+ *
+ * \return void.
+ */
+
+void DWC_ETH_QOS_rx_pp_track_page(struct DWC_ETH_QOS_prv_data *pdata,
+				  UINT qinx, struct page *page)
+{
+	struct DWC_ETH_QOS_rx_queue *rx_queue = GET_RX_QUEUE_PTR(qinx);
+
+	if (!rx_queue->page_pool)
+		return;
+
+	if (rx_queue->pp_num_inflight == DWC_ETH_QOS_RX_PP_MAX_INFLIGHT)
+		DWC_ETH_QOS_rx_pp_reclaim(pdata, qinx);
+
+	if (rx_queue->pp_num_inflight == DWC_ETH_QOS_RX_PP_MAX_INFLIGHT)
+		return;
+
+	get_page(page);
+	rx_queue->pp_inflight[rx_queue->pp_num_inflight++] = page;
+}
+
+/*!
+ * \brief API to destroy the split header page pool of a channel.
+ *
+ * \details Pages still referenced by the stack are detached from the pool
+ * and freed normally once the stack is done with them.
+ *
+ * \param[in] pdata - pointer to private data structure.
+ * \param[in] qinx - RX channel number.
+ *
+ * \return void.
+ */
+
+static void DWC_ETH_QOS_rx_pp_deinit(struct DWC_ETH_QOS_prv_data *pdata,
+				     UINT qinx)
+{
+	struct DWC_ETH_QOS_rx_queue *rx_queue = GET_RX_QUEUE_PTR(qinx);
+	u16 i;
+
+	if (!rx_queue->page_pool)
+		return;
+
+	for (i = 0; i < rx_queue->pp_num_inflight; i++)
+		page_pool_put_page(rx_queue->page_pool,
+				   rx_queue->pp_inflight[i], false);
+	rx_queue->pp_num_inflight = 0;
+
+	page_pool_destroy(rx_queue->page_pool);
+	rx_queue->page_pool = NULL;
+}
+
 /*!
  * \brief API to initialize the receive descriptors.
  *
@@ -779,6 +921,9 @@ static void DWC_ETH_QOS_wrapper_rx_descriptor_init_single_q(
 		}
 	}
 
+	if (pdata->rx_split_hdr && !(pdata->ipa_enabled && qinx == IPA_DMA_RX_CH))
+		DWC_ETH_QOS_rx_pp_init(pdata, qinx);
+
 	for (i = 0; i < pdata->rx_queue[qinx].desc_cnt; i++) {
 		GET_RX_DESC_PTR(qinx, i) = &desc[i];
 		GET_RX_DESC_DMA_ADDR(qinx, i) =
@@ -952,6 +1097,9 @@ static void DWC_ETH_QOS_tx_skb_free_mem_single_q(
 	for (i = 0; i < pdata->tx_queue[qinx].desc_cnt; i++)
 		DWC_ETH_QOS_unmap_tx_skb(pdata, GET_TX_BUF_PTR(qinx, i));
 
+	/* drop whatever BQL still thinks is in flight on this queue */
+	netdev_tx_reset_queue(netdev_get_tx_queue(pdata->dev, qinx));
+
 	DBGPR("<--DWC_ETH_QOS_tx_skb_free_mem_single_q\n");
 }
 
@@ -1046,6 +1194,8 @@ static void DWC_ETH_QOS_rx_skb_free_mem_single_q(
 			dev_kfree_skb_any(desc_data->skb_top);
 
 		desc_data->skb_top = NULL;
+
+		DWC_ETH_QOS_rx_pp_deinit(pdata, qinx);
 	}
 
 	DBGPR("<--DWC_ETH_QOS_rx_skb_free_mem_single_q\n");
@@ -1854,6 +2004,9 @@ static void DWC_ETH_QOS_re_alloc_skb(struct DWC_ETH_QOS_prv_data *pdata,
 		return;
 	}
 
+	if (pdata->rx_queue[qinx].page_pool)
+		DWC_ETH_QOS_rx_pp_reclaim(pdata, qinx);
+
 	for (i = 0; i < desc_data->dirty_rx; i++) {
 		buffer = GET_RX_BUF_PTR(qinx, desc_data->skb_realloc_idx);
 		/* allocate skb & assign to each desc */
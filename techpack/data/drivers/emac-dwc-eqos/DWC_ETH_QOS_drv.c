@@ -267,6 +267,9 @@ static void DWC_ETH_QOS_napi_enable_mq(struct DWC_ETH_QOS_prv_data *pdata)
 		if (pdata->ipa_enabled && (qinx == IPA_DMA_RX_CH))
 			continue;
 		rx_queue = GET_RX_QUEUE_PTR(qinx);
+		rx_queue->dim.state = NET_DIM_START_MEASURE;
+		rx_queue->dim.mode = NET_DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		rx_queue->dim.profile_ix = NET_DIM_DEF_PROFILE_EQE;
 		napi_enable(&rx_queue->napi);
 	}
 
@@ -285,6 +288,7 @@ static void DWC_ETH_QOS_all_ch_napi_disable(struct DWC_ETH_QOS_prv_data *pdata)
 			continue;
 		rx_queue = GET_RX_QUEUE_PTR(qinx);
 		napi_disable(&rx_queue->napi);
+		cancel_work_sync(&rx_queue->dim.work);
 	}
 
 	DBGPR("<--DWC_ETH_QOS_all_ch_napi_disable\n");
@@ -1487,6 +1491,7 @@ static int DWC_ETH_QOS_alloc_split_hdr_rx_buf(
 		struct DWC_ETH_QOS_rx_buffer *buffer,
 		UINT qinx, gfp_t gfp)
 {
+	struct DWC_ETH_QOS_rx_queue *rx_queue = GET_RX_QUEUE_PTR(qinx);
 	struct sk_buff *skb = buffer->skb;
 
 	DBGPR("-->DWC_ETH_QOS_alloc_split_hdr_rx_buf\n");
@@ -1518,7 +1523,11 @@ static int DWC_ETH_QOS_alloc_split_hdr_rx_buf(
 
 	/* allocate a new page if necessary */
 	if (!buffer->page2) {
-		buffer->page2 = alloc_page(gfp);
+		if (rx_queue->page_pool)
+			buffer->page2 = page_pool_alloc_pages(
+					rx_queue->page_pool, gfp);
+		else
+			buffer->page2 = alloc_page(gfp);
 		if (unlikely(!buffer->page2)) {
 			dev_alert(&pdata->pdev->dev,
 				  "Failed to allocate page for second buffer\n");
@@ -2637,6 +2646,13 @@ static int DWC_ETH_QOS_start_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	if (eth_type == ETH_P_IP || eth_type == ETH_P_IPV6)
 		skb_orphan(skb);
+	netdev_tx_sent_queue(devq, skb->len);
+	/* completions are only reaped from the TX interrupt, so if BQL just
+	 * stopped the queue this packet must raise one or TX stalls
+	 */
+	if (netif_xmit_stopped(devq))
+		int_mod = 1;
+
 	/* configure required descriptor fields for transmission */
 	hw_if->pre_xmit(pdata, qinx, int_mod);
 
@@ -2903,6 +2919,7 @@ static void DWC_ETH_QOS_tx_interrupt(struct net_device *dev,
 	int err_incremented;
 #endif
 	unsigned int tstamp_taken = 0;
+	unsigned int pkts_compl = 0, bytes_compl = 0;
 	unsigned long flags;
 
 	DBGPR("-->DWC_ETH_QOS_tx_interrupt: desc_data->tx_pkt_queued = %d dirty_tx = %d, qinx = %u\n",
@@ -3019,6 +3036,11 @@ static void DWC_ETH_QOS_tx_interrupt(struct net_device *dev,
 #endif
 		dev->stats.tx_bytes += buffer->len;
 		dev->stats.tx_bytes += buffer->len2;
+		/* the skb hangs off the last descriptor of its packet only */
+		if (buffer->skb) {
+			bytes_compl += buffer->skb->len;
+			pkts_compl++;
+		}
 		desc_if->unmap_tx_skb(pdata, buffer);
 
 		/* reset the descriptor so that driver/host can reuse it */
@@ -3029,6 +3051,10 @@ static void DWC_ETH_QOS_tx_interrupt(struct net_device *dev,
 		desc_data->tx_pkt_queued--;
 	}
 
+	pdata->xstats.q_tx_bytes_n[qinx] += bytes_compl;
+	netdev_tx_completed_queue(netdev_get_tx_queue(dev, qinx),
+				  pkts_compl, bytes_compl);
+
 	if ((desc_data->queue_stopped == 1) && (desc_data->free_desc_cnt > 0)) {
 		desc_data->queue_stopped = 0;
 		netif_wake_subqueue(dev, qinx);
@@ -3130,13 +3156,17 @@ static void DWC_ETH_QOS_consume_page(struct DWC_ETH_QOS_rx_buffer *buffer,
 }
 
 static void DWC_ETH_QOS_consume_page_split_hdr(
+				struct DWC_ETH_QOS_prv_data *pdata,
+				UINT qinx,
 				struct DWC_ETH_QOS_rx_buffer *buffer,
 				struct sk_buff *skb,
 				u16 length,
 				USHORT page2_used)
 {
-	if (page2_used)
+	if (page2_used) {
+		DWC_ETH_QOS_rx_pp_track_page(pdata, qinx, buffer->page2);
 		buffer->page2 = NULL;
+	}
 		if (skb != NULL) {
 			skb->len += length;
 			skb->data_len += length;
@@ -3354,7 +3384,7 @@ static int DWC_ETH_QOS_clean_split_hdr_rx_irq(
 					buffer->skb = skb;
 				}
 				if (desc_data->skb_top != NULL)
-						DWC_ETH_QOS_consume_page_split_hdr(buffer,
+						DWC_ETH_QOS_consume_page_split_hdr(pdata, qinx, buffer,
 								   desc_data->skb_top,
 							 payload_len, buf2_used);
 				goto next_desc;
@@ -3379,7 +3409,7 @@ static int DWC_ETH_QOS_clean_split_hdr_rx_irq(
 					}
 					desc_data->skb_top = NULL;
 					if (skb != NULL)
-						DWC_ETH_QOS_consume_page_split_hdr(buffer, skb,
+						DWC_ETH_QOS_consume_page_split_hdr(pdata, qinx, buffer, skb,
 									   payload_len, buf2_used);
 				} else {
 					/* no chain, got both FD + LD together */
@@ -3414,7 +3444,7 @@ static int DWC_ETH_QOS_clean_split_hdr_rx_irq(
 							payload_len = 0; /* no data in page2 */
 						}
 					}
-					DWC_ETH_QOS_consume_page_split_hdr(buffer,
+					DWC_ETH_QOS_consume_page_split_hdr(pdata, qinx, buffer,
 									   skb, payload_len,
 							buf2_used);
 				}
@@ -4014,6 +4044,80 @@ void DWC_ETH_QOS_update_rx_errors(struct net_device *dev,
 	DBGPR("<--DWC_ETH_QOS_update_rx_errors\n");
 }
 
+/*!
+ * \brief API to feed the adaptive RX moderation state machine
+ *
+ * \details This function is called once per completed NAPI run. Every
+ * run corresponds to one RX interrupt, so the event counter together
+ * with the per channel packet and byte counters is all net_dim needs
+ * to decide whether the RX watchdog should be stretched or shortened.
+ *
+ * \param[in] pdata - pointer to private data structure.
+ *
+ * \return void
+ */
+
+static void DWC_ETH_QOS_rx_dim_update(struct DWC_ETH_QOS_prv_data *pdata)
+{
+	struct DWC_ETH_QOS_rx_queue *rx_queue = NULL;
+	struct net_dim_sample sample;
+	int qinx;
+
+	if (!pdata->rx_dim_enabled)
+		return;
+
+	for (qinx = 0; qinx < DWC_ETH_QOS_RX_QUEUE_CNT; qinx++) {
+		if (pdata->ipa_enabled && qinx == IPA_DMA_RX_CH)
+			continue;
+
+		rx_queue = GET_RX_QUEUE_PTR(qinx);
+		net_dim_sample(rx_queue->dim_event_ctr++,
+			       pdata->xstats.q_rx_pkt_n[qinx],
+			       pdata->xstats.q_rx_bytes_n[qinx], &sample);
+		net_dim(&rx_queue->dim, sample);
+	}
+}
+
+/*!
+ * \brief API to apply a new adaptive RX moderation profile
+ *
+ * \details Scheduled by net_dim once it settled on a new profile for
+ * a channel. The profile's usec value is translated into RIWT units
+ * and programmed into the channel's RX watchdog timer.
+ *
+ * \param[in] work - pointer to work_struct embedded in net_dim.
+ *
+ * \return void
+ */
+
+void DWC_ETH_QOS_rx_dim_work(struct work_struct *work)
+{
+	struct net_dim *dim = container_of(work, struct net_dim, work);
+	struct DWC_ETH_QOS_rx_queue *rx_queue =
+		container_of(dim, struct DWC_ETH_QOS_rx_queue, dim);
+	struct DWC_ETH_QOS_prv_data *pdata = rx_queue->pdata;
+	struct DWC_ETH_QOS_rx_wrapper_descriptor *rx_desc_data =
+		&rx_queue->rx_desc_data;
+	struct hw_if_struct *hw_if = &pdata->hw_if;
+	struct net_dim_cq_moder moder;
+	UINT qinx = rx_queue - pdata->rx_queue;
+	u32 riwt;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	riwt = clamp_t(u32, DWC_ETH_QOS_usec2riwt(moder.usec, pdata),
+		       DWC_ETH_QOS_MIN_DMA_RIWT, DWC_ETH_QOS_MAX_DMA_RIWT);
+
+	if (pdata->rx_dim_enabled && rx_desc_data->use_riwt &&
+	    riwt != rx_desc_data->rx_riwt) {
+		rx_desc_data->rx_riwt = riwt;
+		hw_if->config_rx_watchdog(qinx, riwt);
+		pdata->xstats.q_rx_dim_update_n[qinx]++;
+		pdata->xstats.q_rx_riwt[qinx] = riwt;
+	}
+
+	dim->state = NET_DIM_START_MEASURE;
+}
+
 /*!
  * \brief API to pass the received packets to stack
  *
@@ -4038,6 +4142,7 @@ int DWC_ETH_QOS_poll_mq(struct napi_struct *napi, int budget)
 	int per_q_budget = budget / DWC_ETH_QOS_RX_QUEUE_CNT;
 	int qinx = 0;
 	int received = 0, per_q_received = 0;
+	unsigned long rx_bytes;
 	unsigned long flags;
 
 	DBGPR("-->DWC_ETH_QOS_poll_mq: budget = %d\n", budget);
@@ -4058,6 +4163,7 @@ int DWC_ETH_QOS_poll_mq(struct napi_struct *napi, int budget)
 		rx_queue->lro_flush_needed = 0;
 #endif
 
+		rx_bytes = pdata->dev->stats.rx_bytes;
 #ifdef RX_OLD_CODE
 		per_q_received = DWC_ETH_QOS_poll(pdata, per_q_budget, qinx);
 #else
@@ -4066,6 +4172,8 @@ int DWC_ETH_QOS_poll_mq(struct napi_struct *napi, int budget)
 		received += per_q_received;
 		pdata->xstats.rx_pkt_n += per_q_received;
 		pdata->xstats.q_rx_pkt_n[qinx] += per_q_received;
+		pdata->xstats.q_rx_bytes_n[qinx] +=
+			pdata->dev->stats.rx_bytes - rx_bytes;
 #ifdef DWC_INET_LRO
 		if (rx_queue->lro_flush_needed)
 			lro_flush_all(&rx_queue->lro_mgr);
@@ -4076,6 +4184,8 @@ int DWC_ETH_QOS_poll_mq(struct napi_struct *napi, int budget)
 	 * tell the kernel & re-enable interrupt
 	 */
 	if (received < budget) {
+		DWC_ETH_QOS_rx_dim_update(pdata);
+
 		if (pdata->dev->features & NETIF_F_GRO) {
 			/* to turn off polling */
 			napi_complete(napi);
@@ -7781,6 +7891,7 @@ void DWC_ETH_QOS_init_rx_coalesce(struct DWC_ETH_QOS_prv_data *pdata)
 			rx_desc_data->rx_riwt =
 				DWC_ETH_QOS_usec2riwt
 				(DWC_ETH_QOS_OPTIMAL_DMA_RIWT_USEC, pdata);
+		pdata->xstats.q_rx_riwt[i] = rx_desc_data->rx_riwt;
 	}
 
 	DBGPR("<--DWC_ETH_QOS_init_rx_coalesce\n");
@@ -180,6 +180,31 @@ static const struct DWC_ETH_QOS_stats DWC_ETH_QOS_gstrings_stats[] = {
 	DWC_ETH_QOS_EXTRA_STAT(q_rx_pkt_n[1]),
 	DWC_ETH_QOS_EXTRA_STAT(q_rx_pkt_n[2]),
 	DWC_ETH_QOS_EXTRA_STAT(q_rx_pkt_n[3]),
+	DWC_ETH_QOS_EXTRA_STAT(q_tx_bytes_n[0]),
+	DWC_ETH_QOS_EXTRA_STAT(q_tx_bytes_n[1]),
+	DWC_ETH_QOS_EXTRA_STAT(q_tx_bytes_n[2]),
+	DWC_ETH_QOS_EXTRA_STAT(q_tx_bytes_n[3]),
+	DWC_ETH_QOS_EXTRA_STAT(q_tx_bytes_n[4]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_bytes_n[0]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_bytes_n[1]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_bytes_n[2]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_bytes_n[3]),
+
+	/* Adaptive RX moderation per channel [0-3] */
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_dim_update_n[0]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_dim_update_n[1]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_dim_update_n[2]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_dim_update_n[3]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_riwt[0]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_riwt[1]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_riwt[2]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_riwt[3]),
+
+	/* Split header page pool recycling per channel [0-3] */
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_pp_recycle_n[0]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_pp_recycle_n[1]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_pp_recycle_n[2]),
+	DWC_ETH_QOS_EXTRA_STAT(q_rx_pp_recycle_n[3]),
 
 	/* DMA status registers for all channels [0-4] */
 	DWC_ETH_QOS_EXTRA_STAT(dma_ch_status[0]),
@@ -938,6 +963,7 @@ static int DWC_ETH_QOS_get_coalesce(struct net_device *dev,
 	ec->rx_coalesce_usecs =
 	    DWC_ETH_QOS_riwt2usec(rx_desc_data->rx_riwt, pdata);
 	ec->rx_max_coalesced_frames = rx_desc_data->rx_coal_frames;
+	ec->use_adaptive_rx_coalesce = pdata->rx_dim_enabled;
 
 	DBGPR("<--DWC_ETH_QOS_get_coalesce\n");
 
@@ -972,7 +998,7 @@ static int DWC_ETH_QOS_set_coalesce(struct net_device *dev,
 	/* Check for not supported parameters  */
 	if ((ec->rx_coalesce_usecs_irq) ||
 	    (ec->rx_max_coalesced_frames_irq) || (ec->tx_coalesce_usecs_irq) ||
-	    (ec->use_adaptive_rx_coalesce) || (ec->use_adaptive_tx_coalesce) ||
+	    (ec->use_adaptive_tx_coalesce) ||
 	    (ec->pkt_rate_low) || (ec->rx_coalesce_usecs_low) ||
 	    (ec->rx_max_coalesced_frames_low) || (ec->tx_coalesce_usecs_high) ||
 	    (ec->tx_max_coalesced_frames_low) || (ec->pkt_rate_high) ||
@@ -996,6 +1022,14 @@ static int DWC_ETH_QOS_set_coalesce(struct net_device *dev,
 		"RX COALESCING is %s\n",
 		(local_use_riwt ? "ENABLED" : "DISABLED"));
 
+	/* adaptive moderation only retunes the watchdog, it needs
+	 * coalescing to be active in the first place
+	 */
+	if (ec->use_adaptive_rx_coalesce && !local_use_riwt) {
+		pr_alert("Adaptive RX coalescing needs RX coalescing enabled\n");
+		return -EINVAL;
+	}
+
 	rx_riwt = DWC_ETH_QOS_usec2riwt(ec->rx_coalesce_usecs, pdata);
 
 	/* Check the bounds of values for RX */
@@ -1033,8 +1067,11 @@ static int DWC_ETH_QOS_set_coalesce(struct net_device *dev,
 		rx_desc_data->rx_riwt = rx_riwt;
 		rx_desc_data->rx_coal_frames = ec->rx_max_coalesced_frames;
 		hw_if->config_rx_watchdog(qinx, rx_desc_data->rx_riwt);
+		pdata->xstats.q_rx_riwt[qinx] = rx_desc_data->rx_riwt;
 	}
 
+	pdata->rx_dim_enabled = !!ec->use_adaptive_rx_coalesce;
+
 	DBGPR("<--DWC_ETH_QOS_set_coalesce\n");
 
 	return 0;
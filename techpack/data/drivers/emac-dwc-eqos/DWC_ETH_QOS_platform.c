@@ -1776,6 +1776,7 @@ static int DWC_ETH_QOS_configure_netdevice(struct platform_device *pdev)
 
 		netif_napi_add(dev, &rx_queue->napi, DWC_ETH_QOS_poll_mq,
 			  (NAPI_PER_QUEUE_POLL_BUDGET * DWC_ETH_QOS_RX_QUEUE_CNT));
+		INIT_WORK(&rx_queue->dim.work, DWC_ETH_QOS_rx_dim_work);
 	}
 
 	dev->ethtool_ops = DWC_ETH_QOS_get_ethtool_ops();
@@ -78,10 +78,12 @@
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
+#include <linux/net_dim.h>
 #include <linux/skbuff.h>
 #include <linux/delay.h>
 #include <linux/spinlock.h>
 #include <linux/crc32.h>
+#include <net/page_pool.h>
 #include <linux/bitops.h>
 #include <linux/mii.h>
 #include <asm/processor.h>
@@ -542,6 +544,13 @@ extern void *ipc_emac_log_ctxt;
 #define DWC_ETH_QOS_MAX_DMA_RIWT  0xff
 /* Max no of pkts to be received before an RX interrupt */
 #define DWC_ETH_QOS_RX_MAX_FRAMES 16
+/* Smallest watchdog value adaptive moderation may program; a zero RIWT
+ * would leave frames without IOC stranded until the next coalesced one */
+#define DWC_ETH_QOS_MIN_DMA_RIWT  0x1
+
+/* Split header payload pages the driver keeps a reference to while they
+ * sit in the stack, per RX channel */
+#define DWC_ETH_QOS_RX_PP_MAX_INFLIGHT 256
 
 #define DMA_SBUS_AXI_PBL_MASK 0xFE
 
@@ -1234,6 +1243,13 @@ struct DWC_ETH_QOS_rx_queue {
 	struct DWC_ETH_QOS_rx_wrapper_descriptor rx_desc_data;
 	struct napi_struct napi;
 	struct DWC_ETH_QOS_prv_data *pdata;
+	/* adaptive RX interrupt moderation, sampled once per NAPI run */
+	struct net_dim dim;
+	u16 dim_event_ctr;
+	/* split header payload pages, recycled once the stack lets go */
+	struct page_pool *page_pool;
+	u16 pp_num_inflight;
+	struct page *pp_inflight[DWC_ETH_QOS_RX_PP_MAX_INFLIGHT];
 #ifdef DWC_INET_LRO
 	struct net_lro_mgr lro_mgr;
 	struct net_lro_desc lro_arr[DWC_ETH_QOS_MAX_LRO_DESC];
@@ -1465,6 +1481,15 @@ struct DWC_ETH_QOS_extra_stats {
 	/* Tx/Rx frames per channels/queues */
 	unsigned long q_tx_pkt_n[DWC_ETH_QOS_TXQ_CNT];
 	unsigned long q_rx_pkt_n[DWC_ETH_QOS_RXQ_CNT];
+	unsigned long q_tx_bytes_n[DWC_ETH_QOS_TXQ_CNT];
+	unsigned long q_rx_bytes_n[DWC_ETH_QOS_RXQ_CNT];
+
+	/* adaptive RX moderation per channel */
+	unsigned long q_rx_dim_update_n[DWC_ETH_QOS_RXQ_CNT];
+	unsigned long q_rx_riwt[DWC_ETH_QOS_RXQ_CNT];
+
+	/* split header payload pages recycled through the page pool */
+	unsigned long q_rx_pp_recycle_n[DWC_ETH_QOS_RXQ_CNT];
 
 	/* DMA status registers for all channels [0-4] */
 	unsigned long dma_ch_status[DWC_ETH_QOS_TXQ_CNT];
@@ -1734,6 +1759,9 @@ struct DWC_ETH_QOS_prv_data {
 	struct DWC_ETH_QOS_extra_stats xstats;
 	struct DWC_ETH_QOS_ipa_stats ipa_stats;
 
+	/* set through ethtool use_adaptive_rx_coalesce */
+	bool rx_dim_enabled;
+
 #ifdef DWC_ETH_QOS_CONFIG_PGTEST
 	struct DWC_ETH_QOS_PGSTRUCT *pg;
 	struct timer_list pg_timer;
@@ -1937,6 +1965,8 @@ void DWC_ETH_QOS_init_function_ptrs_desc(struct desc_if_struct *);
 struct net_device_ops *DWC_ETH_QOS_get_netdev_ops(void);
 struct ethtool_ops *DWC_ETH_QOS_get_ethtool_ops(void);
 int DWC_ETH_QOS_poll_mq(struct napi_struct *, int);
+void DWC_ETH_QOS_rx_pp_track_page(struct DWC_ETH_QOS_prv_data *pdata,
+				  UINT qinx, struct page *page);
 
 void DWC_ETH_QOS_get_pdata(struct DWC_ETH_QOS_prv_data *pdata);
 
@@ -1970,6 +2000,7 @@ INT DWC_ETH_QOS_powerup(struct net_device *, UINT);
 INT DWC_ETH_QOS_powerdown(struct net_device *, UINT, UINT);
 u32 DWC_ETH_QOS_usec2riwt(u32 usec, struct DWC_ETH_QOS_prv_data *pdata);
 void DWC_ETH_QOS_init_rx_coalesce(struct DWC_ETH_QOS_prv_data *pdata);
+void DWC_ETH_QOS_rx_dim_work(struct work_struct *work);
 void DWC_ETH_QOS_enable_all_ch_rx_interrpt(struct DWC_ETH_QOS_prv_data *pdata);
 void DWC_ETH_QOS_disable_all_ch_rx_interrpt(struct DWC_ETH_QOS_prv_data *pdata);
 void DWC_ETH_QOS_update_rx_errors(struct net_device *, unsigned int);
@@ -38,85 +38,12 @@ struct rmnet_perf *rmnet_perf_config_get_perf(void)
 	return perf;
 }
 
-/* rmnet_perf_config_alloc_64k_buffs() - Recycled buffer allocation on rmnet
- * init
- * @perf: allows access to our required global structures
- *
- * Allocate RMNET_NUM_64K_BUFFS many buffers. Assign them to the available
- * array. This only occurs on rmnet init
- *
- * Return:
- *		- return_val:
- *			- RMNET_PERF_RESOURCE_MGMT_FAIL: Ran out of memory
- *			- RMNET_PERF_RESOURCE_MGMT_SUCCESS: No problems
- **/
-static enum rmnet_perf_resource_management_e
-rmnet_perf_config_alloc_64k_buffs(struct rmnet_perf *perf)
-{
-	int i;
-	struct sk_buff *skbn;
-	enum rmnet_perf_resource_management_e return_val;
-	struct rmnet_perf_core_64k_buff_pool *pool = perf->core_meta->buff_pool;
-
-	return_val = RMNET_PERF_RESOURCE_MGMT_SUCCESS;
-	memset(pool, 0, sizeof(struct rmnet_perf_core_64k_buff_pool));
-	pool->index = 0;
-	for (i = 0; i < RMNET_PERF_NUM_64K_BUFFS; i++) {
-		skbn = alloc_skb(RMNET_PERF_CORE_RECYCLE_SKB_SIZE, GFP_ATOMIC);
-		if (!skbn) {
-			int j;
-
-			return_val = RMNET_PERF_RESOURCE_MGMT_FAIL;
-			/* If one skb fails to allocate, dont use feature */
-			for (j = i - 1; j >= 0; j--) {
-				if (pool->available[j]) {
-					kfree_skb(pool->available[j]);
-					pool->available[j] = NULL;
-				}
-			}
-			return return_val;
-		}
-		pool->available[i] = skbn;
-	}
-
-	return return_val;
-}
-
-/* rmnet_perf_config_free_64k_buffs() - Recycled buffer free on rmnet teardown
- * @perf: allows access to our required global structures
- *
- * Free RMNET_NUM_64K_BUFFS many buffers. This only occurs on rmnet
- * teardown.
- *
- * Return:
- *		- void
- **/
-static void rmnet_perf_config_free_64k_buffs(struct rmnet_perf *perf)
-{
-	int i;
-	struct rmnet_perf_core_64k_buff_pool *buff_pool;
-
-	buff_pool = perf->core_meta->buff_pool;
-
-	/* Free both busy and available because if its truly busy,
-	 * we will simply decrement the users count... This means NW stack
-	 * will still have opportunity to process the packet as it wishes
-	 * and will naturally free the sk_buff when it is done. Available[0]
-	 * being not null means that all indexes of available are filled by
-	 * SKBs from module initialization
-	 */
-	if (buff_pool->available[0]) {
-		for (i = 0; i < RMNET_PERF_NUM_64K_BUFFS; i++)
-			kfree_skb(buff_pool->available[i]);
-	}
-}
-
 /* rmnet_perf_config_free_resources() - on rmnet teardown free all the
  *		related meta data structures
  * @perf: allows access to our required global structures
  *
- * Free the recycled 64k buffers, all held SKBs that came from physical
- * device, and free the meta data structure itself.
+ * Free all held SKBs that came from physical device, the page pool, and
+ * free the meta data structure itself.
  *
  * Return:
  *		- status of the freeing dependent on the validity of the perf
@@ -133,13 +60,14 @@ rmnet_perf_config_free_resources(struct rmnet_perf *perf)
 	/* Free everything flow nodes currently hold */
 	rmnet_perf_opt_flush_all_flow_nodes();
 
-	/* Get rid of 64k sk_buff cache */
-	rmnet_perf_config_free_64k_buffs(perf);
 	/* Before we free tcp_opt's structures, make sure we arent holding
 	 * any SKB's hostage
 	 */
 	rmnet_perf_core_free_held_skbs();
 
+	/* Get rid of the page pool backing deag mode SKBs */
+	rmnet_perf_core_pp_deinit(perf);
+
 	/* Clean up any remaining nodes in the flow table before freeing */
 	rmnet_perf_free_hash_table();
 
@@ -154,7 +82,7 @@ rmnet_perf_config_free_resources(struct rmnet_perf *perf)
  * @perf: allows access to our required global structures
  *
  * Prepares node pool, the nodes themselves, the skb list from the
- * physical device, and the recycled skb pool
+ * physical device, and the page pool state
  * TODO separate out things which are not tcp_opt specific
  *
  * Return:
@@ -162,7 +90,7 @@ rmnet_perf_config_free_resources(struct rmnet_perf *perf)
  **/
 static int rmnet_perf_config_allocate_resources(struct rmnet_perf **perf)
 {
-	int i;
+	int i, j;
 	void *buffer_head;
 	struct rmnet_perf_opt_meta *opt_meta;
 	struct rmnet_perf_core_meta *core_meta;
@@ -176,11 +104,13 @@ static int rmnet_perf_config_allocate_resources(struct rmnet_perf **perf)
 	int flow_node_size = sizeof(struct rmnet_perf_opt_flow_node);
 	int core_meta_size = sizeof(struct rmnet_perf_core_meta);
 	int skb_list_size = sizeof(struct rmnet_perf_core_skb_list);
-	int skb_buff_pool_size = sizeof(struct rmnet_perf_core_64k_buff_pool);
+	int page_pool_size = sizeof(struct rmnet_perf_core_page_pool);
 
-	int total_size = perf_size + opt_meta_size + flow_node_pool_size +
-			(flow_node_size * RMNET_PERF_NUM_FLOW_NODES) +
-			core_meta_size + skb_list_size + skb_buff_pool_size
+	int total_size = perf_size + opt_meta_size +
+			(flow_node_pool_size * RMNET_PERF_OPT_NUM_SHARDS) +
+			(flow_node_size * RMNET_PERF_OPT_NODES_PER_SHARD *
+			 RMNET_PERF_OPT_NUM_SHARDS) +
+			core_meta_size + skb_list_size + page_pool_size
 			+ bm_state_size;
 
 	/* allocate all the memory in one chunk for cache coherency sake */
@@ -196,21 +126,28 @@ static int rmnet_perf_config_allocate_resources(struct rmnet_perf **perf)
 	opt_meta = local_perf->opt_meta;
 	buffer_head += opt_meta_size;
 
-	/* assign the node pool */
+	/* assign the node pools, one per flow table shard */
 	opt_meta->node_pool = buffer_head;
-	opt_meta->node_pool->num_flows_in_use = 0;
-	opt_meta->node_pool->flow_recycle_counter = 0;
-	buffer_head += flow_node_pool_size;
-
-	/* assign the individual flow nodes themselves */
-	for (i = 0; i < RMNET_PERF_NUM_FLOW_NODES; i++) {
-		struct rmnet_perf_opt_flow_node **flow_node;
-
-		flow_node = &opt_meta->node_pool->node_list[i];
-		*flow_node = buffer_head;
-		buffer_head += flow_node_size;
-		(*flow_node)->num_pkts_held = 0;
-		(*flow_node)->len = 0;
+	buffer_head += flow_node_pool_size * RMNET_PERF_OPT_NUM_SHARDS;
+
+	for (j = 0; j < RMNET_PERF_OPT_NUM_SHARDS; j++) {
+		struct rmnet_perf_opt_flow_node_pool *node_pool;
+
+		node_pool = &opt_meta->node_pool[j];
+		node_pool->num_flows_in_use = 0;
+		node_pool->flow_recycle_counter = 0;
+
+		/* assign the individual flow nodes themselves */
+		for (i = 0; i < RMNET_PERF_OPT_NODES_PER_SHARD; i++) {
+			struct rmnet_perf_opt_flow_node **flow_node;
+
+			flow_node = &node_pool->node_list[i];
+			*flow_node = buffer_head;
+			buffer_head += flow_node_size;
+			(*flow_node)->shard = j;
+			(*flow_node)->num_pkts_held = 0;
+			(*flow_node)->len = 0;
+		}
 	}
 
 	local_perf->core_meta = buffer_head;
@@ -222,9 +159,9 @@ static int rmnet_perf_config_allocate_resources(struct rmnet_perf **perf)
 	core_meta->skb_needs_free_list->num_skbs_held = 0;
 	buffer_head += skb_list_size;
 
-	/* allocate buffer pool struct (also not specific to opt) */
-	core_meta->buff_pool = buffer_head;
-	buffer_head += skb_buff_pool_size;
+	/* allocate page pool struct (also not specific to opt) */
+	core_meta->page_pool = buffer_head;
+	buffer_head += page_pool_size;
 
 	/* assign the burst marker state */
 	core_meta->bm_state = buffer_head;
@@ -314,16 +251,14 @@ static int rmnet_perf_netdev_up(struct net_device *real_dev,
 		return RMNET_PERF_RESOURCE_MGMT_FAIL;
 	}
 
-	/* structs to contain these have already been allocated. Here we are
-	 * simply allocating the buffers themselves
+	/* The page pool state has already been allocated. Here we are
+	 * simply creating the pool itself
 	 */
-	rc = rmnet_perf_config_alloc_64k_buffs(perf);
-	if (rc == RMNET_PERF_RESOURCE_MGMT_FAIL) {
-		/* Since recycling buffers isnt a feature we use, refrain
+	if (rmnet_perf_core_pp_init(perf)) {
+		/* SKBs are built linearly without the pool, so refrain
 		 * from returning with a return failure status
 		 */
-		pr_err("%s(): Failed to allocate 64k buffers for recycling\n",
-		       __func__);
+		pr_err("%s(): Failed to create page pool\n", __func__);
 	}
 
 	rc = rmnet_perf_config_register_callbacks(real_dev, port);
@@ -462,6 +397,7 @@ static struct notifier_block rmnet_perf_dev_notifier __read_mostly = {
 int __init rmnet_perf_init(void)
 {
 	pr_info("%s(): initializing rmnet_perf\n", __func__);
+	rmnet_perf_opt_init_shards();
 	return register_netdevice_notifier(&rmnet_perf_dev_notifier);
 }
 
@@ -469,6 +405,7 @@ void __exit rmnet_perf_exit(void)
 {
 	pr_info("%s(): exiting rmnet_perf\n", __func__);
 	unregister_netdevice_notifier(&rmnet_perf_dev_notifier);
+	rmnet_perf_core_xdp_detach();
 }
 
 module_init(rmnet_perf_init);
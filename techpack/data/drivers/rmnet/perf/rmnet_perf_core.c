@@ -19,7 +19,11 @@
 #include <linux/module.h>
 #include <linux/skbuff.h>
 #include <linux/spinlock.h>
+#include <linux/bpf.h>
+#include <linux/filter.h>
 #include <net/ip6_checksum.h>
+#include <net/page_pool.h>
+#include <net/xdp.h>
 #include <net/tcp.h>
 #include <net/udp.h>
 #include <../drivers/net/ethernet/qualcomm/rmnet/rmnet_map.h>
@@ -34,14 +38,17 @@
 #include <soc/qcom/qmi_rmnet.h>
 #endif
 
-/* Each index tells us the number of iterations it took us to find a recycled
- * skb
- */
-unsigned long int
-rmnet_perf_core_skb_recycle_iterations[RMNET_PERF_NUM_64K_BUFFS + 1];
-module_param_array(rmnet_perf_core_skb_recycle_iterations, ulong, 0, 0444);
-MODULE_PARM_DESC(rmnet_perf_core_skb_recycle_iterations,
-		 "Skb recycle statistics");
+/* Page pool usage for the payload of SKBs built in deag mode */
+unsigned long int rmnet_perf_core_pp_stats[RMNET_PERF_CORE_PP_STATS_MAX];
+module_param_array(rmnet_perf_core_pp_stats, ulong, 0, 0444);
+MODULE_PARM_DESC(rmnet_perf_core_pp_stats,
+		 "Page pool alloc, alloc fail, recycle, release, linear fallback");
+
+/* Verdicts returned by the attached XDP program */
+unsigned long int rmnet_perf_core_xdp_stats[RMNET_PERF_CORE_XDP_STATS_MAX];
+module_param_array(rmnet_perf_core_xdp_stats, ulong, 0, 0444);
+MODULE_PARM_DESC(rmnet_perf_core_xdp_stats,
+		 "XDP pass, drop, aborted, unsupported verdicts");
 
 /* Number of SKBs we are allowed to accumulate from HW before we must flush
  * everything
@@ -122,9 +129,11 @@ MODULE_PARM_DESC(rmnet_perf_ingress_deag,
 		 "If true, rmnet_perf will handle QMAP deaggregation");
 
 #define SHS_FLUSH				0
-#define RECYCLE_BUFF_SIZE_THRESH		51200
 
-/* Lock around flow nodes for syncornization with rmnet_perf_opt_mode changes */
+/* Lock around the held SKBs from the physical device, the burst marker state
+ * and the page pool, as well as rmnet_perf_opt_mode changes. Flow nodes are
+ * covered by the lock of their flow table shard, taken after this one.
+ */
 static DEFINE_SPINLOCK(rmnet_perf_core_lock);
 
 void rmnet_perf_core_grab_lock(void)
@@ -188,93 +197,375 @@ void rmnet_perf_core_free_held_skbs(void)
 	if (skb_list->num_skbs_held > 0)
 		kfree_skb_list(skb_list->head);
 	skb_list->num_skbs_held = 0;
+
+	if (rmnet_perf_core_pp_enabled())
+		rmnet_perf_core_pp_reclaim();
+}
+
+/* rmnet_perf_core_pp_init() - Create the page pool backing deag mode SKBs
+ * @perf: allows access to our required global structures
+ *
+ * The pool is only used from the deaggregation path, which runs under
+ * rmnet_perf_core_lock, so the lockless alloc cache of the pool is safe.
+ *
+ * Return:
+ *		- 0: pool created
+ *		- negative errno: pool could not be created, SKBs are built
+ *		  linearly instead
+ **/
+int rmnet_perf_core_pp_init(struct rmnet_perf *perf)
+{
+	struct rmnet_perf_core_page_pool *pp = perf->core_meta->page_pool;
+	struct page_pool_params params = {
+		.order = 0,
+		.pool_size = RMNET_PERF_CORE_PP_POOL_SIZE,
+		.nid = NUMA_NO_NODE,
+		.dma_dir = DMA_FROM_DEVICE,
+	};
+	struct page_pool *pool;
+
+	memset(pp, 0, sizeof(*pp));
+	if (!is_page_pool_compiled_in())
+		return -EOPNOTSUPP;
+
+	pool = page_pool_create(&params);
+	if (IS_ERR(pool))
+		return PTR_ERR(pool);
+
+	pp->pool = pool;
+	return 0;
 }
 
-/* rmnet_perf_core_reset_recycled_skb() - Clear/prepare recycled SKB to be
- *		used again
- * @skb: recycled buffer we are clearing out
+/* rmnet_perf_core_pp_release_page() - Drop our reference to a page
+ * @pp: the page pool state
+ * @page: page to release
  *
- * Make sure any lingering frags tacked on my GRO are gone. Also make sure
- * miscellaneous fields are cleaned up
+ * If the stack is done with the page it goes straight back into the pool's
+ * cache, otherwise it leaves the pool and is freed by the stack once the
+ * last SKB referencing it is gone.
  *
  * Return:
  *		- void
  **/
-void rmnet_perf_core_reset_recycled_skb(struct sk_buff *skb)
+static void rmnet_perf_core_pp_release_page(struct rmnet_perf_core_page_pool *pp,
+					    struct page *page)
 {
-	unsigned int size;
-	int i;
-	struct skb_shared_info *shinfo = skb_shinfo(skb);
-	unsigned char *head = skb->head;
-
-	/* Free up frags that might have been appended by gro previously */
-	for (i = 0; i < shinfo->nr_frags; i++)
-		__skb_frag_unref(&shinfo->frags[i]);
-
-	if (shinfo->frag_list)
-		kfree_skb_list(shinfo->frag_list);
-
-	skb->data = head;
-	skb->data_len = 0;
-	skb_reset_tail_pointer(skb);
-	atomic_inc((atomic_t *) &skb->users);
-	size = SKB_WITH_OVERHEAD(ksize(head));
-	memset(skb, 0, offsetof(struct sk_buff, tail));
-	skb->truesize = SKB_TRUESIZE(size);
-	skb->mac_header = (typeof(skb->mac_header))~0U;
-	skb->transport_header = (typeof(skb->transport_header))~0U;
-
-	memset(shinfo, 0, offsetof(struct skb_shared_info, dataref));
+	if (page_ref_count(page) == 1)
+		rmnet_perf_core_pp_stats[RMNET_PERF_CORE_PP_RECYCLE]++;
+	else
+		rmnet_perf_core_pp_stats[RMNET_PERF_CORE_PP_RELEASE]++;
+
+	page_pool_put_page(pp->pool, page, true);
 }
 
-/* rmnet_perf_core_elligible_for_cache_skb() - Find elligible recycled skb
- * @len: the outgoing packet length we plan to send out
+/* rmnet_perf_core_pp_deinit() - Tear down the deag mode page pool
+ * @perf: allows access to our required global structures
+ *
+ * Pages still referenced by the stack are detached from the pool and freed
+ * normally when the stack is done with them.
  *
- * Traverse the buffer cache to see if we have any free buffers not
- * currently being used by NW stack, as is evident through the
- * users count.
+ * Return:
+ *		- void
+ **/
+void rmnet_perf_core_pp_deinit(struct rmnet_perf *perf)
+{
+	struct rmnet_perf_core_page_pool *pp = perf->core_meta->page_pool;
+	u16 i;
+
+	if (!pp->pool)
+		return;
+
+	for (i = 0; i < pp->num_inflight; i++)
+		rmnet_perf_core_pp_release_page(pp, pp->inflight[i]);
+	pp->num_inflight = 0;
+
+	if (pp->curr_page)
+		rmnet_perf_core_pp_release_page(pp, pp->curr_page);
+	pp->curr_page = NULL;
+
+	page_pool_destroy(pp->pool);
+	pp->pool = NULL;
+}
+
+/* rmnet_perf_core_pp_enabled() - Check if SKB payloads come from the pool
  *
  * Return:
- *		- skbn: the buffer to be used
- *		- NULL: if the length is not elligible or if all buffers
- *				are busy in NW stack
+ *		- true: payloads can be attached as page pool frags
+ *		- false: SKBs must be built linearly
  **/
-struct sk_buff *rmnet_perf_core_elligible_for_cache_skb(u32 len)
+bool rmnet_perf_core_pp_enabled(void)
 {
 	struct rmnet_perf *perf = rmnet_perf_config_get_perf();
-	struct rmnet_perf_core_64k_buff_pool *buff_pool;
-	u8 circ_index, iterations;
-	struct sk_buff *skbn;
-	int user_count;
-
-	buff_pool = perf->core_meta->buff_pool;
-	if (len < RECYCLE_BUFF_SIZE_THRESH || !buff_pool->available[0])
-		return NULL;
-
-	circ_index = buff_pool->index;
-	iterations = 0;
-	while (iterations < RMNET_PERF_NUM_64K_BUFFS) {
-		user_count = (int) atomic_read((atomic_t *)
-			&buff_pool->available[circ_index]->users);
-		if (user_count > 1) {
-			circ_index = (circ_index + 1) %
-				     RMNET_PERF_NUM_64K_BUFFS;
-			iterations++;
+
+	return !!perf->core_meta->page_pool->pool;
+}
+
+/* rmnet_perf_core_pp_reclaim() - Return pages the stack is done with
+ *
+ * Walk the inflight list and hand back every page we hold the only
+ * reference to. Called whenever we release the held physical device SKBs,
+ * as that is the point where a burst has been fully pushed to the stack.
+ *
+ * Return:
+ *		- void
+ **/
+void rmnet_perf_core_pp_reclaim(void)
+{
+	struct rmnet_perf *perf = rmnet_perf_config_get_perf();
+	struct rmnet_perf_core_page_pool *pp = perf->core_meta->page_pool;
+	u16 i, kept = 0;
+
+	for (i = 0; i < pp->num_inflight; i++) {
+		struct page *page = pp->inflight[i];
+
+		if (page_ref_count(page) == 1) {
+			page_pool_recycle_direct(pp->pool, page);
+			rmnet_perf_core_pp_stats[RMNET_PERF_CORE_PP_RECYCLE]++;
 			continue;
 		}
 
-		skbn = buff_pool->available[circ_index];
-		rmnet_perf_core_reset_recycled_skb(skbn);
-		buff_pool->index = (circ_index + 1) %
-				   RMNET_PERF_NUM_64K_BUFFS;
-		rmnet_perf_core_skb_recycle_iterations[iterations]++;
-		return skbn;
+		pp->inflight[kept++] = page;
 	}
-	/* if we increment this stat, then we know we did'nt find a
-	 * suitable buffer
+
+	pp->num_inflight = kept;
+}
+
+/* rmnet_perf_core_pp_retire_page() - Move the current page to inflight
+ * @pp: the page pool state
+ *
+ * Return:
+ *		- void
+ **/
+static void rmnet_perf_core_pp_retire_page(struct rmnet_perf_core_page_pool *pp)
+{
+	struct page *page = pp->curr_page;
+
+	pp->curr_page = NULL;
+	pp->curr_offset = 0;
+	if (!page)
+		return;
+
+	if (pp->num_inflight == RMNET_PERF_CORE_PP_MAX_INFLIGHT)
+		rmnet_perf_core_pp_reclaim();
+
+	/* Still full, so the stack is sitting on all of them. Let this one
+	 * go rather than tracking it.
 	 */
-	rmnet_perf_core_skb_recycle_iterations[iterations]++;
-	return NULL;
+	if (pp->num_inflight == RMNET_PERF_CORE_PP_MAX_INFLIGHT) {
+		rmnet_perf_core_pp_release_page(pp, page);
+		return;
+	}
+
+	pp->inflight[pp->num_inflight++] = page;
+}
+
+/* rmnet_perf_core_pp_add_data() - Append data to an SKB as page pool frags
+ * @skb: the SKB being built. Headers must already be in the linear area
+ * @data: data to append
+ * @len: length of the data
+ *
+ * Data is packed back to back into the current pool page, so consecutive
+ * appends to the same SKB usually extend the last frag instead of using a
+ * new one.
+ *
+ * Return:
+ *		- 0: data was appended
+ *		- -ENOMEM: no page could be allocated
+ *		- -ENOSPC: the SKB ran out of frags
+ **/
+int rmnet_perf_core_pp_add_data(struct sk_buff *skb, void *data, u32 len)
+{
+	struct rmnet_perf *perf = rmnet_perf_config_get_perf();
+	struct rmnet_perf_core_page_pool *pp = perf->core_meta->page_pool;
+	struct skb_shared_info *shinfo = skb_shinfo(skb);
+
+	while (len) {
+		struct page *page;
+		u32 offset, copy;
+		int last = shinfo->nr_frags - 1;
+
+		if (!pp->curr_page || pp->curr_offset == PAGE_SIZE) {
+			rmnet_perf_core_pp_retire_page(pp);
+			pp->curr_page = page_pool_dev_alloc_pages(pp->pool);
+			if (!pp->curr_page) {
+				rmnet_perf_core_pp_stats[
+					RMNET_PERF_CORE_PP_ALLOC_FAIL]++;
+				return -ENOMEM;
+			}
+
+			rmnet_perf_core_pp_stats[RMNET_PERF_CORE_PP_ALLOC]++;
+		}
+
+		page = pp->curr_page;
+		offset = pp->curr_offset;
+		copy = min_t(u32, len, PAGE_SIZE - offset);
+
+		if (last >= 0 && skb_frag_page(&shinfo->frags[last]) == page &&
+		    shinfo->frags[last].page_offset +
+		    skb_frag_size(&shinfo->frags[last]) == offset) {
+			memcpy(page_address(page) + offset, data, copy);
+			skb_coalesce_rx_frag(skb, last, copy, copy);
+		} else {
+			if (shinfo->nr_frags == MAX_SKB_FRAGS)
+				return -ENOSPC;
+
+			memcpy(page_address(page) + offset, data, copy);
+			get_page(page);
+			skb_add_rx_frag(skb, shinfo->nr_frags, page, offset,
+					copy, copy);
+		}
+
+		pp->curr_offset += copy;
+		data += copy;
+		len -= copy;
+	}
+
+	return 0;
+}
+
+/* XDP program run on each deaggregated packet, set via module parameter */
+static struct bpf_prog __rcu *rmnet_perf_core_xdp_prog;
+static DEFINE_MUTEX(rmnet_perf_core_xdp_lock);
+
+static void rmnet_perf_core_xdp_swap(struct bpf_prog *prog)
+{
+	struct bpf_prog *old;
+
+	mutex_lock(&rmnet_perf_core_xdp_lock);
+	old = rcu_dereference_protected(rmnet_perf_core_xdp_prog,
+			lockdep_is_held(&rmnet_perf_core_xdp_lock));
+	rcu_assign_pointer(rmnet_perf_core_xdp_prog, prog);
+	mutex_unlock(&rmnet_perf_core_xdp_lock);
+
+	if (old) {
+		synchronize_rcu();
+		bpf_prog_put(old);
+	}
+}
+
+/* Writing the path of a pinned XDP program attaches it. Writing an empty
+ * string detaches the current one.
+ */
+static int rmnet_perf_core_xdp_set(const char *val,
+				   const struct kernel_param *kp)
+{
+	struct bpf_prog *prog;
+	char path[128];
+	char *name;
+
+	strlcpy(path, val, sizeof(path));
+	name = strim(path);
+	if (!*name) {
+		rmnet_perf_core_xdp_swap(NULL);
+		return 0;
+	}
+
+	prog = bpf_prog_get_type_path(name, BPF_PROG_TYPE_XDP);
+	if (IS_ERR(prog))
+		return PTR_ERR(prog);
+
+	rmnet_perf_core_xdp_swap(prog);
+	return 0;
+}
+
+static int rmnet_perf_core_xdp_get(char *buf, const struct kernel_param *kp)
+{
+	bool attached;
+
+	rcu_read_lock();
+	attached = !!rcu_dereference(rmnet_perf_core_xdp_prog);
+	rcu_read_unlock();
+
+	return scnprintf(buf, PAGE_SIZE, "%s\n",
+			 attached ? "attached" : "none");
+}
+
+static const struct kernel_param_ops rmnet_perf_core_xdp_ops = {
+	.set = rmnet_perf_core_xdp_set,
+	.get = rmnet_perf_core_xdp_get,
+};
+module_param_cb(rmnet_perf_xdp_prog, &rmnet_perf_core_xdp_ops, NULL, 0644);
+MODULE_PARM_DESC(rmnet_perf_xdp_prog,
+		 "Path of a pinned XDP program to run on deaggregated packets");
+
+/* rmnet_perf_core_xdp_detach() - Drop any attached XDP program
+ *
+ * Return:
+ *		- void
+ **/
+void rmnet_perf_core_xdp_detach(void)
+{
+	rmnet_perf_core_xdp_swap(NULL);
+}
+
+/* rmnet_perf_core_run_xdp() - Run the attached XDP program on a packet
+ * @skb: the aggregated MAP frame holding the packet
+ * @ep: VND the packet is destined for
+ * @offset: offset from start of skb data to the IP header
+ * @pkt_len: length of the IP packet
+ *
+ * The program sees the packet in place inside the aggregated frame, before
+ * any SKB is built for it. It may rewrite packet bytes, but moving the
+ * packet boundaries is not supported, and XDP_TX/XDP_REDIRECT have nowhere
+ * to go from here. Either case drops the packet.
+ *
+ * Return:
+ *		- true: packet should continue through rmnet_perf
+ *		- false: packet has been dropped
+ **/
+static bool rmnet_perf_core_run_xdp(struct sk_buff *skb,
+				    struct rmnet_endpoint *ep,
+				    unsigned int offset, u16 pkt_len)
+{
+	struct xdp_rxq_info rxq = {};
+	struct bpf_prog *prog;
+	struct xdp_buff xdp;
+	void *data, *data_end;
+	u32 act;
+
+	rcu_read_lock();
+	prog = rcu_dereference(rmnet_perf_core_xdp_prog);
+	if (!prog) {
+		rcu_read_unlock();
+		return true;
+	}
+
+	data = skb->data + offset;
+	data_end = data + pkt_len;
+	xdp.data_hard_start = data;
+	xdp.data = data;
+	xdp.data_end = data_end;
+	xdp_set_data_meta_invalid(&xdp);
+	rxq.dev = ep->egress_dev;
+	xdp.rxq = &rxq;
+
+	act = bpf_prog_run_xdp(prog, &xdp);
+	rcu_read_unlock();
+
+	switch (act) {
+	case XDP_PASS:
+		if (xdp.data != data || xdp.data_end != data_end) {
+			rmnet_perf_core_xdp_stats[
+				RMNET_PERF_CORE_XDP_UNSUPPORTED]++;
+			return false;
+		}
+
+		rmnet_perf_core_xdp_stats[RMNET_PERF_CORE_XDP_PASS]++;
+		return true;
+	case XDP_DROP:
+		rmnet_perf_core_xdp_stats[RMNET_PERF_CORE_XDP_DROP]++;
+		return false;
+	case XDP_TX:
+	case XDP_REDIRECT:
+		rmnet_perf_core_xdp_stats[RMNET_PERF_CORE_XDP_UNSUPPORTED]++;
+		return false;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		/* fall through */
+	case XDP_ABORTED:
+		rmnet_perf_core_xdp_stats[RMNET_PERF_CORE_XDP_ABORTED]++;
+		return false;
+	}
 }
 
 /* rmnet_perf_core_compute_flow_hash() - calculate hash of a given packets
@@ -443,14 +734,35 @@ void rmnet_perf_core_flush_curr_pkt(struct rmnet_perf_pkt_info *pkt_info,
 		rmnet_perf_core_send_desc(frag_desc);
 	} else {
 		struct sk_buff *skb;
+		u8 *data = (u8 *)pkt_info->ip_hdr.v4hdr;
+		u16 hdr_len = pkt_info->ip_len + pkt_info->trans_len;
+
+		if (packet_len <= RMNET_PERF_CORE_PP_COPYBREAK ||
+		    hdr_len >= packet_len || !rmnet_perf_core_pp_enabled())
+			hdr_len = packet_len;
 
-		skb = alloc_skb(packet_len + RMNET_MAP_DEAGGR_SPACING,
+		skb = alloc_skb(hdr_len + RMNET_MAP_DEAGGR_SPACING,
 				GFP_ATOMIC);
 		if (!skb)
 			return;
 
 		skb_reserve(skb, RMNET_MAP_DEAGGR_HEADROOM);
-		skb_put_data(skb, pkt_info->ip_hdr.v4hdr, packet_len);
+		skb_put_data(skb, data, hdr_len);
+		if (hdr_len < packet_len &&
+		    rmnet_perf_core_pp_add_data(skb, data + hdr_len,
+						packet_len - hdr_len)) {
+			/* Rebuild it linearly */
+			rmnet_perf_core_pp_stats[
+				RMNET_PERF_CORE_PP_LINEAR_FALLBACK]++;
+			kfree_skb(skb);
+			skb = alloc_skb(packet_len + RMNET_MAP_DEAGGR_SPACING,
+					GFP_ATOMIC);
+			if (!skb)
+				return;
+
+			skb_reserve(skb, RMNET_MAP_DEAGGR_HEADROOM);
+			skb_put_data(skb, data, packet_len);
+		}
 
 		/* If the packet passed checksum validation, tell the stack */
 		if (pkt_info->csum_valid)
@@ -815,6 +1127,12 @@ void rmnet_perf_core_handle_packet_ingress(struct sk_buff *skb,
 	memset(pkt_info, 0, sizeof(*pkt_info));
 	pkt_info->ep = ep;
 
+	if (!rmnet_perf_core_run_xdp(skb, ep, offset, pkt_len)) {
+		/* account for the bulk add in rmnet_perf_core_deaggregate() */
+		rmnet_perf_core_pre_ip_count--;
+		return;
+	}
+
 	if (rmnet_perf_core_dissect_skb(skb, pkt_info, offset, pkt_len,
 					&skip_hash, &len_mismatch)) {
 		rmnet_perf_core_non_ip_count++;
@@ -851,6 +1169,10 @@ void rmnet_perf_core_handle_packet_ingress(struct sk_buff *skb,
  * @skb: the incoming skb from core driver
  * @port: the rmnet_perf struct from core driver
  *
+ * Descriptors carry no state shared with other packets, so only the flow
+ * table shard of the packet is locked. Multiple contexts can coalesce
+ * different flows in parallel.
+ *
  * Return:
  *		- void
  **/
@@ -863,14 +1185,12 @@ void rmnet_perf_core_desc_entry(struct rmnet_frag_descriptor *frag_desc,
 	bool skip_hash = true;
 	bool len_mismatch = false;
 
-	rmnet_perf_core_grab_lock();
 	perf->rmnet_port = port;
 	memset(&pkt_info, 0, sizeof(pkt_info));
 	if (rmnet_perf_core_dissect_desc(frag_desc, &pkt_info, 0, pkt_len,
 					 &skip_hash, &len_mismatch)) {
 		rmnet_perf_core_non_ip_count++;
 		rmnet_recycle_frag_descriptor(frag_desc, port);
-		rmnet_perf_core_release_lock();
 		return;
 	}
 
@@ -898,12 +1218,10 @@ void rmnet_perf_core_desc_entry(struct rmnet_frag_descriptor *frag_desc,
 	if (!rmnet_perf_opt_ingress(&pkt_info))
 		goto flush;
 
-	rmnet_perf_core_release_lock();
 	return;
 
 flush:
 	rmnet_perf_core_flush_curr_pkt(&pkt_info, pkt_len, false, skip_hash);
-	rmnet_perf_core_release_lock();
 }
 
 int __rmnet_perf_core_deaggregate(struct sk_buff *skb, struct rmnet_port *port)
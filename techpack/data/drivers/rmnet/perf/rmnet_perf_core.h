@@ -17,8 +17,10 @@
 #ifndef _RMNET_PERF_CORE_H_
 #define _RMNET_PERF_CORE_H_
 
-#define RMNET_PERF_NUM_64K_BUFFS              50
-#define RMNET_PERF_CORE_RECYCLE_SKB_SIZE    65600//33000//32768//65600
+#define RMNET_PERF_CORE_PP_POOL_SIZE          256
+#define RMNET_PERF_CORE_PP_MAX_INFLIGHT       256
+/* Packets at or below this size are copied into the linear area */
+#define RMNET_PERF_CORE_PP_COPYBREAK          256
 
 struct rmnet_perf {
 	struct rmnet_perf_opt_meta *opt_meta;
@@ -71,9 +73,17 @@ struct rmnet_perf_pkt_info {
 	};
 };
 
-struct rmnet_perf_core_64k_buff_pool {
-	u8 index;
-	struct sk_buff *available[RMNET_PERF_NUM_64K_BUFFS];
+/* Pages backing the payload of the SKBs we build in deag mode. The page
+ * currently being filled is carved up sequentially, and every page handed
+ * to the stack stays on the inflight list with our reference held until
+ * the stack drops its own, at which point it goes back to the pool.
+ */
+struct rmnet_perf_core_page_pool {
+	struct page_pool *pool;
+	struct page *curr_page;
+	u32 curr_offset;
+	u16 num_inflight;
+	struct page *inflight[RMNET_PERF_CORE_PP_MAX_INFLIGHT];
 };
 
 struct rmnet_perf_core_burst_marker_state {
@@ -98,8 +108,8 @@ struct rmnet_perf_core_skb_list {
 struct rmnet_perf_core_meta {
 	/* skbs from physical device */
 	struct rmnet_perf_core_skb_list *skb_needs_free_list;
-	/* recycled buffer pool */
-	struct rmnet_perf_core_64k_buff_pool *buff_pool;
+	/* page pool for deaggregated packet payloads */
+	struct rmnet_perf_core_page_pool *page_pool;
 	struct net_device *dev;
 	struct rmnet_perf_core_burst_marker_state *bm_state;
 	struct rmnet_map_dl_ind *dl_ind;
@@ -114,6 +124,25 @@ enum rmnet_perf_core_flush_reasons {
 	RMNET_PERF_CORE_NUM_CONDITIONS
 };
 
+enum rmnet_perf_core_pp_stats_e {
+	RMNET_PERF_CORE_PP_ALLOC,
+	RMNET_PERF_CORE_PP_ALLOC_FAIL,
+	RMNET_PERF_CORE_PP_RECYCLE,
+	RMNET_PERF_CORE_PP_RELEASE,
+	RMNET_PERF_CORE_PP_LINEAR_FALLBACK,
+	RMNET_PERF_CORE_PP_STATS_MAX
+};
+
+extern unsigned long int rmnet_perf_core_pp_stats[RMNET_PERF_CORE_PP_STATS_MAX];
+
+enum rmnet_perf_core_xdp_stats_e {
+	RMNET_PERF_CORE_XDP_PASS,
+	RMNET_PERF_CORE_XDP_DROP,
+	RMNET_PERF_CORE_XDP_ABORTED,
+	RMNET_PERF_CORE_XDP_UNSUPPORTED,
+	RMNET_PERF_CORE_XDP_STATS_MAX
+};
+
 enum rmnet_perf_core_pkt_size_e {
 	RMNET_PERF_CORE_50000_PLUS,
 	RMNET_PERF_CORE_30000_PLUS, //32k full bucket
@@ -142,8 +171,12 @@ void rmnet_perf_core_ps_on(void *port);
 void rmnet_perf_core_ps_off(void *port);
 bool rmnet_perf_core_is_deag_mode(void);
 void rmnet_perf_core_set_ingress_hook(void);
-void rmnet_perf_core_reset_recycled_skb(struct sk_buff *skb);
-struct sk_buff *rmnet_perf_core_elligible_for_cache_skb(u32 len);
+int rmnet_perf_core_pp_init(struct rmnet_perf *perf);
+void rmnet_perf_core_pp_deinit(struct rmnet_perf *perf);
+bool rmnet_perf_core_pp_enabled(void);
+int rmnet_perf_core_pp_add_data(struct sk_buff *skb, void *data, u32 len);
+void rmnet_perf_core_pp_reclaim(void);
+void rmnet_perf_core_xdp_detach(void);
 void rmnet_perf_core_free_held_skbs(void);
 void rmnet_perf_core_send_skb(struct sk_buff *skb, struct rmnet_endpoint *ep);
 void rmnet_perf_core_send_desc(struct rmnet_frag_descriptor *frag_desc);
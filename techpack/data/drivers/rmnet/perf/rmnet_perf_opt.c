@@ -29,17 +29,13 @@
 #include "rmnet_perf_core.h"
 #include "rmnet_perf_config.h"
 
-/* If true then we allocate all large SKBs */
-unsigned long int rmnet_perf_opt_skb_recycle_off = 1;
+/* If true then we allocate all large SKBs linearly instead of attaching
+ * page pool frags
+ */
+unsigned long int rmnet_perf_opt_skb_recycle_off;
 module_param(rmnet_perf_opt_skb_recycle_off, ulong, 0644);
-MODULE_PARM_DESC(rmnet_perf_opt_skb_recycle_off, "Num skbs max held");
-
-/* Stat showing reason for flushes of flow nodes */
-unsigned long int
-rmnet_perf_opt_flush_reason_cnt[RMNET_PERF_OPT_NUM_CONDITIONS];
-module_param_array(rmnet_perf_opt_flush_reason_cnt, ulong, 0, 0444);
-MODULE_PARM_DESC(rmnet_perf_opt_flush_reason_cnt,
-		 "opt performance statistics");
+MODULE_PARM_DESC(rmnet_perf_opt_skb_recycle_off,
+		 "Build coalesced SKBs linearly instead of from the page pool");
 
 /* Stat showing packets dropped due to lack of memory */
 unsigned long int rmnet_perf_opt_oom_drops = 0;
@@ -57,18 +53,83 @@ enum {
 /* What protocols we optimize */
 static int rmnet_perf_opt_mode = RMNET_PERF_OPT_MODE_ALL;
 
-/* flow hash table */
-DEFINE_HASHTABLE(rmnet_perf_opt_fht, RMNET_PERF_FLOW_HASH_TABLE_BITS);
+/* flow hash table, sharded by flow hash */
+static struct rmnet_perf_opt_shard
+rmnet_perf_opt_shards[RMNET_PERF_OPT_NUM_SHARDS];
+
+/* Stat showing reason for flushes of flow nodes, one line per shard */
+static int rmnet_perf_opt_get_flush_reason_cnt(char *buf,
+					       const struct kernel_param *kp)
+{
+	int len = 0;
+	int i, j;
+
+	for (i = 0; i < RMNET_PERF_OPT_NUM_SHARDS; i++) {
+		struct rmnet_perf_opt_shard *shard = &rmnet_perf_opt_shards[i];
+
+		for (j = 0; j < RMNET_PERF_OPT_NUM_CONDITIONS; j++)
+			len += scnprintf(buf + len, PAGE_SIZE - len, "%s%lu",
+					 (j) ? "," : "",
+					 READ_ONCE(shard->flush_reason_cnt[j]));
+
+		len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+	}
+
+	return len;
+}
+
+static const struct kernel_param_ops rmnet_perf_opt_flush_reason_cnt_ops = {
+	.get = rmnet_perf_opt_get_flush_reason_cnt,
+};
+
+module_param_cb(rmnet_perf_opt_flush_reason_cnt,
+		&rmnet_perf_opt_flush_reason_cnt_ops, NULL, 0444);
+MODULE_PARM_DESC(rmnet_perf_opt_flush_reason_cnt,
+		 "opt performance statistics per flow table shard");
+
+/* rmnet_perf_opt_init_shards() - Prepare the flow table shards
+ *
+ * Return:
+ *		- void
+ **/
+void rmnet_perf_opt_init_shards(void)
+{
+	int i;
+
+	for (i = 0; i < RMNET_PERF_OPT_NUM_SHARDS; i++) {
+		spin_lock_init(&rmnet_perf_opt_shards[i].lock);
+		hash_init(rmnet_perf_opt_shards[i].fht);
+	}
+}
+
+static inline u8 rmnet_perf_opt_shard_id(u32 hash_val)
+{
+	return hash_val % RMNET_PERF_OPT_NUM_SHARDS;
+}
+
+static inline struct rmnet_perf_opt_shard *
+rmnet_perf_opt_get_shard(u32 hash_val)
+{
+	return &rmnet_perf_opt_shards[rmnet_perf_opt_shard_id(hash_val)];
+}
 
 static void rmnet_perf_opt_flush_flow_nodes_by_protocol(u8 protocol)
 {
 	struct rmnet_perf_opt_flow_node *flow_node;
 	int bkt_cursor;
+	int i;
 
-	hash_for_each(rmnet_perf_opt_fht, bkt_cursor, flow_node, list) {
-		if (flow_node->num_pkts_held > 0 &&
-		    flow_node->trans_proto == protocol)
-			rmnet_perf_opt_flush_single_flow_node(flow_node);
+	for (i = 0; i < RMNET_PERF_OPT_NUM_SHARDS; i++) {
+		struct rmnet_perf_opt_shard *shard = &rmnet_perf_opt_shards[i];
+
+		spin_lock_bh(&shard->lock);
+		hash_for_each(shard->fht, bkt_cursor, flow_node, list) {
+			if (flow_node->num_pkts_held > 0 &&
+			    flow_node->trans_proto == protocol)
+				rmnet_perf_opt_flush_single_flow_node(
+								flow_node);
+		}
+		spin_unlock_bh(&shard->lock);
 	}
 }
 
@@ -212,7 +273,7 @@ rmnet_perf_opt_ip_flag_flush(struct rmnet_perf_opt_flow_node *flow_node,
 		break;
 	default:
 		pr_err("Unsupported ip version %d", pkt_info->ip_proto);
-		rmnet_perf_opt_flush_reason_cnt[
+		rmnet_perf_opt_shards[flow_node->shard].flush_reason_cnt[
 				RMNET_PERF_OPT_PACKET_CORRUPT_ERROR]++;
 	}
 	return false;
@@ -279,7 +340,7 @@ rmnet_perf_opt_identify_flow(struct rmnet_perf_opt_flow_node *flow_node,
 		break;
 	default:
 		pr_err("Unsupported ip version %d", pkt_info->ip_proto);
-		rmnet_perf_opt_flush_reason_cnt[
+		rmnet_perf_opt_shards[flow_node->shard].flush_reason_cnt[
 				RMNET_PERF_OPT_PACKET_CORRUPT_ERROR]++;
 		return false;
 	}
@@ -336,10 +397,6 @@ rmnet_perf_opt_add_flow_subfrags(struct rmnet_perf_opt_flow_node *flow_node)
  * @headlen: The amount of space to allocate for linear data. Does not include
  *		extra deaggregation headeroom.
  *
- * Allocates a new SKB large enough to hold the amount of data provided, or
- * returns a preallocated SKB if recycling is enabled and there are cached
- * buffers available.
- *
  * Return:
  *		- skb: the new SKb to use
  *		- NULL: memory failure
@@ -348,13 +405,6 @@ static struct sk_buff *rmnet_perf_opt_alloc_flow_skb(u32 headlen)
 {
 	struct sk_buff *skb;
 
-	/* Grab a preallocated SKB if possible */
-	if (!rmnet_perf_opt_skb_recycle_off) {
-		skb = rmnet_perf_core_elligible_for_cache_skb(headlen);
-		if (skb)
-			return skb;
-	}
-
 	skb = alloc_skb(headlen + RMNET_MAP_DEAGGR_SPACING, GFP_ATOMIC);
 	if (!skb)
 		return NULL;
@@ -363,6 +413,45 @@ static struct sk_buff *rmnet_perf_opt_alloc_flow_skb(u32 headlen)
 	return skb;
 }
 
+/* rmnet_perf_opt_make_flow_skb_frags() - Build the SKB for a flow node with
+ *		the payload in page pool frags
+ * @flow_node: opt structure containing packet we are allocating for
+ *
+ * Only the headers are placed in the linear area. The payload of each held
+ * packet is appended to pool pages, which avoids the large linear
+ * allocation and lets the pages be reused once the stack frees the SKB.
+ *
+ * Return:
+ *		- skb: The new SKB to use
+ *		- NULL: memory failure or out of frags
+ **/
+static struct sk_buff *
+rmnet_perf_opt_make_flow_skb_frags(struct rmnet_perf_opt_flow_node *flow_node)
+{
+	struct sk_buff *skb;
+	struct rmnet_perf_opt_pkt_node *pkt_list;
+	int i;
+
+	pkt_list = flow_node->pkt_list;
+	skb = rmnet_perf_opt_alloc_flow_skb(flow_node->ip_len +
+					    flow_node->trans_len);
+	if (!skb)
+		return NULL;
+
+	skb_put_data(skb, pkt_list[0].header_start,
+		     flow_node->ip_len + flow_node->trans_len);
+
+	for (i = 0; i < flow_node->num_pkts_held; i++) {
+		if (rmnet_perf_core_pp_add_data(skb, pkt_list[i].data_start,
+						pkt_list[i].data_len)) {
+			kfree_skb(skb);
+			return NULL;
+		}
+	}
+
+	return skb;
+}
+
 /* rmnet_perf_opt_make_flow_skb() - Allocate and populate SKBs for flow node
  *		that is being pushed up the stack
  * @flow_node: opt structure containing packet we are allocating for
@@ -380,6 +469,15 @@ rmnet_perf_opt_make_flow_skb(struct rmnet_perf_opt_flow_node *flow_node)
 	u32 alloc_len;
 	u32 total_pkt_size = 0;
 
+	if (!rmnet_perf_opt_skb_recycle_off && rmnet_perf_core_pp_enabled() &&
+	    flow_node->len > RMNET_PERF_CORE_PP_COPYBREAK) {
+		skb = rmnet_perf_opt_make_flow_skb_frags(flow_node);
+		if (skb)
+			return skb;
+
+		rmnet_perf_core_pp_stats[RMNET_PERF_CORE_PP_LINEAR_FALLBACK]++;
+	}
+
 	pkt_list = flow_node->pkt_list;
 	alloc_len = flow_node->len + flow_node->ip_len + flow_node->trans_len;
 	skb = rmnet_perf_opt_alloc_flow_skb(alloc_len);
@@ -476,6 +574,7 @@ rmnet_perf_opt_flow_skb_fixup(struct sk_buff *skb,
 }
 
 /* rmnet_perf_opt_get_new_flow_index() - Pull flow node from node pool
+ * @shard_id: the shard whose pool to use. Caller holds its lock
  *
  * Fetch the flow node from the node pool. If we have already given
  * out all the flow nodes then we will always hit the else case and
@@ -485,22 +584,24 @@ rmnet_perf_opt_flow_skb_fixup(struct sk_buff *skb,
  * Return:
  *		- flow_node: node to be used by caller function
  **/
-static struct rmnet_perf_opt_flow_node *rmnet_perf_opt_get_new_flow_index(void)
+static struct rmnet_perf_opt_flow_node *
+rmnet_perf_opt_get_new_flow_index(u8 shard_id)
 {
 	struct rmnet_perf *perf = rmnet_perf_config_get_perf();
 	struct rmnet_perf_opt_flow_node_pool *node_pool;
 	struct rmnet_perf_opt_flow_node *flow_node_ejected;
 
-	node_pool = perf->opt_meta->node_pool;
+	node_pool = &perf->opt_meta->node_pool[shard_id];
 	/* once this value gets too big it never goes back down.
 	 * from that point forward we use flow node repurposing techniques
 	 * instead
 	 */
-	if (node_pool->num_flows_in_use < RMNET_PERF_NUM_FLOW_NODES)
+	if (node_pool->num_flows_in_use < RMNET_PERF_OPT_NODES_PER_SHARD)
 		return node_pool->node_list[node_pool->num_flows_in_use++];
 
 	flow_node_ejected = node_pool->node_list[
-		node_pool->flow_recycle_counter++ % RMNET_PERF_NUM_FLOW_NODES];
+		node_pool->flow_recycle_counter++ %
+		RMNET_PERF_OPT_NODES_PER_SHARD];
 	rmnet_perf_opt_flush_single_flow_node(flow_node_ejected);
 	hash_del(&flow_node_ejected->list);
 	return flow_node_ejected;
@@ -583,48 +684,79 @@ void rmnet_perf_opt_flush_single_flow_node(
  **/
 void rmnet_perf_opt_flush_flow_by_hash(u32 hash_val)
 {
+	struct rmnet_perf_opt_shard *shard = rmnet_perf_opt_get_shard(hash_val);
 	struct rmnet_perf_opt_flow_node *flow_node;
 
-	hash_for_each_possible(rmnet_perf_opt_fht, flow_node, list, hash_val) {
+	spin_lock_bh(&shard->lock);
+	hash_for_each_possible(shard->fht, flow_node, list, hash_val) {
 		if (hash_val == flow_node->hash_value &&
 		    flow_node->num_pkts_held > 0)
 			rmnet_perf_opt_flush_single_flow_node(flow_node);
 	}
+	spin_unlock_bh(&shard->lock);
 }
 
-/* rmnet_perf_opt_flush_all_flow_nodes() - Iterate through all flow nodes
- *		and flush them individually
+/* rmnet_perf_opt_flush_shard() - Flush every flow node in a shard
+ * @shard: the shard to flush. Caller holds its lock
  *
  * Return:
- *    - void
+ *    - true if anything was flushed
  **/
-void rmnet_perf_opt_flush_all_flow_nodes(void)
+static bool rmnet_perf_opt_flush_shard(struct rmnet_perf_opt_shard *shard)
 {
 	struct rmnet_perf_opt_flow_node *flow_node;
 	int bkt_cursor;
-	int num_pkts_held;
-	u32 hash_val;
+	bool flushed = false;
 
-	hash_for_each(rmnet_perf_opt_fht, bkt_cursor, flow_node, list) {
-		hash_val = flow_node->hash_value;
-		num_pkts_held = flow_node->num_pkts_held;
-		if (num_pkts_held > 0) {
+	hash_for_each(shard->fht, bkt_cursor, flow_node, list) {
+		if (flow_node->num_pkts_held > 0) {
 			rmnet_perf_opt_flush_single_flow_node(flow_node);
+			flushed = true;
 		}
 	}
+
+	return flushed;
+}
+
+/* rmnet_perf_opt_flush_all_flow_nodes() - Iterate through all flow nodes
+ *		and flush them individually
+ *
+ * Return:
+ *    - void
+ **/
+void rmnet_perf_opt_flush_all_flow_nodes(void)
+{
+	int i;
+
+	for (i = 0; i < RMNET_PERF_OPT_NUM_SHARDS; i++) {
+		struct rmnet_perf_opt_shard *shard = &rmnet_perf_opt_shards[i];
+
+		spin_lock_bh(&shard->lock);
+		rmnet_perf_opt_flush_shard(shard);
+		spin_unlock_bh(&shard->lock);
+	}
 }
 
 /* rmnet_perf_opt_chain_end() - Handle end of SKB chain notification
+ *
+ * Each shard is flushed under its own lock, so this does not serialize
+ * against coalescing in the other shards.
  *
  * Return:
  *    - void
  **/
 void rmnet_perf_opt_chain_end(void)
 {
-	rmnet_perf_core_grab_lock();
-	rmnet_perf_opt_flush_reason_cnt[RMNET_PERF_OPT_CHAIN_END]++;
-	rmnet_perf_opt_flush_all_flow_nodes();
-	rmnet_perf_core_release_lock();
+	int i;
+
+	for (i = 0; i < RMNET_PERF_OPT_NUM_SHARDS; i++) {
+		struct rmnet_perf_opt_shard *shard = &rmnet_perf_opt_shards[i];
+
+		spin_lock_bh(&shard->lock);
+		if (rmnet_perf_opt_flush_shard(shard))
+			shard->flush_reason_cnt[RMNET_PERF_OPT_CHAIN_END]++;
+		spin_unlock_bh(&shard->lock);
+	}
 }
 
 /* rmnet_perf_opt_insert_pkt_in_flow() - Inserts single IP packet into
@@ -714,14 +846,19 @@ void rmnet_perf_opt_insert_pkt_in_flow(
 void
 rmnet_perf_free_hash_table(void)
 {
-	int i;
+	int i, j;
 	struct rmnet_perf_opt_flow_node *flow_node;
 	struct hlist_node *tmp;
 
-	hash_for_each_safe(rmnet_perf_opt_fht, i, tmp, flow_node, list) {
-		hash_del(&flow_node->list);
-	}
+	for (j = 0; j < RMNET_PERF_OPT_NUM_SHARDS; j++) {
+		struct rmnet_perf_opt_shard *shard = &rmnet_perf_opt_shards[j];
 
+		spin_lock_bh(&shard->lock);
+		hash_for_each_safe(shard->fht, i, tmp, flow_node, list) {
+			hash_del(&flow_node->list);
+		}
+		spin_unlock_bh(&shard->lock);
+	}
 }
 
 /* rmnet_perf_opt_ingress() - Core business logic of optimization framework
@@ -730,7 +867,7 @@ rmnet_perf_free_hash_table(void)
  * Makes determination of what to do with a given incoming
  * ip packet. Find matching flow if it exists and call protocol-
  * specific helper to try and insert the packet and handle any
- * flushing needed.
+ * flushing needed. Only the shard owning the packet's hash is locked.
  *
  * Return:
  *		- true if packet has been handled
@@ -740,15 +877,21 @@ bool rmnet_perf_opt_ingress(struct rmnet_perf_pkt_info *pkt_info)
 {
 	struct rmnet_perf_opt_flow_node *flow_node;
 	struct rmnet_perf_opt_flow_node *flow_node_recycled;
+	struct rmnet_perf_opt_shard *shard;
+	u8 shard_id;
 	bool flush;
 	bool handled = false;
 	bool flow_node_exists = false;
 
 	if (!rmnet_perf_optimize_protocol(pkt_info->trans_proto))
-		goto out;
+		return false;
+
+	shard_id = rmnet_perf_opt_shard_id(pkt_info->hash_key);
+	shard = &rmnet_perf_opt_shards[shard_id];
+	spin_lock_bh(&shard->lock);
 
 handle_pkt:
-	hash_for_each_possible(rmnet_perf_opt_fht, flow_node, list,
+	hash_for_each_possible(shard->fht, flow_node, list,
 			       pkt_info->hash_key) {
 		if (!rmnet_perf_opt_identify_flow(flow_node, pkt_info))
 			continue;
@@ -779,14 +922,15 @@ bool rmnet_perf_opt_ingress(struct rmnet_perf_pkt_info *pkt_info)
 
 	/* If we didn't find the flow, we need to add it and try again */
 	if (!flow_node_exists) {
-		flow_node_recycled = rmnet_perf_opt_get_new_flow_index();
+		flow_node_recycled = rmnet_perf_opt_get_new_flow_index(shard_id);
 		flow_node_recycled->hash_value = pkt_info->hash_key;
 		rmnet_perf_opt_update_flow(flow_node_recycled, pkt_info);
-		hash_add(rmnet_perf_opt_fht, &flow_node_recycled->list,
+		hash_add(shard->fht, &flow_node_recycled->list,
 			 pkt_info->hash_key);
 		goto handle_pkt;
 	}
 
 out:
+	spin_unlock_bh(&shard->lock);
 	return handled;
 }
@@ -14,10 +14,16 @@
 #define _RMNET_PERF_OPT_H_
 
 #include <linux/skbuff.h>
+#include <linux/hashtable.h>
+#include <linux/spinlock.h>
 #include "rmnet_perf_core.h"
 
 #define RMNET_PERF_FLOW_HASH_TABLE_BITS        4
 #define RMNET_PERF_NUM_FLOW_NODES             50
+/* Flows are spread over independently locked shards by their hash */
+#define RMNET_PERF_OPT_NUM_SHARDS              4
+#define RMNET_PERF_OPT_NODES_PER_SHARD \
+	DIV_ROUND_UP(RMNET_PERF_NUM_FLOW_NODES, RMNET_PERF_OPT_NUM_SHARDS)
 
 struct rmnet_perf_opt_pkt_node {
 	unsigned char *header_start;
@@ -68,6 +74,7 @@ struct rmnet_perf_opt_flow_node {
 	u32 gso_len;
 
 	/* Perf metadata */
+	u8 shard;
 	u8 num_pkts_held;
 	u32 len;
 	u32 hash_value;
@@ -82,10 +89,11 @@ struct rmnet_perf_opt_flow_node_pool {
 	u8 num_flows_in_use;
 	u16 flow_recycle_counter;
 	struct rmnet_perf_opt_flow_node *
-		node_list[RMNET_PERF_NUM_FLOW_NODES];
+		node_list[RMNET_PERF_OPT_NODES_PER_SHARD];
 };
 
 struct rmnet_perf_opt_meta {
+	/* One pool per shard */
 	struct rmnet_perf_opt_flow_node_pool *node_pool;
 };
 
@@ -95,6 +103,16 @@ enum rmnet_perf_opt_flush_reasons {
 	RMNET_PERF_OPT_NUM_CONDITIONS
 };
 
+/* A slice of the flow table. The lock covers the hash table, every flow
+ * node in the shard's pool and the packets those nodes hold. When both are
+ * needed, rmnet_perf_core_lock is taken first.
+ */
+struct rmnet_perf_opt_shard {
+	spinlock_t lock;
+	DECLARE_HASHTABLE(fht, RMNET_PERF_FLOW_HASH_TABLE_BITS);
+	unsigned long flush_reason_cnt[RMNET_PERF_OPT_NUM_CONDITIONS];
+};
+
 void
 rmnet_perf_opt_update_flow(struct rmnet_perf_opt_flow_node *flow_node,
 			   struct rmnet_perf_pkt_info *pkt_info);
@@ -108,5 +126,6 @@ void rmnet_perf_opt_insert_pkt_in_flow(
 			struct rmnet_perf_pkt_info *pkt_info);
 bool rmnet_perf_opt_ingress(struct rmnet_perf_pkt_info *pkt_info);
 void rmnet_perf_free_hash_table(void);
+void rmnet_perf_opt_init_shards(void);
 
 #endif /* _RMNET_PERF_OPT_H_ */
@@ -85,6 +85,9 @@ struct core_flush_s {
 	struct work_struct work;
 	struct timespec coretime;
 	int coresum;
+	/* EWMA of pkts per rate interval and of its change per interval */
+	int ewma_load;
+	int ewma_trend;
 	u8 core;
 };
 
@@ -144,6 +147,12 @@ struct rmnet_shs_skbn_s {
 	/* Transport protocol associated with this flow*/
 	u8 is_shs_enabled;
 	/*Is SHS enabled for this flow*/
+	u64 ewma_ts;
+	/* start of the current flow rate sampling interval */
+	u32 ewma_pkts;
+	/* pkts flushed in the current sampling interval */
+	u32 ewma_rate;
+	/* EWMA of pkts per rate interval for this flow */
 };
 
 enum rmnet_shs_tmr_force_flush_state_e {
@@ -159,9 +168,17 @@ enum rmnet_shs_switch_reason_e {
 	RMNET_SHS_OOO_PACKET_TOTAL,
 	RMNET_SHS_SWITCH_PACKET_BURST,
 	RMNET_SHS_SWITCH_CORE_BACKLOG,
+	RMNET_SHS_SWITCH_PREDICTED_LOAD,
 	RMNET_SHS_SWITCH_MAX_REASON
 };
 
+enum rmnet_shs_predict_stats_e {
+	RMNET_SHS_PREDICT_PRIO_EARLY,
+	RMNET_SHS_PREDICT_FLOW_KEPT,
+	RMNET_SHS_PREDICT_NEW_FLOW_PERF,
+	RMNET_SHS_PREDICT_MAX_STATS
+};
+
 enum rmnet_shs_dl_ind_state {
 	RMNET_SHS_HDR_PENDING,
 	RMNET_SHS_END_PENDING,
@@ -32,6 +32,8 @@
 #define LPWR_CLUSTER 0
 #define PERF_CLUSTER 4
 #define DEF_CORE_WAIT 10
+/* 1/weight of each new sample goes into the EWMAs */
+#define RMNET_SHS_EWMA_WEIGHT 4
 
 #define PERF_CORES 4
 
@@ -151,6 +153,36 @@ unsigned int rmnet_shs_cpu_max_coresum[MAX_CPUS];
 module_param_array(rmnet_shs_cpu_max_coresum, uint, 0, 0644);
 MODULE_PARM_DESC(rmnet_shs_cpu_max_coresum, "Max coresum seen of each core");
 
+unsigned int rmnet_shs_predict_enable __read_mostly;
+module_param(rmnet_shs_predict_enable, uint, 0644);
+MODULE_PARM_DESC(rmnet_shs_predict_enable,
+		 "Enable EWMA based predictive core placement");
+
+unsigned int rmnet_shs_predict_thresh_pct __read_mostly = 80;
+module_param(rmnet_shs_predict_thresh_pct, uint, 0644);
+MODULE_PARM_DESC(rmnet_shs_predict_thresh_pct,
+		 "Predicted pct of inst rate max pkts that marks a core loaded");
+
+unsigned int rmnet_shs_predict_horizon __read_mostly = 2;
+module_param(rmnet_shs_predict_horizon, uint, 0644);
+MODULE_PARM_DESC(rmnet_shs_predict_horizon,
+		 "Rate intervals ahead the core load is predicted");
+
+unsigned int rmnet_shs_predict_flow_min_pkts __read_mostly = 100;
+module_param(rmnet_shs_predict_flow_min_pkts, uint, 0644);
+MODULE_PARM_DESC(rmnet_shs_predict_flow_min_pkts,
+		 "Min flow pkts per rate interval to move off a loaded core");
+
+unsigned int rmnet_shs_cpu_predicted_load[MAX_CPUS];
+module_param_array(rmnet_shs_cpu_predicted_load, uint, 0, 0444);
+MODULE_PARM_DESC(rmnet_shs_cpu_predicted_load,
+		 "Predicted pkts per rate interval of each core");
+
+unsigned long rmnet_shs_predict_stats[RMNET_SHS_PREDICT_MAX_STATS];
+module_param_array(rmnet_shs_predict_stats, ulong, 0, 0444);
+MODULE_PARM_DESC(rmnet_shs_predict_stats,
+		 "Early prio marks, flows kept, new flows sent to perf cores");
+
 static void rmnet_shs_change_cpu_num_flows(u16 map_cpu, bool inc)
 {
 	if (map_cpu < MAX_CPUS)
@@ -304,14 +336,77 @@ int rmnet_shs_is_skb_stamping_reqd(struct sk_buff *skb)
 	return ret_val;
 }
 
+static inline int rmnet_shs_rate_interval_ms(void)
+{
+	return (rmnet_shs_inst_rate_interval < MIN_MS) ? MIN_MS :
+		rmnet_shs_inst_rate_interval;
+}
+
+/* Fold the pkts seen over the last rate interval into the EWMA load and
+ * trend of a core, and refresh the predicted load. Samples taken over a
+ * longer window, e.g. after idle, are scaled down to one interval.
+ */
+static void rmnet_shs_predict_update_core(int cpu, int sum, long curinterval)
+{
+	struct core_flush_s *cf = &rmnet_shs_cfg.core_flush[cpu];
+	long maxinterval = (long)rmnet_shs_rate_interval_ms() * NS_IN_MS;
+	int sample = sum;
+	int prev = cf->ewma_load;
+	int predicted;
+
+	if (curinterval > maxinterval)
+		sample = (int)div64_s64((s64)sum * maxinterval, curinterval);
+
+	cf->ewma_load += (sample - cf->ewma_load) / RMNET_SHS_EWMA_WEIGHT;
+	cf->ewma_trend += ((cf->ewma_load - prev) - cf->ewma_trend) /
+			  RMNET_SHS_EWMA_WEIGHT;
+
+	predicted = cf->ewma_load +
+		    cf->ewma_trend * (int)rmnet_shs_predict_horizon;
+	rmnet_shs_cpu_predicted_load[cpu] = max(predicted, 0);
+}
+
+/* Fold the pkts flushed for a flow into its EWMA rate once a full rate
+ * interval has passed since the last sample.
+ */
+static void rmnet_shs_predict_update_flow(struct rmnet_shs_skbn_s *node,
+					  u32 pkts, u64 now)
+{
+	u64 maxinterval = (u64)rmnet_shs_rate_interval_ms() * NS_IN_MS;
+	u64 elapsed = now - node->ewma_ts;
+	int sample;
+
+	node->ewma_pkts += pkts;
+	if (elapsed < maxinterval)
+		return;
+
+	sample = (int)div64_u64((u64)node->ewma_pkts * maxinterval, elapsed);
+	node->ewma_rate = (int)node->ewma_rate +
+			  (sample - (int)node->ewma_rate) /
+			  RMNET_SHS_EWMA_WEIGHT;
+	node->ewma_pkts = 0;
+	node->ewma_ts = now;
+}
+
+/* Check if the predicted load of a core crosses the early switch
+ * threshold.
+ */
+static int rmnet_shs_predict_core_loaded(int cpu)
+{
+	u64 thresh = (u64)rmnet_shs_inst_rate_max_pkts *
+		     rmnet_shs_predict_thresh_pct / 100;
+
+	return rmnet_shs_predict_enable &&
+	       rmnet_shs_cpu_predicted_load[cpu] >= thresh;
+}
+
 static void rmnet_shs_update_core_load(int cpu, int burst)
 {
 
 	struct  timespec time1;
 	struct  timespec *time2;
 	long curinterval;
-	int maxinterval = (rmnet_shs_inst_rate_interval < MIN_MS) ? MIN_MS :
-			   rmnet_shs_inst_rate_interval;
+	int maxinterval = rmnet_shs_rate_interval_ms();
 
 	getnstimeofday(&time1);
 	time2 = &rmnet_shs_cfg.core_flush[cpu].coretime;
@@ -324,6 +419,10 @@ static void rmnet_shs_update_core_load(int cpu, int burst)
 			rmnet_shs_cpu_max_coresum[cpu])
 			rmnet_shs_cpu_max_coresum[cpu] = rmnet_shs_cfg.core_flush[cpu].coresum;
 
+		rmnet_shs_predict_update_core(cpu,
+				rmnet_shs_cfg.core_flush[cpu].coresum,
+				curinterval);
+
 		rmnet_shs_cfg.core_flush[cpu].coretime.tv_sec = time1.tv_sec;
 		rmnet_shs_cfg.core_flush[cpu].coretime.tv_nsec = time1.tv_nsec;
 		rmnet_shs_cfg.core_flush[cpu].coresum = burst;
@@ -671,9 +770,23 @@ int rmnet_shs_idx_from_cpu(u8 cpu, u8 mask)
 int rmnet_shs_new_flow_cpu(u64 burst_size, struct net_device *dev)
 {
 	int flow_cpu = INVALID_CPU;
+	int perf_cpu;
 
 	if (burst_size < RMNET_SHS_MAX_SILVER_CORE_BURST_CAPACITY)
 		flow_cpu = rmnet_shs_wq_get_lpwr_cpu_new_flow(dev);
+
+	/* Don't add to a low power core we expect to saturate shortly, the
+	 * flow would only have to be moved again.
+	 */
+	if (flow_cpu >= 0 && rmnet_shs_predict_core_loaded(flow_cpu)) {
+		perf_cpu = rmnet_shs_wq_get_perf_cpu_new_flow(dev);
+		if (perf_cpu >= 0) {
+			flow_cpu = perf_cpu;
+			rmnet_shs_predict_stats[
+				RMNET_SHS_PREDICT_NEW_FLOW_PERF]++;
+		}
+	}
+
 	if (flow_cpu == INVALID_CPU ||
 	    burst_size >= RMNET_SHS_MAX_SILVER_CORE_BURST_CAPACITY)
 		flow_cpu = rmnet_shs_wq_get_perf_cpu_new_flow(dev);
@@ -692,6 +805,15 @@ int rmnet_shs_get_suggested_cpu(struct rmnet_shs_skbn_s *node)
 	/* Return same perf core unless moving to gold from silver*/
 	if (rmnet_shs_cpu_node_tbl[node->map_cpu].prio &&
 	    rmnet_shs_is_lpwr_cpu(node->map_cpu)) {
+		/* In predictive mode only the flows carrying the load leave
+		 * the core. Light flows stay put and never risk reordering.
+		 */
+		if (rmnet_shs_predict_enable &&
+		    node->ewma_rate < rmnet_shs_predict_flow_min_pkts) {
+			rmnet_shs_predict_stats[RMNET_SHS_PREDICT_FLOW_KEPT]++;
+			return node->map_cpu;
+		}
+
 		cpu = rmnet_shs_get_core_prio_flow(PERF_MASK &
 						   rmnet_shs_cfg.map_mask);
 		if (cpu < 0 && node->hstats != NULL)
@@ -770,6 +892,9 @@ static int rmnet_shs_is_core_loaded(int cpu, int backlog_check, int parked_pkts)
 	    rmnet_shs_backlog_max_pkts))
 		ret = RMNET_SHS_SWITCH_CORE_BACKLOG;
 
+	if (!ret && rmnet_shs_predict_core_loaded(cpu))
+		ret = RMNET_SHS_SWITCH_PREDICTED_LOAD;
+
 	return ret;
 }
 
@@ -979,6 +1104,12 @@ void rmnet_shs_flush_core(u8 cpu_num)
 	rmnet_shs_cpu_node_tbl[cpu_num].prio = 0;
 	/* Reset coresum in case of instant rate switch */
 	rmnet_shs_cfg.core_flush[cpu_num].coresum = 0;
+	/* The flows that loaded the core have moved, so the prediction no
+	 * longer holds. Start over rather than flag the core again.
+	 */
+	rmnet_shs_cfg.core_flush[cpu_num].ewma_load = 0;
+	rmnet_shs_cfg.core_flush[cpu_num].ewma_trend = 0;
+	rmnet_shs_cpu_predicted_load[cpu_num] = 0;
 	rmnet_shs_cpu_node_tbl[cpu_num].parkedlen = 0;
 	spin_unlock_irqrestore(&rmnet_shs_ht_splock, ht_flags);
 	local_bh_enable();
@@ -1175,6 +1306,14 @@ static void rmnet_shs_core_prio_check(u8 cpu_num, u8 segmented, u32 parked_pkts)
 
 
 		wait = (!segmented)? DEF_CORE_WAIT: wait;
+		/* Flagged ahead of saturation, so give the flows the full
+		 * wait to drain from the old core before being forced over.
+		 */
+		if (load_reason == RMNET_SHS_SWITCH_PREDICTED_LOAD) {
+			wait = (!rmnet_shs_max_core_wait) ? 1 :
+				rmnet_shs_max_core_wait;
+			rmnet_shs_predict_stats[RMNET_SHS_PREDICT_PRIO_EARLY]++;
+		}
 		rmnet_shs_cpu_node_tbl[cpu_num].prio = 1;
 		rmnet_shs_boost_cpus();
 		if (hrtimer_active(&GET_CTIMER(cpu_num)))
@@ -1214,6 +1353,7 @@ void rmnet_shs_flush_lock_table(u8 flsh, u8 ctxt)
 	u32 total_cpu_gro_flushed = 0;
 	u32 total_node_gro_flushed = 0;
 	u8 is_flushed = 0;
+	u64 now = (rmnet_shs_predict_enable) ? ktime_get_ns() : 0;
 
 	/* Record a qtail + pkts flushed or move if reqd
 	 * currently only use qtail for non TCP flows
@@ -1253,6 +1393,9 @@ void rmnet_shs_flush_lock_table(u8 flsh, u8 ctxt)
 									  ctxt);
 
 				if (is_flushed) {
+					if (rmnet_shs_predict_enable)
+						rmnet_shs_predict_update_flow(n,
+							num_pkts_flush, now);
 					total_cpu_gro_flushed += total_node_gro_flushed;
 					total_pkts_flush += num_pkts_flush;
 					total_bytes_flush += num_bytes_flush;
@@ -1838,6 +1981,7 @@ void rmnet_shs_assign(struct sk_buff *skb, struct rmnet_port *port)
 		node_p->dev = skb->dev;
 		node_p->hash = skb->hash;
 		node_p->map_cpu = new_cpu;
+		node_p->ewma_ts = ktime_get_ns();
 		node_p->map_index = rmnet_shs_idx_from_cpu(node_p->map_cpu,
 							   map);
 		INIT_LIST_HEAD(&node_p->node_id);
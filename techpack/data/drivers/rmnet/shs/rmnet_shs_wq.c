@@ -1473,6 +1473,7 @@ void rmnet_shs_wq_eval_cpus_caps_and_flows(struct list_head *cpu_caps,
 	rmnet_shs_wq_mem_update_cached_sorted_gold_flows(gold_flows);
 	rmnet_shs_wq_mem_update_cached_sorted_ss_flows(ss_flows);
 	rmnet_shs_wq_mem_update_cached_netdevs();
+	rmnet_shs_wq_mem_update_ring();
 
 	rmnet_shs_genl_send_int_to_userspace_no_info(RMNET_SHS_SYNC_RESP_INT);
 
@@ -2039,6 +2040,9 @@ void rmnet_shs_wq_process_wq(struct work_struct *work)
 				RMNET_SHS_WQ_PROCESS_WQ_START,
 				0xDEF, 0xDEF, 0xDEF, 0xDEF, NULL, NULL);
 
+	/* Hints take the ep lock themselves, apply them before the update */
+	rmnet_shs_wq_mem_apply_ring_hints();
+
 	spin_lock_irqsave(&rmnet_shs_ep_lock, flags);
 	rmnet_shs_wq_update_stats();
 	spin_unlock_irqrestore(&rmnet_shs_ep_lock, flags);
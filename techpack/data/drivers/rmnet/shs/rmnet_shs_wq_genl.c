@@ -136,9 +136,15 @@ int rmnet_shs_genl_send_int_to_userspace_no_info(int val)
 	/* TODO: Need to free skb?? */
 	rm_err("SHS_GNL: FAILED to send int %d\n", val);
 	rmnet_shs_userspace_connected = 0;
+	last_net = NULL;
 	return -1;
 }
 
+/* True while a netlink client that sent a mem sync is believed to be alive */
+bool rmnet_shs_genl_client_connected(void)
+{
+	return last_net != NULL;
+}
 
 int rmnet_shs_genl_send_msg_to_userspace(void)
 {
@@ -356,5 +362,6 @@ int rmnet_shs_wq_genl_deinit(void)
 		rm_err("SHS_GNL: unregister family failed: %i\n",ret);
 	}
 	rmnet_shs_userspace_connected = 0;
+	last_net = NULL;
 	return 0;
 }
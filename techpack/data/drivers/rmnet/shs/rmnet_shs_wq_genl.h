@@ -70,6 +70,8 @@ int rmnet_shs_genl_send_int_to_userspace_no_info(int val);
 
 int rmnet_shs_genl_send_msg_to_userspace(void);
 
+bool rmnet_shs_genl_client_connected(void);
+
 int rmnet_shs_wq_genl_init(void);
 
 int rmnet_shs_wq_genl_deinit(void);
@@ -14,6 +14,7 @@
  */
 
 #include "rmnet_shs_wq_mem.h"
+#include "rmnet_shs_wq_genl.h"
 #include <linux/proc_fs.h>
 #include <linux/refcount.h>
 
@@ -35,6 +36,17 @@ struct rmnet_shs_mmap_info *cap_shared;
 struct rmnet_shs_mmap_info *gflow_shared;
 struct rmnet_shs_mmap_info *ssflow_shared;
 struct rmnet_shs_mmap_info *netdev_shared;
+struct rmnet_shs_ring_info *ring_shared;
+
+/* Number of valid entries in each cached array above */
+static u16 rmnet_shs_wq_num_caps;
+static u16 rmnet_shs_wq_num_gflows;
+static u16 rmnet_shs_wq_num_ssflows;
+static u16 rmnet_shs_wq_num_netdevs;
+
+unsigned long long rmnet_shs_ring_stats[RMNET_SHS_RING_STATS_MAX];
+module_param_array(rmnet_shs_ring_stats, ullong, 0, 0444);
+MODULE_PARM_DESC(rmnet_shs_ring_stats, "Snapshot ring publish and hint counters");
 
 /* Static Functions and Definitions */
 static void rmnet_shs_vm_open(struct vm_area_struct *vma)
@@ -210,6 +222,57 @@ static int rmnet_shs_mmap_netdev(struct file *filp, struct vm_area_struct *vma)
 	return 0;
 }
 
+static int rmnet_shs_vm_fault_ring(struct vm_fault *vmf)
+{
+	struct page *page = NULL;
+	struct rmnet_shs_ring_info *info;
+
+	if (vmf->pgoff >= RMNET_SHS_RING_NR_PAGES)
+		return VM_FAULT_SIGBUS;
+
+	rmnet_shs_wq_ep_lock_bh();
+	if (ring_shared) {
+		info = (struct rmnet_shs_ring_info *) vmf->vma->vm_private_data;
+		page = virt_to_page(info->pages[vmf->pgoff]);
+		get_page(page);
+		vmf->page = page;
+	} else {
+		rmnet_shs_wq_ep_unlock_bh();
+		return VM_FAULT_SIGSEGV;
+	}
+	rmnet_shs_wq_ep_unlock_bh();
+
+	return 0;
+}
+
+static const struct vm_operations_struct rmnet_shs_vm_ops_ring = {
+	.close = rmnet_shs_vm_close,
+	.open = rmnet_shs_vm_open,
+	.fault = rmnet_shs_vm_fault_ring,
+};
+
+static int rmnet_shs_mmap_ring(struct file *filp, struct vm_area_struct *vma)
+{
+	if (vma->vm_pgoff + vma_pages(vma) > RMNET_SHS_RING_NR_PAGES)
+		return -EINVAL;
+
+	vma->vm_ops = &rmnet_shs_vm_ops_ring;
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_private_data = filp->private_data;
+
+	return 0;
+}
+
+static void rmnet_shs_ring_free(struct rmnet_shs_ring_info *info)
+{
+	int i;
+
+	for (i = 0; i < RMNET_SHS_RING_NR_PAGES; i++)
+		if (info->pages[i])
+			free_page((unsigned long)info->pages[i]);
+	kfree(info);
+}
+
 static int rmnet_shs_open_caps(struct inode *inode, struct file *filp)
 {
 	struct rmnet_shs_mmap_info *info;
@@ -363,6 +426,60 @@ static int rmnet_shs_open_netdev(struct inode *inode, struct file *filp)
 	return -ENOMEM;
 }
 
+static int rmnet_shs_open_ring(struct inode *inode, struct file *filp)
+{
+	struct rmnet_shs_ring_hdr_usr_s *hdr;
+	struct rmnet_shs_ring_hints_usr_s *hints;
+	struct rmnet_shs_ring_info *info;
+	int i;
+
+	rm_err("%s", "SHS_MEM: rmnet_shs_open ring - entry\n");
+
+	rmnet_shs_wq_ep_lock_bh();
+	if (!ring_shared) {
+		info = kzalloc(sizeof(struct rmnet_shs_ring_info), GFP_ATOMIC);
+		if (!info)
+			goto fail;
+
+		for (i = 0; i < RMNET_SHS_RING_NR_PAGES; i++) {
+			info->pages[i] = (char *)get_zeroed_page(GFP_ATOMIC);
+			if (!info->pages[i]) {
+				rmnet_shs_ring_free(info);
+				goto fail;
+			}
+		}
+
+		hdr = (struct rmnet_shs_ring_hdr_usr_s *)
+		      info->pages[RMNET_SHS_RING_PG_HDR];
+		hdr->magic = RMNET_SHS_RING_MAGIC;
+		hdr->version = RMNET_SHS_RING_VERSION;
+		hdr->hdr_len = sizeof(*hdr);
+
+		hints = (struct rmnet_shs_ring_hints_usr_s *)
+			info->pages[RMNET_SHS_RING_PG_HINTS];
+		hints->size = RMNET_SHS_RING_MAX_HINTS;
+
+		ring_shared = info;
+		refcount_set(&ring_shared->refcnt, 1);
+	} else {
+		refcount_inc(&ring_shared->refcnt);
+	}
+
+	filp->private_data = ring_shared;
+
+	/* A mapped ring replaces the netlink sync as the connect signal */
+	if (!rmnet_shs_userspace_connected)
+		rmnet_shs_userspace_connected = 1;
+	rmnet_shs_wq_ep_unlock_bh();
+
+	return 0;
+
+fail:
+	rmnet_shs_wq_ep_unlock_bh();
+	rm_err("%s", "SHS_MEM: rmnet_shs_open ring - FAILED\n");
+	return -ENOMEM;
+}
+
 static ssize_t rmnet_shs_read(struct file *filp, char __user *buf, size_t len, loff_t *off)
 {
 	/*
@@ -473,6 +590,34 @@ static int rmnet_shs_release_netdev(struct inode *inode, struct file *filp)
 	return 0;
 }
 
+static int rmnet_shs_release_ring(struct inode *inode, struct file *filp)
+{
+	struct rmnet_shs_ring_info *info;
+
+	rm_err("%s", "SHS_MEM: rmnet_shs_release ring - entry\n");
+
+	rmnet_shs_wq_ep_lock_bh();
+	if (ring_shared) {
+		info = filp->private_data;
+		if (refcount_read(&info->refcnt) <= 1) {
+			rmnet_shs_ring_free(info);
+			ring_shared = NULL;
+			filp->private_data = NULL;
+
+			/* Last ring user is gone, fall back to the default
+			 * wq logic unless netlink still has a client
+			 */
+			if (!rmnet_shs_genl_client_connected())
+				rmnet_shs_userspace_connected = 0;
+		} else {
+			refcount_dec(&info->refcnt);
+		}
+	}
+	rmnet_shs_wq_ep_unlock_bh();
+
+	return 0;
+}
+
 static const struct file_operations rmnet_shs_caps_fops = {
 	.owner   = THIS_MODULE,
 	.mmap    = rmnet_shs_mmap_caps,
@@ -509,6 +654,15 @@ static const struct file_operations rmnet_shs_netdev_fops = {
 	.write   = rmnet_shs_write,
 };
 
+static const struct file_operations rmnet_shs_ring_fops = {
+	.owner   = THIS_MODULE,
+	.mmap    = rmnet_shs_mmap_ring,
+	.open    = rmnet_shs_open_ring,
+	.release = rmnet_shs_release_ring,
+	.read    = rmnet_shs_read,
+	.write   = rmnet_shs_write,
+};
+
 /* Global Functions */
 /* Add a flow to the slow start flow list */
 void rmnet_shs_wq_ssflow_list_add(struct rmnet_shs_wq_hstat_s *hnode,
@@ -723,6 +877,7 @@ void rmnet_shs_wq_mem_update_cached_cpu_caps(struct list_head *cpu_caps)
 		rmnet_shs_wq_cap_list_usr[idx].cpu_num = cap_node->cpu_num;
 		idx += 1;
 	}
+	rmnet_shs_wq_num_caps = idx;
 
 	rm_err("SHS_MEM: cap_dma_ptr = 0x%llx addr = 0x%pK\n",
 	       (unsigned long long)virt_to_phys((void *)cap_shared), cap_shared);
@@ -781,6 +936,7 @@ void rmnet_shs_wq_mem_update_cached_sorted_gold_flows(struct list_head *gold_flo
 		rmnet_shs_wq_gflows_usr[idx].rx_pps = gflow_node->rx_pps;
 		idx += 1;
 	}
+	rmnet_shs_wq_num_gflows = idx;
 
 	rm_err("SHS_MEM: gflow_dma_ptr = 0x%llx addr = 0x%pK\n",
 	       (unsigned long long)virt_to_phys((void *)gflow_shared),
@@ -848,6 +1004,7 @@ void rmnet_shs_wq_mem_update_cached_sorted_ss_flows(struct list_head *ss_flows)
 		rmnet_shs_wq_ssflows_usr[idx].rx_bps = ssflow_node->rx_bps;
 		idx += 1;
 	}
+	rmnet_shs_wq_num_ssflows = idx;
 
 	rm_err("SHS_MEM: ssflow_dma_ptr = 0x%llx addr = 0x%pK\n",
 	       (unsigned long long)virt_to_phys((void *)ssflow_shared),
@@ -938,6 +1095,7 @@ void rmnet_shs_wq_mem_update_cached_netdevs(void)
 		rmnet_shs_wq_netdev_usr[idx].udp_rx_bps = ep->udp_rx_bps;
 		idx += 1;
 	}
+	rmnet_shs_wq_num_netdevs = idx;
 
 	rm_err("SHS_MEM: netdev_shared = 0x%llx addr = 0x%pK\n",
 	       (unsigned long long)virt_to_phys((void *)netdev_shared), netdev_shared);
@@ -952,6 +1110,137 @@ void rmnet_shs_wq_mem_update_cached_netdevs(void)
 	       sizeof(rmnet_shs_wq_netdev_usr));
 }
 
+/* Publish the cached arrays into the snapshot ring. Must be called after the
+ * update_cached functions with the ep lock held. The sequence count is odd
+ * while the snapshot is being written so readers can detect torn copies.
+ */
+void rmnet_shs_wq_mem_update_ring(void)
+{
+	struct rmnet_shs_ring_hdr_usr_s *hdr;
+	struct rmnet_shs_ring_hints_usr_s *hints;
+
+	if (!ring_shared)
+		return;
+
+	hdr = (struct rmnet_shs_ring_hdr_usr_s *)
+	      ring_shared->pages[RMNET_SHS_RING_PG_HDR];
+	hints = (struct rmnet_shs_ring_hints_usr_s *)
+		ring_shared->pages[RMNET_SHS_RING_PG_HINTS];
+
+	WRITE_ONCE(hdr->seq, ++ring_shared->seq);
+	smp_wmb();
+
+	hdr->tick = (u32)rmnet_shs_ring_stats[RMNET_SHS_RING_PUBLISH];
+	hdr->tstamp_ns = ktime_get_ns();
+	hdr->num_caps = rmnet_shs_wq_num_caps;
+	hdr->num_gflows = rmnet_shs_wq_num_gflows;
+	hdr->num_ssflows = rmnet_shs_wq_num_ssflows;
+	hdr->num_netdevs = rmnet_shs_wq_num_netdevs;
+	hdr->num_hints = (u32)(rmnet_shs_ring_stats[RMNET_SHS_RING_HINT_MOVE_PASS] +
+			       rmnet_shs_ring_stats[RMNET_SHS_RING_HINT_SEG_PASS]);
+
+	memcpy((char *)hdr + sizeof(*hdr),
+	       (void *) &rmnet_shs_wq_cap_list_usr[0],
+	       sizeof(rmnet_shs_wq_cap_list_usr));
+	memcpy(ring_shared->pages[RMNET_SHS_RING_PG_G_FLOWS],
+	       (void *) &rmnet_shs_wq_gflows_usr[0],
+	       sizeof(rmnet_shs_wq_gflows_usr));
+	memcpy(ring_shared->pages[RMNET_SHS_RING_PG_SS_FLOWS],
+	       (void *) &rmnet_shs_wq_ssflows_usr[0],
+	       sizeof(rmnet_shs_wq_ssflows_usr));
+	memcpy(ring_shared->pages[RMNET_SHS_RING_PG_NETDEV],
+	       (void *) &rmnet_shs_wq_netdev_usr[0],
+	       sizeof(rmnet_shs_wq_netdev_usr));
+
+	/* Userspace may scribble on the fields we own, restore them */
+	hdr->magic = RMNET_SHS_RING_MAGIC;
+	hdr->version = RMNET_SHS_RING_VERSION;
+	hdr->hdr_len = sizeof(*hdr);
+	hints->size = RMNET_SHS_RING_MAX_HINTS;
+
+	smp_wmb();
+	WRITE_ONCE(hdr->seq, ++ring_shared->seq);
+
+	rmnet_shs_ring_stats[RMNET_SHS_RING_PUBLISH]++;
+}
+
+/* Pull up to RMNET_SHS_RING_HINT_BUDGET hints that userspace has produced
+ * into the hint page. The kernel keeps its own copy of the tail so a
+ * misbehaving daemon can only lose its own hints.
+ */
+static int rmnet_shs_wq_mem_get_ring_hints(struct rmnet_shs_ring_hint_usr_s *buf)
+{
+	struct rmnet_shs_ring_hints_usr_s *hints;
+	u32 head, tail;
+	int cnt = 0;
+
+	rmnet_shs_wq_ep_lock_bh();
+	if (!ring_shared)
+		goto out;
+
+	hints = (struct rmnet_shs_ring_hints_usr_s *)
+		ring_shared->pages[RMNET_SHS_RING_PG_HINTS];
+	head = smp_load_acquire(&hints->head);
+	tail = ring_shared->hint_tail;
+
+	if (head - tail > RMNET_SHS_RING_MAX_HINTS) {
+		rmnet_shs_ring_stats[RMNET_SHS_RING_HINT_OVERRUN]++;
+		tail = head;
+	}
+
+	while (tail != head && cnt < RMNET_SHS_RING_HINT_BUDGET) {
+		memcpy(&buf[cnt++],
+		       &hints->hint[tail & (RMNET_SHS_RING_MAX_HINTS - 1)],
+		       sizeof(*buf));
+		tail++;
+	}
+
+	ring_shared->hint_tail = tail;
+	smp_store_release(&hints->tail, tail);
+out:
+	rmnet_shs_wq_ep_unlock_bh();
+	return cnt;
+}
+
+/* Apply placement hints from the snapshot ring the same way the netlink
+ * try_to_move_flow and set_flow_segmentation commands do. Must be called
+ * without the ep lock held.
+ */
+void rmnet_shs_wq_mem_apply_ring_hints(void)
+{
+	struct rmnet_shs_ring_hint_usr_s buf[RMNET_SHS_RING_HINT_BUDGET];
+	struct rmnet_shs_ring_hint_usr_s *hint;
+	int cnt, i;
+
+	cnt = rmnet_shs_wq_mem_get_ring_hints(buf);
+
+	for (i = 0; i < cnt; i++) {
+		hint = &buf[i];
+
+		switch (hint->type) {
+		case RMNET_SHS_RING_HINT_MOVE_FLOW:
+			if (rmnet_shs_wq_try_to_move_flow(hint->cur_cpu,
+							  hint->dest_cpu,
+							  hint->hash,
+							  hint->arg))
+				rmnet_shs_ring_stats[RMNET_SHS_RING_HINT_MOVE_PASS]++;
+			else
+				rmnet_shs_ring_stats[RMNET_SHS_RING_HINT_MOVE_FAIL]++;
+			break;
+		case RMNET_SHS_RING_HINT_SET_SEG:
+			if (rmnet_shs_wq_set_flow_segmentation(hint->hash,
+							       hint->arg))
+				rmnet_shs_ring_stats[RMNET_SHS_RING_HINT_SEG_PASS]++;
+			else
+				rmnet_shs_ring_stats[RMNET_SHS_RING_HINT_SEG_FAIL]++;
+			break;
+		default:
+			rmnet_shs_ring_stats[RMNET_SHS_RING_HINT_INVALID]++;
+			break;
+		}
+	}
+}
+
 /* Creates the proc folder and files for shs shared memory */
 int rmnet_shs_wq_mem_init(void)
 {
@@ -976,12 +1265,14 @@ int rmnet_shs_wq_mem_init(void)
 	proc_create(RMNET_SHS_PROC_G_FLOWS, 0644, shs_proc_dir, &rmnet_shs_g_flows_fops);
 	proc_create(RMNET_SHS_PROC_SS_FLOWS, 0644, shs_proc_dir, &rmnet_shs_ss_flows_fops);
 	proc_create(RMNET_SHS_PROC_NETDEV, 0644, shs_proc_dir, &rmnet_shs_netdev_fops);
+	proc_create(RMNET_SHS_PROC_RING, 0644, shs_proc_dir, &rmnet_shs_ring_fops);
 
 	rmnet_shs_wq_ep_lock_bh();
 	cap_shared = NULL;
 	gflow_shared = NULL;
 	ssflow_shared = NULL;
 	netdev_shared = NULL;
+	ring_shared = NULL;
 	rmnet_shs_wq_ep_unlock_bh();
 	return 0;
 }
@@ -993,6 +1284,7 @@ void rmnet_shs_wq_mem_deinit(void)
 	remove_proc_entry(RMNET_SHS_PROC_G_FLOWS, shs_proc_dir);
 	remove_proc_entry(RMNET_SHS_PROC_SS_FLOWS, shs_proc_dir);
 	remove_proc_entry(RMNET_SHS_PROC_NETDEV, shs_proc_dir);
+	remove_proc_entry(RMNET_SHS_PROC_RING, shs_proc_dir);
 	remove_proc_entry(RMNET_SHS_PROC_DIR, NULL);
 
 	rmnet_shs_wq_ep_lock_bh();
@@ -1000,5 +1292,6 @@ void rmnet_shs_wq_mem_deinit(void)
 	gflow_shared = NULL;
 	ssflow_shared = NULL;
 	netdev_shared = NULL;
+	ring_shared = NULL;
 	rmnet_shs_wq_ep_unlock_bh();
 }
@@ -24,6 +24,7 @@
 #define RMNET_SHS_PROC_G_FLOWS  "rmnet_shs_flows"
 #define RMNET_SHS_PROC_SS_FLOWS "rmnet_shs_ss_flows"
 #define RMNET_SHS_PROC_NETDEV   "rmnet_shs_netdev"
+#define RMNET_SHS_PROC_RING     "rmnet_shs_ring"
 
 #define RMNET_SHS_MAX_USRFLOWS (128)
 #define RMNET_SHS_MAX_NETDEVS (40)
@@ -72,6 +73,83 @@ struct __attribute__((__packed__)) rmnet_shs_wq_netdev_usr_s {
 	u8   mux_id;
 };
 
+/* Snapshot ring shared with shsusrd. Unlike the single page files above,
+ * the whole snapshot is published under a sequence count so userspace can
+ * read it at any rate without a netlink sync:
+ *    page 0: | hdr | cap_0 | ... | cap_7 |
+ *    page 1: | gflow_0 | ... | gflow_127 |
+ *    page 2: | ssflow_0 | ... | ssflow_127 |
+ *    page 3: | netdev_0 | ... | netdev_39 |
+ *    page 4: | hints hdr | hint_0 | ... | hint_127 |
+ * Readers retry while seq is odd or changed across the copy. Hints are
+ * produced by userspace at head and consumed by the wq at tail.
+ */
+#define RMNET_SHS_RING_MAGIC       (0x52534853) /* "SHSR" */
+#define RMNET_SHS_RING_VERSION     (1)
+#define RMNET_SHS_RING_MAX_HINTS   (128) /* Must be a power of 2 */
+#define RMNET_SHS_RING_HINT_BUDGET (32)  /* Hints applied per wq tick */
+
+enum rmnet_shs_ring_page_e {
+	RMNET_SHS_RING_PG_HDR,
+	RMNET_SHS_RING_PG_G_FLOWS,
+	RMNET_SHS_RING_PG_SS_FLOWS,
+	RMNET_SHS_RING_PG_NETDEV,
+	RMNET_SHS_RING_PG_HINTS,
+	RMNET_SHS_RING_NR_PAGES
+};
+
+/* 40 bytes, cpu caps start right after the header */
+struct rmnet_shs_ring_hdr_usr_s {
+	u32 magic;
+	u16 version;
+	u16 hdr_len;
+	u32 seq;
+	u32 tick;
+	u64 tstamp_ns;
+	u16 num_caps;
+	u16 num_gflows;
+	u16 num_ssflows;
+	u16 num_netdevs;
+	u32 num_hints; /* hints applied since module load */
+	u32 reserved;
+};
+
+enum rmnet_shs_ring_hint_type_e {
+	RMNET_SHS_RING_HINT_NONE,
+	RMNET_SHS_RING_HINT_MOVE_FLOW,
+	RMNET_SHS_RING_HINT_SET_SEG,
+	RMNET_SHS_RING_HINT_MAX
+};
+
+/* arg is the sugg_type for moves and segs_per_skb for segmentation */
+struct rmnet_shs_ring_hint_usr_s {
+	u32 type;
+	u32 hash;
+	u32 arg;
+	u16 cur_cpu;
+	u16 dest_cpu;
+};
+
+/* 16 + 16 * 128 = 2064 bytes < 4096 */
+struct rmnet_shs_ring_hints_usr_s {
+	u32 head;
+	u32 tail;
+	u32 size;
+	u32 reserved;
+	struct rmnet_shs_ring_hint_usr_s hint[RMNET_SHS_RING_MAX_HINTS];
+};
+
+enum rmnet_shs_ring_stats_e {
+	RMNET_SHS_RING_PUBLISH,
+	RMNET_SHS_RING_HINT_MOVE_PASS,
+	RMNET_SHS_RING_HINT_MOVE_FAIL,
+	RMNET_SHS_RING_HINT_SEG_PASS,
+	RMNET_SHS_RING_HINT_SEG_FAIL,
+	RMNET_SHS_RING_HINT_INVALID,
+	RMNET_SHS_RING_HINT_OVERRUN,
+	RMNET_SHS_RING_STATS_MAX
+};
+
 extern struct list_head gflows;
 extern struct list_head ssflows;
 extern struct list_head cpu_caps;
@@ -84,6 +162,13 @@ struct rmnet_shs_mmap_info {
 	refcount_t refcnt;
 };
 
+struct rmnet_shs_ring_info {
+	char *pages[RMNET_SHS_RING_NR_PAGES];
+	refcount_t refcnt;
+	u32 seq;
+	u32 hint_tail;
+};
+
 /* Function Definitions */
 
 void rmnet_shs_wq_ssflow_list_add(struct rmnet_shs_wq_hstat_s *hnode,
@@ -106,6 +191,8 @@ void rmnet_shs_wq_mem_update_cached_cpu_caps(struct list_head *cpu_caps);
 void rmnet_shs_wq_mem_update_cached_sorted_gold_flows(struct list_head *gold_flows);
 void rmnet_shs_wq_mem_update_cached_sorted_ss_flows(struct list_head *ss_flows);
 void rmnet_shs_wq_mem_update_cached_netdevs(void);
+void rmnet_shs_wq_mem_update_ring(void);
+void rmnet_shs_wq_mem_apply_ring_hints(void);
 
 int rmnet_shs_wq_mem_init(void);
 
@@ -26,6 +26,9 @@
 #define SDE_PERF_MODE_STRING_SIZE	128
 #define SDE_PERF_THRESHOLD_HIGH_MIN     12800000
 
+/* refresh rate assumed for the vote hysteresis if the mode has none */
+#define SDE_PERF_DEFAULT_FPS		60
+
 #define GET_H32(val) (val >> 32)
 #define GET_L32(val) (val & 0xffffffff)
 
@@ -252,6 +255,60 @@ static void _sde_core_perf_calc_crtc(struct sde_kms *kms,
 			perf->bw_ctl[SDE_POWER_HANDLE_DBUS_ID_EBI]);
 }
 
+static const u32 sde_perf_key_props[SDE_PERF_KEY_PROP_COUNT] = {
+	CRTC_PROP_CORE_AB,
+	CRTC_PROP_CORE_IB,
+	CRTC_PROP_LLCC_AB,
+	CRTC_PROP_LLCC_IB,
+	CRTC_PROP_DRAM_AB,
+	CRTC_PROP_DRAM_IB,
+	CRTC_PROP_CORE_CLK,
+};
+
+/*
+ * Reuse the previous performance computation of the crtc if none of its
+ * inputs changed. Only the normal mode with bandwidth control is cached,
+ * the other modes depend on tunables rather than on the crtc state.
+ */
+static void _sde_core_perf_calc_crtc_cached(struct sde_kms *kms,
+		struct drm_crtc *crtc,
+		struct drm_crtc_state *state,
+		struct sde_core_perf_params *perf)
+{
+	struct sde_crtc_state *sde_cstate = to_sde_crtc_state(state);
+	struct sde_core_perf_cache *cache = &to_sde_crtc(crtc)->perf_cache;
+	struct sde_core_perf_key key;
+	int i;
+
+	if (!sde_cstate->bw_control ||
+			kms->perf.perf_tune.mode != SDE_PERF_MODE_NORMAL) {
+		cache->valid = false;
+		_sde_core_perf_calc_crtc(kms, crtc, state, perf);
+		return;
+	}
+
+	memset(&key, 0, sizeof(key));
+	for (i = 0; i < SDE_PERF_KEY_PROP_COUNT; i++)
+		key.props[i] = sde_crtc_get_property(sde_cstate,
+				sde_perf_key_props[i]);
+	key.plane_mask = state->plane_mask;
+	key.bw_split_vote = sde_cstate->bw_split_vote;
+
+	if (cache->valid && !memcmp(&key, &cache->key, sizeof(key))) {
+		memcpy(perf, &cache->perf, sizeof(*perf));
+		kms->perf.stats.calc_cache_hits++;
+		return;
+	}
+
+	_sde_core_perf_calc_crtc(kms, crtc, state, perf);
+	kms->perf.stats.calc_cache_misses++;
+
+	/* doze suspend carries over the previous votes, don't cache them */
+	cache->valid = key.props[0] || key.props[1] || !key.plane_mask;
+	memcpy(&cache->key, &key, sizeof(key));
+	memcpy(&cache->perf, perf, sizeof(*perf));
+}
+
 int sde_core_perf_crtc_check(struct drm_crtc *crtc,
 		struct drm_crtc_state *state)
 {
@@ -277,7 +334,8 @@ int sde_core_perf_crtc_check(struct drm_crtc *crtc,
 	sde_cstate = to_sde_crtc_state(state);
 
 	/* obtain new values */
-	_sde_core_perf_calc_crtc(kms, crtc, state, &sde_cstate->new_perf);
+	_sde_core_perf_calc_crtc_cached(kms, crtc, state,
+			&sde_cstate->new_perf);
 
 	for (i = SDE_POWER_HANDLE_DBUS_ID_MNOC;
 			i < SDE_POWER_HANDLE_DBUS_ID_MAX; i++) {
@@ -634,6 +692,43 @@ void sde_core_perf_crtc_update_uidle(struct drm_crtc *crtc,
 	mutex_unlock(&sde_core_perf_lock);
 }
 
+/*
+ * Returns true if the same quota was already voted on the bus through the
+ * same client, in which case the vote would only repeat the request.
+ */
+static bool _sde_core_perf_vote_is_cached(struct sde_core_perf *perf,
+		u32 bus_id, void *client, u64 ab_quota, u64 ib_quota)
+{
+	struct sde_core_perf_vote *vote = &perf->last_vote[bus_id];
+
+	if (vote->valid && vote->client == client &&
+			vote->ab == ab_quota && vote->ib == ib_quota) {
+		perf->stats.bus_votes_skipped++;
+		return true;
+	}
+
+	vote->valid = true;
+	vote->client = client;
+	vote->ab = ab_quota;
+	vote->ib = ib_quota;
+	perf->stats.bus_votes++;
+
+	return false;
+}
+
+void sde_core_perf_invalidate_votes(struct sde_core_perf *perf)
+{
+	int i;
+
+	if (!perf)
+		return;
+
+	mutex_lock(&sde_core_perf_lock);
+	for (i = 0; i < SDE_POWER_HANDLE_DBUS_ID_MAX; i++)
+		perf->last_vote[i].valid = false;
+	mutex_unlock(&sde_core_perf_lock);
+}
+
 static void _sde_core_perf_crtc_update_bus(struct sde_kms *kms,
 		struct drm_crtc *crtc, u32 bus_id)
 {
@@ -648,6 +743,7 @@ static void _sde_core_perf_crtc_update_bus(struct sde_kms *kms,
 
 	u64 tmp_max_per_pipe_ib;
 	u64 tmp_bw_ctl;
+	int rc;
 
 	drm_for_each_crtc(tmp_crtc, crtc->dev) {
 		if (_sde_core_perf_crtc_is_power_on(tmp_crtc) &&
@@ -690,16 +786,29 @@ static void _sde_core_perf_crtc_update_bus(struct sde_kms *kms,
 	client_vote = _get_sde_client_type(curr_client_type, &kms->perf);
 	switch (client_vote) {
 	case RT_CLIENT:
-		sde_power_data_bus_set_quota(&priv->phandle,
+		if (_sde_core_perf_vote_is_cached(&kms->perf, bus_id, NULL,
+				bus_ab_quota, bus_ib_quota))
+			break;
+
+		rc = sde_power_data_bus_set_quota(&priv->phandle,
 				bus_id, bus_ab_quota, bus_ib_quota);
+		if (rc)
+			kms->perf.last_vote[bus_id].valid = false;
 		SDE_DEBUG("client:%s bus_id=%d ab=%llu ib=%llu\n", "rt",
 				bus_id, bus_ab_quota, bus_ib_quota);
 		break;
 
 	case RT_RSC_CLIENT:
 		sde_cstate = to_sde_crtc_state(crtc->state);
-		sde_rsc_client_vote(sde_cstate->rsc_client,
+		if (_sde_core_perf_vote_is_cached(&kms->perf, bus_id,
+				sde_cstate->rsc_client, bus_ab_quota,
+				bus_ib_quota))
+			break;
+
+		rc = sde_rsc_client_vote(sde_cstate->rsc_client,
 				bus_id, bus_ab_quota, bus_ib_quota);
+		if (rc)
+			kms->perf.last_vote[bus_id].valid = false;
 		SDE_DEBUG("client:%s bus_id=%d ab=%llu ib=%llu\n", "rt_rsc",
 				bus_id, bus_ab_quota, bus_ib_quota);
 		break;
@@ -818,6 +927,75 @@ static u64 _sde_core_perf_get_core_clk_rate(struct sde_kms *kms)
 	return clk_rate;
 }
 
+static bool _sde_core_perf_is_lower(struct sde_core_perf_params *old,
+		struct sde_core_perf_params *new)
+{
+	int i;
+
+	for (i = 0; i < SDE_POWER_HANDLE_DBUS_ID_MAX; i++)
+		if (new->bw_ctl[i] < old->bw_ctl[i] ||
+				new->max_per_pipe_ib[i] <
+				old->max_per_pipe_ib[i])
+			return true;
+
+	return new->core_clk_rate && new->core_clk_rate < old->core_clk_rate;
+}
+
+/* time the given number of frames take at the current refresh rate */
+static unsigned long _sde_core_perf_lower_delay(struct drm_crtc *crtc,
+		u32 frames)
+{
+	int vrefresh = crtc->state ?
+			drm_mode_vrefresh(&crtc->state->adjusted_mode) : 0;
+
+	if (vrefresh <= 0)
+		vrefresh = SDE_PERF_DEFAULT_FPS;
+
+	return msecs_to_jiffies(DIV_ROUND_UP(frames * MSEC_PER_SEC,
+			vrefresh));
+}
+
+static void _sde_core_perf_lower_work(struct work_struct *work)
+{
+	struct sde_core_perf_cache *cache = container_of(to_delayed_work(work),
+			struct sde_core_perf_cache, lower_work);
+	struct sde_crtc *sde_crtc = container_of(cache, struct sde_crtc,
+			perf_cache);
+	struct drm_crtc *crtc = &sde_crtc->base;
+	bool pending;
+
+	mutex_lock(&sde_core_perf_lock);
+	pending = cache->lower_cnt && _sde_core_perf_crtc_is_power_on(crtc);
+	if (pending)
+		cache->lower_flush = true;
+	mutex_unlock(&sde_core_perf_lock);
+
+	if (pending) {
+		SDE_EVT32(DRMID(crtc));
+		sde_core_perf_crtc_update(crtc, 0, false);
+	}
+}
+
+void sde_core_perf_crtc_init(struct drm_crtc *crtc)
+{
+	struct sde_crtc *sde_crtc;
+
+	if (!crtc)
+		return;
+
+	sde_crtc = to_sde_crtc(crtc);
+	INIT_DELAYED_WORK(&sde_crtc->perf_cache.lower_work,
+			_sde_core_perf_lower_work);
+}
+
+void sde_core_perf_crtc_deinit(struct drm_crtc *crtc)
+{
+	if (!crtc)
+		return;
+
+	cancel_delayed_work_sync(&to_sde_crtc(crtc)->perf_cache.lower_work);
+}
+
 static void _sde_core_perf_crtc_update_check(struct drm_crtc *crtc,
 		int params_changed,
 		int *update_bus, int *update_clk, int *update_llcc)
@@ -826,6 +1004,7 @@ static void _sde_core_perf_crtc_update_check(struct drm_crtc *crtc,
 	struct sde_crtc *sde_crtc = to_sde_crtc(crtc);
 	struct sde_core_perf_params *old = &sde_crtc->cur_perf;
 	struct sde_core_perf_params *new = &sde_crtc->new_perf;
+	bool defer_lower = false;
 	int i;
 
 	if (!kms)
@@ -852,6 +1031,34 @@ static void _sde_core_perf_crtc_update_check(struct drm_crtc *crtc,
 		*update_llcc = 1;
 	}
 
+	/*
+	 * Hold back lower votes until they were requested by a few frames
+	 * in a row, so that alternating frames don't make the votes bounce.
+	 * A screen that goes static has no further frames, so the deferred
+	 * vote is also applied once the frames it waits for have elapsed.
+	 */
+	if (!params_changed && !kms->perf.perf_tune.mode_changed) {
+		struct sde_core_perf_cache *cache = &sde_crtc->perf_cache;
+
+		if (!_sde_core_perf_is_lower(old, new)) {
+			cache->lower_cnt = 0;
+			cancel_delayed_work(&cache->lower_work);
+		} else if (!cache->lower_flush &&
+				++cache->lower_cnt < kms->perf.vote_hysteresis) {
+			SDE_EVT32(DRMID(crtc), cache->lower_cnt);
+			kms->perf.stats.lower_deferred++;
+			defer_lower = true;
+			mod_delayed_work(system_wq, &cache->lower_work,
+					_sde_core_perf_lower_delay(crtc,
+					kms->perf.vote_hysteresis -
+					cache->lower_cnt));
+		} else {
+			cache->lower_cnt = 0;
+			cancel_delayed_work(&cache->lower_work);
+		}
+		cache->lower_flush = false;
+	}
+
 	for (i = 0; i < SDE_POWER_HANDLE_DBUS_ID_MAX; i++) {
 		/*
 		 * cases for bus bandwidth update.
@@ -863,7 +1070,7 @@ static void _sde_core_perf_crtc_update_check(struct drm_crtc *crtc,
 
 		if ((params_changed &&
 				(new->bw_ctl[i] > old->bw_ctl[i])) ||
-				(!params_changed &&
+				(!params_changed && !defer_lower &&
 				(new->bw_ctl[i] < old->bw_ctl[i]))) {
 
 			SDE_DEBUG(
@@ -877,7 +1084,7 @@ static void _sde_core_perf_crtc_update_check(struct drm_crtc *crtc,
 		if ((params_changed &&
 				(new->max_per_pipe_ib[i] >
 				 old->max_per_pipe_ib[i])) ||
-				(!params_changed &&
+				(!params_changed && !defer_lower &&
 				(new->max_per_pipe_ib[i] <
 				old->max_per_pipe_ib[i]))) {
 
@@ -920,7 +1127,8 @@ static void _sde_core_perf_crtc_update_check(struct drm_crtc *crtc,
 
 	if ((params_changed &&
 			(new->core_clk_rate > old->core_clk_rate)) ||
-			(!params_changed && new->core_clk_rate &&
+			(!params_changed && !defer_lower &&
+			new->core_clk_rate &&
 			(new->core_clk_rate < old->core_clk_rate)) ||
 			kms->perf.perf_tune.mode_changed) {
 		old->core_clk_rate = new->core_clk_rate;
@@ -934,6 +1142,7 @@ void sde_core_perf_crtc_update(struct drm_crtc *crtc,
 {
 	struct sde_core_perf_params *new, *old;
 	int update_bus = 0, update_clk = 0, update_llcc = 0;
+	bool force_clk;
 	u64 clk_rate = 0;
 	struct sde_crtc *sde_crtc;
 	struct sde_crtc_state *sde_cstate;
@@ -971,6 +1180,7 @@ void sde_core_perf_crtc_update(struct drm_crtc *crtc,
 
 	old = &sde_crtc->cur_perf;
 	new = &sde_crtc->new_perf;
+	force_clk = stop_req || kms->perf.perf_tune.mode_changed;
 
 	if (_sde_core_perf_crtc_is_power_on(crtc) && !stop_req) {
 		_sde_core_perf_crtc_update_check(crtc, params_changed,
@@ -979,6 +1189,8 @@ void sde_core_perf_crtc_update(struct drm_crtc *crtc,
 		SDE_DEBUG("crtc=%d disable\n", crtc->base.id);
 		memset(old, 0, sizeof(*old));
 		memset(new, 0, sizeof(*new));
+		sde_crtc->perf_cache.lower_cnt = 0;
+		sde_crtc->perf_cache.lower_flush = false;
 		update_bus = ~0;
 		update_clk = 1;
 		update_llcc = 1;
@@ -1016,6 +1228,15 @@ void sde_core_perf_crtc_update(struct drm_crtc *crtc,
 	if (update_clk) {
 		clk_rate = _sde_core_perf_get_core_clk_rate(kms);
 
+		/* the aggregated rate may not change with this crtc's vote */
+		if (!force_clk && clk_rate == kms->perf.core_clk_rate) {
+			kms->perf.stats.clk_votes_skipped++;
+			update_clk = 0;
+		}
+	}
+
+	if (update_clk) {
+		kms->perf.stats.clk_votes++;
 		SDE_EVT32(kms->dev, stop_req, clk_rate, params_changed,
 			old->core_clk_rate, new->core_clk_rate);
 		ret = sde_power_clk_set_rate(&priv->phandle,
@@ -1252,6 +1473,23 @@ int sde_core_perf_debugfs_init(struct sde_core_perf *perf,
 	debugfs_create_bool("uidle_enable", 0600, perf->debugfs_root,
 			&sde_kms->catalog->uidle_cfg.debugfs_ctrl);
 
+	debugfs_create_u32("vote_hysteresis", 0600, perf->debugfs_root,
+			&perf->vote_hysteresis);
+	debugfs_create_u64("bus_votes", 0400, perf->debugfs_root,
+			&perf->stats.bus_votes);
+	debugfs_create_u64("bus_votes_skipped", 0400, perf->debugfs_root,
+			&perf->stats.bus_votes_skipped);
+	debugfs_create_u64("clk_votes", 0400, perf->debugfs_root,
+			&perf->stats.clk_votes);
+	debugfs_create_u64("clk_votes_skipped", 0400, perf->debugfs_root,
+			&perf->stats.clk_votes_skipped);
+	debugfs_create_u64("calc_cache_hits", 0400, perf->debugfs_root,
+			&perf->stats.calc_cache_hits);
+	debugfs_create_u64("calc_cache_misses", 0400, perf->debugfs_root,
+			&perf->stats.calc_cache_misses);
+	debugfs_create_u64("lower_votes_deferred", 0400, perf->debugfs_root,
+			&perf->stats.lower_deferred);
+
 	return 0;
 }
 #else
@@ -1298,6 +1536,7 @@ int sde_core_perf_init(struct sde_core_perf *perf,
 	perf->phandle = phandle;
 	perf->clk_name = clk_name;
 	perf->sde_rsc_available = is_sde_rsc_available(SDE_RSC_INDEX);
+	perf->vote_hysteresis = SDE_PERF_DEFAULT_VOTE_HYSTERESIS;
 	/* set default mode */
 	if (perf->sde_rsc_available)
 		perf->bw_vote_mode = DISP_RSC_MODE;
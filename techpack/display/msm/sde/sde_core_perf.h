@@ -9,6 +9,7 @@
 #include <linux/types.h>
 #include <linux/dcache.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 #include <drm/drm_crtc.h>
 
 #include "sde_hw_catalog.h"
@@ -16,6 +17,12 @@
 
 #define	SDE_PERF_DEFAULT_MAX_CORE_CLK_RATE	320000000
 
+/* Number of frame done updates a lower vote must persist before applied */
+#define SDE_PERF_DEFAULT_VOTE_HYSTERESIS	2
+
+/* Number of crtc properties the performance of a crtc is computed from */
+#define SDE_PERF_KEY_PROP_COUNT			7
+
 /**
  *  uidle performance counters mode
  * @SDE_PERF_UIDLE_DISABLE: Disable logging (default)
@@ -42,6 +49,70 @@ struct sde_core_perf_params {
 	bool llcc_active;
 };
 
+/**
+ * struct sde_core_perf_key - inputs the crtc performance is computed from
+ * @props: values of the bandwidth and clock crtc properties
+ * @plane_mask: planes staged on the crtc
+ * @bw_split_vote: whether llcc and dram bandwidth are voted separately
+ */
+struct sde_core_perf_key {
+	u64 props[SDE_PERF_KEY_PROP_COUNT];
+	u32 plane_mask;
+	bool bw_split_vote;
+};
+
+/**
+ * struct sde_core_perf_cache - last computed performance of a crtc
+ * @valid: true if @key and @perf hold a previous computation
+ * @key: inputs of the previous computation
+ * @perf: result of the previous computation
+ * @lower_cnt: consecutive frame done updates that requested a lower vote
+ * @lower_flush: apply the pending lower vote on the next frame done update
+ * @lower_work: applies a pending lower vote if no frame done update follows
+ */
+struct sde_core_perf_cache {
+	bool valid;
+	struct sde_core_perf_key key;
+	struct sde_core_perf_params perf;
+	u32 lower_cnt;
+	bool lower_flush;
+	struct delayed_work lower_work;
+};
+
+/**
+ * struct sde_core_perf_vote - last bandwidth vote sent on a data bus
+ * @valid: true if @ab and @ib are known to be the current vote
+ * @client: rsc client the vote was sent through, NULL for the power handle
+ * @ab: arbitrated bandwidth voted
+ * @ib: instantaneous bandwidth voted
+ */
+struct sde_core_perf_vote {
+	bool valid;
+	void *client;
+	u64 ab;
+	u64 ib;
+};
+
+/**
+ * struct sde_core_perf_stats - vote and cache counters
+ * @bus_votes: data bus votes sent
+ * @bus_votes_skipped: data bus votes skipped as identical to the last one
+ * @clk_votes: core clock votes sent
+ * @clk_votes_skipped: core clock votes skipped as identical to the last one
+ * @calc_cache_hits: crtc checks that reused the previous computation
+ * @calc_cache_misses: crtc checks that computed the performance
+ * @lower_deferred: lower votes held back by the hysteresis
+ */
+struct sde_core_perf_stats {
+	u64 bus_votes;
+	u64 bus_votes_skipped;
+	u64 clk_votes;
+	u64 clk_votes_skipped;
+	u64 calc_cache_hits;
+	u64 calc_cache_misses;
+	u64 lower_deferred;
+};
+
 /**
  * struct sde_core_perf_tune - definition of performance tuning control
  * @mode: performance mode
@@ -76,6 +147,10 @@ struct sde_core_perf_tune {
  * @bw_vote_mode_updated: bandwidth vote mode update
  * @llcc_active: status of the llcc, true if active.
  * @uidle_enabled: indicates if uidle is already enabled
+ * @vote_hysteresis: frame done updates a lower vote must persist for, or
+ *	the time as many frames take if the screen goes static
+ * @last_vote: last bandwidth vote sent on each data bus
+ * @stats: vote and cache counters
  */
 struct sde_core_perf {
 	struct drm_device *dev;
@@ -96,6 +171,9 @@ struct sde_core_perf {
 	bool bw_vote_mode_updated;
 	bool llcc_active;
 	bool uidle_enabled;
+	u32 vote_hysteresis;
+	struct sde_core_perf_vote last_vote[SDE_POWER_HANDLE_DBUS_ID_MAX];
+	struct sde_core_perf_stats stats;
 };
 
 /**
@@ -107,6 +185,18 @@ struct sde_core_perf {
 int sde_core_perf_crtc_check(struct drm_crtc *crtc,
 		struct drm_crtc_state *state);
 
+/**
+ * sde_core_perf_crtc_init - initialize the core performance state of a crtc
+ * @crtc: Pointer to crtc
+ */
+void sde_core_perf_crtc_init(struct drm_crtc *crtc);
+
+/**
+ * sde_core_perf_crtc_deinit - release the core performance state of a crtc
+ * @crtc: Pointer to crtc
+ */
+void sde_core_perf_crtc_deinit(struct drm_crtc *crtc);
+
 /**
  * sde_core_perf_crtc_update - update performance of the given crtc
  * @crtc: Pointer to crtc
@@ -129,6 +219,13 @@ void sde_core_perf_crtc_release_bw(struct drm_crtc *crtc);
  */
 void sde_core_perf_crtc_update_uidle(struct drm_crtc *crtc, bool enable);
 
+/**
+ * sde_core_perf_invalidate_votes - forget the cached bandwidth votes, to be
+ *	called when the data bus is voted outside of the core perf
+ * @perf: Pointer to core performance context
+ */
+void sde_core_perf_invalidate_votes(struct sde_core_perf *perf);
+
 /**
  * sde_core_perf_destroy - destroy the given core performance context
  * @perf: Pointer to core performance context
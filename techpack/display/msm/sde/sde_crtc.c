@@ -21,6 +21,7 @@
 #include <linux/sort.h>
 #include <linux/debugfs.h>
 #include <linux/ktime.h>
+#include <linux/cpu_boost.h>
 #include <uapi/drm/sde_drm.h>
 #include <drm/drm_mode.h>
 #include <drm/drm_crtc.h>
@@ -41,6 +42,7 @@
 #include "sde_vbif.h"
 #include "sde_power_handle.h"
 #include "sde_core_perf.h"
+#include "sde_reg_dma.h"
 #include "sde_trace.h"
 #include "dsi_display.h"
 
@@ -433,6 +435,8 @@ static void sde_crtc_destroy(struct drm_crtc *crtc)
 	if (!crtc)
 		return;
 
+	sde_core_perf_crtc_deinit(crtc);
+
 	if (sde_crtc->vsync_event_sf)
 		sysfs_put(sde_crtc->vsync_event_sf);
 	if (sde_crtc->retire_frame_event_sf)
@@ -2389,6 +2393,9 @@ static void sde_crtc_frame_event_work(struct kthread_work *work)
 	in_clone_mode = (fevent->event & SDE_ENCODER_FRAME_EVENT_CWB_DONE) ?
 			true : false;
 
+	if (!in_clone_mode && (fevent->event & SDE_ENCODER_FRAME_EVENT_DONE))
+		cpu_boost_frame_committed();
+
 	if (!in_clone_mode && (fevent->event & (SDE_ENCODER_FRAME_EVENT_ERROR
 					| SDE_ENCODER_FRAME_EVENT_PANEL_DEAD
 					| SDE_ENCODER_FRAME_EVENT_DONE))) {
@@ -3161,6 +3168,70 @@ static void _sde_crtc_setup_lm_bounds(struct drm_crtc *crtc,
 	drm_mode_debug_printmodeline(adj_mode);
 }
 
+/**
+ * _sde_crtc_reg_batch_end - queue the register writes batched during the
+ *	commit on the ctl, they are triggered along with the ctl flush
+ * @crtc: Pointer to drm crtc structure
+ */
+static void _sde_crtc_reg_batch_end(struct drm_crtc *crtc)
+{
+	struct sde_crtc *sde_crtc = to_sde_crtc(crtc);
+	int rc;
+
+	if (!sde_crtc->reg_batch)
+		return;
+
+	rc = sde_reg_dma_batch_end(sde_crtc->reg_batch);
+	sde_crtc->reg_batch = NULL;
+
+	if (rc < 0) {
+		sde_crtc->reg_batch_fallbacks++;
+		sde_crtc->reg_batch_last = 0;
+		return;
+	}
+
+	sde_crtc->reg_batch_commits++;
+	sde_crtc->reg_batch_writes += rc;
+	sde_crtc->reg_batch_last = rc;
+	SDE_EVT32(DRMID(crtc), rc);
+}
+
+/**
+ * _sde_crtc_reg_batch_begin - route the pipe and mixer register writes of
+ *	the commit to a reg dma buffer instead of mmio. Pipe QoS registers
+ *	are not double buffered and are always written through mmio.
+ * @crtc: Pointer to drm crtc structure
+ */
+static void _sde_crtc_reg_batch_begin(struct drm_crtc *crtc)
+{
+	struct sde_crtc *sde_crtc = to_sde_crtc(crtc);
+	struct sde_kms *sde_kms = _sde_crtc_get_kms(crtc);
+	struct sde_reg_dma_batch *batch;
+	struct drm_plane *plane;
+	int i;
+
+	/* a commit that didn't reach atomic_flush must not leave maps routed */
+	_sde_crtc_reg_batch_end(crtc);
+
+	if (!sde_crtc->reg_batch_enable || !sde_kms ||
+			!sde_kms_is_cp_operation_allowed(sde_kms))
+		return;
+
+	batch = sde_reg_dma_batch_begin(sde_crtc->mixers[0].hw_ctl);
+	if (!batch)
+		return;
+
+	for (i = 0; i < sde_crtc->num_mixers; i++)
+		if (sde_crtc->mixers[i].hw_lm)
+			sde_reg_dma_batch_attach(batch,
+					&sde_crtc->mixers[i].hw_lm->hw);
+
+	drm_atomic_crtc_for_each_plane(plane, crtc)
+		sde_plane_reg_batch_attach(plane, batch);
+
+	sde_crtc->reg_batch = batch;
+}
+
 static void sde_crtc_atomic_begin(struct drm_crtc *crtc,
 		struct drm_crtc_state *old_state)
 {
@@ -3226,6 +3297,8 @@ static void sde_crtc_atomic_begin(struct drm_crtc *crtc,
 	if (unlikely(!sde_crtc->num_mixers))
 		goto end;
 
+	_sde_crtc_reg_batch_begin(crtc);
+
 	_sde_crtc_blend_setup(crtc, old_state, true);
 	_sde_crtc_dest_scaler_setup(crtc);
 
@@ -3392,6 +3465,8 @@ static void sde_crtc_atomic_flush(struct drm_crtc *crtc,
 		sde_plane_flush(plane);
 	}
 
+	_sde_crtc_reg_batch_end(crtc);
+
 	/* Kickoff will be scheduled by outer layer */
 	SDE_ATRACE_END("sde_crtc_atomic_flush");
 }
@@ -6218,6 +6293,20 @@ static int sde_crtc_debugfs_state_show(struct seq_file *s, void *v)
 }
 DEFINE_SDE_DEBUGFS_SEQ_FOPS(sde_crtc_debugfs_state);
 
+static int sde_crtc_debugfs_reg_batch_show(struct seq_file *s, void *v)
+{
+	struct drm_crtc *crtc = (struct drm_crtc *) s->private;
+	struct sde_crtc *sde_crtc = to_sde_crtc(crtc);
+
+	seq_printf(s, "commits: %llu\n", sde_crtc->reg_batch_commits);
+	seq_printf(s, "writes_avoided: %llu\n", sde_crtc->reg_batch_writes);
+	seq_printf(s, "last_writes_avoided: %u\n", sde_crtc->reg_batch_last);
+	seq_printf(s, "fallbacks: %llu\n", sde_crtc->reg_batch_fallbacks);
+
+	return 0;
+}
+DEFINE_SDE_DEBUGFS_SEQ_FOPS(sde_crtc_debugfs_reg_batch);
+
 static int _sde_debugfs_fence_status_show(struct seq_file *s, void *data)
 {
 	struct drm_crtc *crtc;
@@ -6342,6 +6431,11 @@ static int _sde_crtc_init_debugfs(struct drm_crtc *crtc)
 					sde_crtc, &debugfs_fps_fops);
 	debugfs_create_file("fence_status", 0400, sde_crtc->debugfs_root,
 					sde_crtc, &debugfs_fence_fops);
+	debugfs_create_bool("reg_batch", 0600, sde_crtc->debugfs_root,
+			&sde_crtc->reg_batch_enable);
+	debugfs_create_file("reg_batch_stats", 0400, sde_crtc->debugfs_root,
+			&sde_crtc->base,
+			&sde_crtc_debugfs_reg_batch_fops);
 
 	return 0;
 }
@@ -6544,6 +6638,8 @@ struct drm_crtc *sde_crtc_init(struct drm_device *dev, struct drm_plane *plane)
 	mutex_init(&sde_crtc->vblank_modeset_ctrl_lock);
 
 	sde_crtc->enabled = false;
+	sde_crtc->reg_batch_enable = true;
+	sde_core_perf_crtc_init(crtc);
 
 	/* Below parameters are for fps calculation for sysfs node */
 	sde_crtc->fps_info.fps_periodic_duration = DEFAULT_FPS_PERIOD_1_SEC;
@@ -274,6 +274,7 @@ struct sde_crtc_misr_info {
  * @idle_notify_work: delayed worker to notify idle timeout to user space
  * @power_event   : registered power event handle
  * @cur_perf      : current performance committed to clock/bandwidth driver
+ * @perf_cache    : last computed performance and vote hysteresis state
  * @plane_mask_old: keeps track of the planes used in the previous commit
  * @frame_trigger_mode: frame trigger mode
  * @cp_pu_feature_mask: mask indicating cp feature enable for partial update
@@ -288,6 +289,13 @@ struct sde_crtc_misr_info {
  * @needs_hw_reset  : Initiate a hw ctl reset
  * @comp_ratio      : Compression ratio
  * @dspp_blob_info  : blob containing dspp hw capability information
+ * @reg_batch_enable : route the pipe and mixer writes of a commit through
+ *                    a single reg dma buffer
+ * @reg_batch       : reg dma batch of the commit in progress, if any
+ * @reg_batch_commits : number of commits sent through reg dma
+ * @reg_batch_writes : number of mmio writes avoided in total
+ * @reg_batch_last  : number of mmio writes avoided by the last commit
+ * @reg_batch_fallbacks : number of batches written through mmio instead
  */
 struct sde_crtc {
 	struct drm_crtc base;
@@ -355,6 +363,7 @@ struct sde_crtc {
 
 	struct sde_core_perf_params cur_perf;
 	struct sde_core_perf_params new_perf;
+	struct sde_core_perf_cache perf_cache;
 
 	u32 plane_mask_old;
 
@@ -380,6 +389,13 @@ struct sde_crtc {
 	uint32_t mi_dimlayer_type;
 
 	struct drm_property_blob *dspp_blob_info;
+
+	bool reg_batch_enable;
+	struct sde_reg_dma_batch *reg_batch;
+	u64 reg_batch_commits;
+	u64 reg_batch_writes;
+	u32 reg_batch_last;
+	u64 reg_batch_fallbacks;
 };
 
 #define to_sde_crtc(x) container_of(x, struct sde_crtc, base)
@@ -697,6 +697,13 @@ int init_v12(struct sde_hw_reg_dma *cfg)
 	v1_supported[LTM_VLUT] = GRP_LTM_HW_BLK_SELECT;
 	v1_supported[RC_DATA] = (GRP_DSPP_HW_BLK_SELECT |
 			GRP_MDSS_HW_BLK_SELECT);
+	/*
+	 * Commit batching writes pipe and mixer registers by their mdss
+	 * offset, which needs the absolute range decode added in v1.2.
+	 * Earlier versions can only address VIG/DMA/DSPP relative to the
+	 * selected block, so commits keep using mmio there.
+	 */
+	v1_supported[COMMIT_BATCH] = GRP_MDSS_HW_BLK_SELECT;
 
 	return 0;
 }
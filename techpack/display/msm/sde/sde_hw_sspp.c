@@ -852,16 +852,22 @@ static void sde_hw_sspp_setup_qos_lut(struct sde_hw_pipe *ctx,
 	if (_sspp_subblk_offset(ctx, SDE_SSPP_SRC, &idx))
 		return;
 
-	SDE_REG_WRITE(&ctx->hw, SSPP_DANGER_LUT + idx, cfg->danger_lut);
-	SDE_REG_WRITE(&ctx->hw, SSPP_SAFE_LUT + idx, cfg->safe_lut);
+	/*
+	 * QoS luts take effect as soon as they are written, so they must
+	 * not be deferred to the reg dma batch of the commit
+	 */
+	SDE_REG_WRITE_MMIO(&ctx->hw, SSPP_DANGER_LUT + idx, cfg->danger_lut);
+	SDE_REG_WRITE_MMIO(&ctx->hw, SSPP_SAFE_LUT + idx, cfg->safe_lut);
 
 	if (ctx->cap && test_bit(SDE_PERF_SSPP_QOS_8LVL,
 				&ctx->cap->perf_features)) {
-		SDE_REG_WRITE(&ctx->hw, SSPP_CREQ_LUT_0 + idx, cfg->creq_lut);
-		SDE_REG_WRITE(&ctx->hw, SSPP_CREQ_LUT_1 + idx,
+		SDE_REG_WRITE_MMIO(&ctx->hw, SSPP_CREQ_LUT_0 + idx,
+				cfg->creq_lut);
+		SDE_REG_WRITE_MMIO(&ctx->hw, SSPP_CREQ_LUT_1 + idx,
 				cfg->creq_lut >> 32);
 	} else {
-		SDE_REG_WRITE(&ctx->hw, SSPP_CREQ_LUT + idx, cfg->creq_lut);
+		SDE_REG_WRITE_MMIO(&ctx->hw, SSPP_CREQ_LUT + idx,
+				cfg->creq_lut);
 	}
 }
 
@@ -887,7 +893,7 @@ static void sde_hw_sspp_setup_qos_ctrl(struct sde_hw_pipe *ctx,
 	if (cfg->danger_safe_en)
 		qos_ctrl |= SSPP_QOS_CTRL_DANGER_SAFE_EN;
 
-	SDE_REG_WRITE(&ctx->hw, SSPP_QOS_CTRL + idx, qos_ctrl);
+	SDE_REG_WRITE_MMIO(&ctx->hw, SSPP_QOS_CTRL + idx, qos_ctrl);
 }
 
 static void sde_hw_sspp_setup_ts_prefill(struct sde_hw_pipe *ctx,
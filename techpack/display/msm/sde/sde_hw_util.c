@@ -9,6 +9,7 @@
 #include "sde_kms.h"
 #include "sde_hw_mdss.h"
 #include "sde_hw_util.h"
+#include "sde_reg_dma.h"
 
 /* using a file static variables for debugfs access */
 static u32 sde_hw_util_log_mask = SDE_DBG_MASK_NONE;
@@ -71,6 +72,19 @@ void sde_reg_write(struct sde_hw_blk_reg_map *c,
 		u32 reg_off,
 		u32 val,
 		const char *name)
+{
+	SDE_EVT32_REGWRITE(c->blk_off, reg_off, val);
+	if (!c->batch || !sde_reg_dma_batch_write(c->batch,
+				c->blk_off + reg_off, val))
+		writel_relaxed(val, c->base_off + c->blk_off + reg_off);
+	SDE_REG_LOG(c->log_mask ? ilog2(c->log_mask)+1 : 0,
+			val, c->blk_off + reg_off);
+}
+
+void sde_reg_write_mmio(struct sde_hw_blk_reg_map *c,
+		u32 reg_off,
+		u32 val,
+		const char *name)
 {
 	SDE_EVT32_REGWRITE(c->blk_off, reg_off, val);
 	writel_relaxed(val, c->base_off + c->blk_off + reg_off);
@@ -80,6 +94,13 @@ void sde_reg_write(struct sde_hw_blk_reg_map *c,
 
 int sde_reg_read(struct sde_hw_blk_reg_map *c, u32 reg_off)
 {
+	u32 val;
+
+	/* a write still pending in the batch is not visible in the hw yet */
+	if (c->batch && sde_reg_dma_batch_read(c->batch,
+				c->blk_off + reg_off, &val))
+		return val;
+
 	return readl_relaxed(c->base_off + c->blk_off + reg_off);
 }
 
@@ -15,6 +15,7 @@
 #define LP_DDR4_TYPE			0x7
 
 struct sde_format_extended;
+struct sde_reg_dma_batch;
 
 /*
  * This is the common struct maintained by each sub block
@@ -25,6 +26,7 @@ struct sde_format_extended;
  * @length        length of register block offset
  * @xin_id        xin id
  * @hwversion     mdss hw version number
+ * @batch         reg dma batch the writes are routed to, NULL for mmio
  */
 struct sde_hw_blk_reg_map {
 	void __iomem *base_off;
@@ -33,6 +35,7 @@ struct sde_hw_blk_reg_map {
 	u32 xin_id;
 	u32 hwversion;
 	u32 log_mask;
+	struct sde_reg_dma_batch *batch;
 };
 
 /**
@@ -173,9 +176,15 @@ void sde_reg_write(struct sde_hw_blk_reg_map *c,
 		u32 reg_off,
 		u32 val,
 		const char *name);
+void sde_reg_write_mmio(struct sde_hw_blk_reg_map *c,
+		u32 reg_off,
+		u32 val,
+		const char *name);
 int sde_reg_read(struct sde_hw_blk_reg_map *c, u32 reg_off);
 
 #define SDE_REG_WRITE(c, off, val) sde_reg_write(c, off, val, #off)
+/* bypasses the reg dma batch, for registers that are not double buffered */
+#define SDE_REG_WRITE_MMIO(c, off, val) sde_reg_write_mmio(c, off, val, #off)
 #define SDE_REG_READ(c, off) sde_reg_read(c, off)
 
 #define SDE_IMEM_WRITE(addr, val) writel_relaxed(val, addr)
@@ -1105,6 +1105,7 @@ static void _sde_kms_release_splash_resource(struct sde_kms *sde_kms,
 					SDE_POWER_HANDLE_ENABLE_BUS_AB_QUOTA,
 					SDE_POWER_HANDLE_ENABLE_BUS_IB_QUOTA);
 
+		sde_core_perf_invalidate_votes(&sde_kms->perf);
 		pm_runtime_put_sync(sde_kms->dev->dev);
 	}
 }
@@ -37,6 +37,7 @@
 #include "sde_vbif.h"
 #include "sde_plane.h"
 #include "sde_color_processing.h"
+#include "sde_reg_dma.h"
 
 #define SDE_DEBUG_PLANE(pl, fmt, ...) SDE_DEBUG("plane%d " fmt,\
 		(pl) ? (pl)->base.base.id : -1, ##__VA_ARGS__)
@@ -2787,6 +2788,19 @@ void sde_plane_flush(struct drm_plane *plane)
 		pstate->pending = false;
 }
 
+void sde_plane_reg_batch_attach(struct drm_plane *plane,
+		struct sde_reg_dma_batch *batch)
+{
+	struct sde_plane *psde;
+
+	if (!plane || !batch)
+		return;
+
+	psde = to_sde_plane(plane);
+	if (psde->pipe_hw)
+		sde_reg_dma_batch_attach(batch, &psde->pipe_hw->hw);
+}
+
 /**
  * sde_plane_set_error: enable/disable error condition
  * @plane: pointer to drm_plane structure
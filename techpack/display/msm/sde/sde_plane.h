@@ -175,6 +175,15 @@ void sde_plane_restore(struct drm_plane *plane);
  */
 void sde_plane_flush(struct drm_plane *plane);
 
+/**
+ * sde_plane_reg_batch_attach - route the pipe register writes to a reg dma
+ *	batch until the batch is ended
+ * @plane: Pointer to drm plane structure
+ * @batch: Reg dma batch of the commit
+ */
+void sde_plane_reg_batch_attach(struct drm_plane *plane,
+		struct sde_reg_dma_batch *batch);
+
 /**
  * sde_plane_halt_requests - control halting of vbif transactions for this plane
  *	This function isn't thread safe. Plane halt enable/disable requests
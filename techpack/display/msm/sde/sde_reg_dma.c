@@ -6,12 +6,17 @@
 #define pr_fmt(fmt)	"[drm:%s:%d] " fmt, __func__, __LINE__
 #include "sde_reg_dma.h"
 #include "sde_hw_reg_dma_v1.h"
+#include "sde_hw_ctl.h"
 #include "sde_dbg.h"
 
 #define REG_DMA_VER_1_0 0x00010000
 #define REG_DMA_VER_1_1 0x00010001
 #define REG_DMA_VER_1_2 0x00010002
 
+/* decode select plus one single write per entry, with room to validate */
+#define REG_DMA_BATCH_BUF_SZ \
+	(sizeof(u32) * 2 * (REG_DMA_BATCH_MAX_WRITES + 2))
+
 static int default_check_support(enum sde_reg_dma_features feature,
 		     enum sde_reg_dma_blk blk,
 		     bool *is_supported)
@@ -78,6 +83,8 @@ static struct sde_hw_reg_dma reg_dma = {
 		default_last_command, default_dump_reg},
 };
 
+static struct sde_reg_dma_batch *reg_dma_batch[CTL_MAX];
+
 int sde_reg_dma_init(void __iomem *addr, struct sde_mdss_cfg *m,
 		struct drm_device *dev)
 {
@@ -133,9 +140,19 @@ void sde_reg_dma_deinit(void)
 		default_last_command, default_dump_reg},
 	};
 
+	int i;
+
 	if (!reg_dma.drm_dev || !reg_dma.caps)
 		return;
 
+	for (i = 0; i < CTL_MAX; i++) {
+		if (!reg_dma_batch[i])
+			continue;
+		reg_dma.ops.dealloc_reg_dma(reg_dma_batch[i]->buf);
+		kfree(reg_dma_batch[i]);
+		reg_dma_batch[i] = NULL;
+	}
+
 	switch (reg_dma.caps->version) {
 	case REG_DMA_VER_1_0:
 		deinit_v1();
@@ -150,3 +167,173 @@ void sde_reg_dma_deinit(void)
 	memset(&reg_dma, 0, sizeof(reg_dma));
 	memcpy(&reg_dma.ops, &op.ops, sizeof(op.ops));
 }
+
+struct sde_reg_dma_batch *sde_reg_dma_batch_begin(struct sde_hw_ctl *ctl)
+{
+	struct sde_reg_dma_batch *batch;
+	bool supported = false;
+
+	if (!ctl || ctl->idx >= CTL_MAX)
+		return NULL;
+
+	if (reg_dma.ops.check_support(COMMIT_BATCH, MDSS, &supported) ||
+			!supported)
+		return NULL;
+
+	batch = reg_dma_batch[ctl->idx];
+	if (!batch) {
+		batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+		if (!batch)
+			return NULL;
+
+		batch->buf = reg_dma.ops.alloc_reg_dma_buf(
+				REG_DMA_BATCH_BUF_SZ);
+		if (IS_ERR_OR_NULL(batch->buf)) {
+			DRM_DEBUG("failed to allocate batch buf for ctl %d\n",
+					ctl->idx);
+			kfree(batch);
+			return NULL;
+		}
+		reg_dma_batch[ctl->idx] = batch;
+	}
+
+	/* iova is invalidated while the smmu is detached */
+	if (!batch->buf->iova)
+		return NULL;
+
+	batch->ctl = ctl;
+	batch->count = 0;
+	batch->num_maps = 0;
+	batch->overflow = false;
+
+	return batch;
+}
+
+void sde_reg_dma_batch_attach(struct sde_reg_dma_batch *batch,
+		struct sde_hw_blk_reg_map *hw)
+{
+	u32 i;
+
+	if (!batch || !hw)
+		return;
+
+	for (i = 0; i < batch->num_maps; i++)
+		if (batch->maps[i] == hw)
+			return;
+
+	if (batch->num_maps >= REG_DMA_BATCH_MAX_MAPS)
+		return;
+
+	batch->base = hw->base_off;
+	batch->maps[batch->num_maps++] = hw;
+	hw->batch = batch;
+}
+
+static void _sde_reg_dma_batch_write_mmio(struct sde_reg_dma_batch *batch)
+{
+	u32 i;
+
+	for (i = 0; i < batch->count; i++)
+		writel_relaxed(batch->val[i], batch->base + batch->off[i]);
+
+	batch->count = 0;
+}
+
+bool sde_reg_dma_batch_write(struct sde_reg_dma_batch *batch, u32 off,
+		u32 val)
+{
+	if (batch->overflow)
+		return false;
+
+	if (batch->count >= REG_DMA_BATCH_MAX_WRITES) {
+		/* write out what is queued so the hw sees the writes in order */
+		_sde_reg_dma_batch_write_mmio(batch);
+		batch->overflow = true;
+		SDE_EVT32(batch->ctl->idx, REG_DMA_BATCH_MAX_WRITES);
+		return false;
+	}
+
+	batch->off[batch->count] = off;
+	batch->val[batch->count] = val;
+	batch->count++;
+
+	return true;
+}
+
+bool sde_reg_dma_batch_read(struct sde_reg_dma_batch *batch, u32 off,
+		u32 *val)
+{
+	u32 i;
+
+	for (i = batch->count; i > 0; i--) {
+		if (batch->off[i - 1] == off) {
+			*val = batch->val[i - 1];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int sde_reg_dma_batch_end(struct sde_reg_dma_batch *batch)
+{
+	struct sde_reg_dma_setup_ops_cfg cfg;
+	struct sde_reg_dma_kickoff_cfg kick_off;
+	u32 i, start, count;
+	int rc;
+
+	if (!batch)
+		return -EINVAL;
+
+	for (i = 0; i < batch->num_maps; i++)
+		batch->maps[i]->batch = NULL;
+	batch->num_maps = 0;
+
+	count = batch->count;
+	if (!count)
+		return 0;
+
+	reg_dma.ops.reset_reg_dma_buf(batch->buf);
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.dma_buf = batch->buf;
+	cfg.blk = MDSS;
+	cfg.feature = COMMIT_BATCH;
+	cfg.ops = HW_BLK_SELECT;
+	rc = reg_dma.ops.setup_payload(&cfg);
+
+	/* registers written back to back go out as one auto increment write */
+	for (start = 0; !rc && start < count; start = i) {
+		for (i = start + 1; i < count; i++)
+			if (batch->off[i] != batch->off[i - 1] + sizeof(u32))
+				break;
+
+		cfg.ops = (i - start > 1) ? REG_BLK_WRITE_SINGLE :
+			REG_SINGLE_WRITE;
+		cfg.blk_offset = batch->off[start];
+		cfg.data = &batch->val[start];
+		cfg.data_size = (i - start) * sizeof(u32);
+		rc = reg_dma.ops.setup_payload(&cfg);
+	}
+
+	if (!rc) {
+		memset(&kick_off, 0, sizeof(kick_off));
+		kick_off.ctl = batch->ctl;
+		kick_off.dma_buf = batch->buf;
+		kick_off.op = REG_DMA_WRITE;
+		kick_off.queue_select = DMA_CTL_QUEUE0;
+		kick_off.trigger_mode = WRITE_TRIGGER;
+		rc = reg_dma.ops.kick_off(&kick_off);
+	}
+
+	if (rc) {
+		DRM_ERROR("failed to queue batch of %u writes rc %d\n",
+				count, rc);
+		_sde_reg_dma_batch_write_mmio(batch);
+		return rc;
+	}
+
+	batch->count = 0;
+
+	return count;
+}
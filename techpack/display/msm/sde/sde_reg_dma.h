@@ -58,6 +58,7 @@ enum sde_reg_dma_read_sel {
  * @LTM_ROI: LTM ROI
  * @LTM_VLUT: LTM VLUT
  * @RC_DATA: Rounded corner data
+ * @COMMIT_BATCH: register writes of an atomic commit
  * @REG_DMA_FEATURES_MAX: invalid selection
  */
 enum sde_reg_dma_features {
@@ -77,6 +78,7 @@ enum sde_reg_dma_features {
 	LTM_ROI,
 	LTM_VLUT,
 	RC_DATA,
+	COMMIT_BATCH,
 	REG_DMA_FEATURES_MAX,
 };
 
@@ -314,6 +316,33 @@ struct sde_hw_reg_dma {
 	void __iomem *addr;
 };
 
+#define REG_DMA_BATCH_MAX_WRITES 512
+#define REG_DMA_BATCH_MAX_MAPS 32
+
+/**
+ * struct sde_reg_dma_batch - register writes of a commit routed to reg dma
+ * @ctl: ctl on which the batch is kicked off
+ * @buf: reg dma buffer the writes are encoded into at the end of the batch
+ * @base: mdss register base, used to write the batch through mmio
+ * @off: absolute offsets of the pending writes
+ * @val: values of the pending writes
+ * @count: number of pending writes
+ * @maps: register maps currently routed to the batch
+ * @num_maps: number of entries in @maps
+ * @overflow: set once the batch ran out of room, later writes go to mmio
+ */
+struct sde_reg_dma_batch {
+	struct sde_hw_ctl *ctl;
+	struct sde_reg_dma_buffer *buf;
+	void __iomem *base;
+	u32 off[REG_DMA_BATCH_MAX_WRITES];
+	u32 val[REG_DMA_BATCH_MAX_WRITES];
+	u32 count;
+	struct sde_hw_blk_reg_map *maps[REG_DMA_BATCH_MAX_MAPS];
+	u32 num_maps;
+	bool overflow;
+};
+
 /**
  * sde_reg_dma_init() - function called to initialize reg dma during sde
  *                         drm driver probe. If reg dma is supported by sde
@@ -339,4 +368,57 @@ struct sde_hw_reg_dma_ops *sde_reg_dma_get_ops(void);
  * sde_reg_dma_deinit() - de-initialize the reg dma
  */
 void sde_reg_dma_deinit(void);
+
+/**
+ * sde_reg_dma_batch_begin() - start batching the register writes of a commit
+ * @ctl: ctl on which the batch will be kicked off
+ *
+ * Only reg dma v1.2 and later can batch commits, older versions have no
+ * absolute range decode to reach the pipe and mixer registers.
+ *
+ * Return: batch to attach register maps to, NULL if reg dma can't be used
+ */
+struct sde_reg_dma_batch *sde_reg_dma_batch_begin(struct sde_hw_ctl *ctl);
+
+/**
+ * sde_reg_dma_batch_attach() - route the writes of a register map to a batch
+ * @batch: batch returned by sde_reg_dma_batch_begin
+ * @hw: register map of the hw block
+ */
+void sde_reg_dma_batch_attach(struct sde_reg_dma_batch *batch,
+		struct sde_hw_blk_reg_map *hw);
+
+/**
+ * sde_reg_dma_batch_write() - queue a register write in a batch
+ * @batch: batch the register map is attached to
+ * @off: register offset relative to the mdss base
+ * @val: value to write
+ *
+ * Return: true if the write was queued, false if it must go to mmio
+ */
+bool sde_reg_dma_batch_write(struct sde_reg_dma_batch *batch, u32 off,
+		u32 val);
+
+/**
+ * sde_reg_dma_batch_read() - look up a write still pending in a batch
+ * @batch: batch the register map is attached to
+ * @off: register offset relative to the mdss base
+ * @val: filled with the pending value
+ *
+ * Return: true if a write to @off is pending
+ */
+bool sde_reg_dma_batch_read(struct sde_reg_dma_batch *batch, u32 off,
+		u32 *val);
+
+/**
+ * sde_reg_dma_batch_end() - detach all register maps and queue the batch on
+ *                           the ctl. The writes are triggered along with the
+ *                           other reg dma buffers of the ctl at kickoff.
+ *                           If the batch can't be queued the writes are done
+ *                           through mmio instead.
+ * @batch: batch returned by sde_reg_dma_batch_begin
+ *
+ * Return: number of mmio writes avoided or error code
+ */
+int sde_reg_dma_batch_end(struct sde_reg_dma_batch *batch);
 #endif /* _SDE_REG_DMA_H */
@@ -18,6 +18,11 @@
 
 #define MSM_VIDC_SESSION_INACTIVE_THRESHOLD_MS 1000
 
+/* prediction within this margin of the actual frame load is a hit */
+#define DCVS_PRED_TOLERANCE_PCT 10
+/* frame needing this many times the inter average is treated as intra */
+#define DCVS_PRED_INTRA_FACTOR 2
+
 static int msm_vidc_decide_work_mode_ar50(struct msm_vidc_inst *inst);
 static unsigned long msm_vidc_calc_freq_ar50(struct msm_vidc_inst *inst,
 	u32 filled_len);
@@ -539,6 +544,118 @@ static int msm_dcvs_scale_clocks(struct msm_vidc_inst *inst,
 	return rc;
 }
 
+static unsigned long msm_dcvs_pred_avg(struct dcvs_pred_data *pred,
+		u32 cls)
+{
+	u64 sum = 0;
+	u32 i;
+
+	if (!pred->hist_cnt[cls])
+		return 0;
+
+	for (i = 0; i < pred->hist_cnt[cls]; i++)
+		sum += pred->hist[cls][i];
+
+	return (unsigned long)div_u64(sum, pred->hist_cnt[cls]);
+}
+
+static unsigned long msm_dcvs_pred_estimate(struct dcvs_pred_data *pred,
+		u32 cls)
+{
+	unsigned long avg, h;
+	u64 dev = 0;
+	u32 i;
+
+	avg = msm_dcvs_pred_avg(pred, cls);
+	if (!avg)
+		return 0;
+
+	/* average plus mean deviation, to absorb frame to frame jitter */
+	for (i = 0; i < pred->hist_cnt[cls]; i++) {
+		h = pred->hist[cls][i];
+		dev += h > avg ? h - avg : avg - h;
+	}
+
+	return avg + (unsigned long)div_u64(dev, pred->hist_cnt[cls]);
+}
+
+void msm_dcvs_predict_update(struct msm_vidc_inst *inst, u32 filled_len,
+		bool keyframe)
+{
+	struct clock_data *dcvs;
+	struct dcvs_pred_data *pred;
+	unsigned long freq, inter_avg, diff;
+	u32 cls, next_cls, err;
+
+	if (!inst || !inst->core) {
+		d_vpr_e("%s: invalid params %pK\n", __func__, inst);
+		return;
+	}
+
+	dcvs = &inst->clk_data;
+	pred = &dcvs->pred;
+	if (!dcvs->dcvs_predict || !filled_len)
+		return;
+
+	freq = call_core_op(inst->core, calc_freq, inst, filled_len);
+	if (!freq)
+		return;
+
+	inter_avg = msm_dcvs_pred_avg(pred, DCVS_FRAME_INTER);
+	cls = (keyframe ||
+		(inter_avg && freq > DCVS_PRED_INTRA_FACTOR * inter_avg)) ?
+		DCVS_FRAME_INTRA : DCVS_FRAME_INTER;
+
+	/* score the prediction that was voted for this frame */
+	if (pred->next_freq) {
+		diff = pred->next_freq > freq ?
+			pred->next_freq - freq : freq - pred->next_freq;
+		err = (u32)min_t(u64, div_u64((u64)diff * 100, freq), 1000);
+		pred->samples++;
+		if (err <= DCVS_PRED_TOLERANCE_PCT)
+			pred->hits++;
+		else if (pred->next_freq < freq)
+			pred->under++;
+		else
+			pred->over++;
+		pred->avg_err_pct = (pred->avg_err_pct * 7 + err) / 8;
+	}
+
+	pred->hist[cls][pred->hist_idx[cls]] = freq;
+	pred->hist_idx[cls] = (pred->hist_idx[cls] + 1) % DCVS_PRED_HISTORY;
+	if (pred->hist_cnt[cls] < DCVS_PRED_HISTORY)
+		pred->hist_cnt[cls]++;
+
+	if (cls == DCVS_FRAME_INTRA) {
+		if (pred->frames_since_intra)
+			pred->intra_period = pred->intra_period ?
+				(pred->intra_period * 3 +
+				 pred->frames_since_intra) / 4 :
+				pred->frames_since_intra;
+		pred->frames_since_intra = 0;
+	} else {
+		pred->frames_since_intra++;
+	}
+
+	/* expect an intra frame once the learnt GOP length is reached */
+	next_cls = DCVS_FRAME_INTER;
+	if (pred->intra_period && pred->hist_cnt[DCVS_FRAME_INTRA] &&
+		pred->frames_since_intra + 1 >= pred->intra_period)
+		next_cls = DCVS_FRAME_INTRA;
+	else if (!pred->hist_cnt[DCVS_FRAME_INTER])
+		next_cls = cls;
+
+	pred->next_class = next_cls;
+	pred->next_freq = msm_dcvs_pred_estimate(pred, next_cls);
+
+	s_vpr_p(inst->sid,
+		"DCVS pred: frame %lu (%s) next %lu (%s) err %u%%\n",
+		freq, cls == DCVS_FRAME_INTRA ? "intra" : "inter",
+		pred->next_freq,
+		next_cls == DCVS_FRAME_INTRA ? "intra" : "inter",
+		pred->avg_err_pct);
+}
+
 static unsigned long msm_vidc_max_freq(struct msm_vidc_core *core, u32 sid)
 {
 	struct allowed_clock_rates_table *allowed_clks_tbl = NULL;
@@ -1042,6 +1159,16 @@ int msm_comm_scale_clocks(struct msm_vidc_inst *inst, bool force_reset)
 	} else if (msm_vidc_clock_voting) {
 		inst->clk_data.min_freq = msm_vidc_clock_voting;
 		inst->clk_data.dcvs_flags = 0;
+	} else if (inst->clk_data.dcvs_predict &&
+			inst->clk_data.pred.next_freq) {
+		/*
+		 * Vote for the predicted load of the frame about to be
+		 * queued instead of stepping on buffer queue depth.
+		 */
+		freq = call_core_op(inst->core, calc_freq, inst, filled_len);
+		inst->clk_data.min_freq =
+			max(freq, inst->clk_data.pred.next_freq);
+		inst->clk_data.dcvs_flags = 0;
 	} else {
 		freq = call_core_op(inst->core, calc_freq, inst, filled_len);
 		inst->clk_data.min_freq = freq;
@@ -1071,6 +1198,11 @@ int msm_comm_scale_clocks_and_bus(struct msm_vidc_inst *inst, bool do_bw_calc)
 		inst->active = true;
 	}
 
+	/* raise the bus vote before an expected intra frame, not after */
+	if (inst->clk_data.dcvs_predict &&
+		inst->clk_data.pred.next_class == DCVS_FRAME_INTRA)
+		do_bw_calc = true;
+
 	if (msm_comm_scale_clocks(inst, false)) {
 		s_vpr_e(inst->sid,
 			"Failed to scale clocks. May impact performance\n");
@@ -1130,9 +1262,18 @@ int msm_dcvs_try_enable(struct msm_vidc_inst *inst)
 			is_turbo_session(inst) ||
 			inst->rc_type == V4L2_MPEG_VIDEO_BITRATE_MODE_CQ ||
 			disable_hfr_dcvs);
+	/*
+	 * The predictor learns from the compressed size of each input
+	 * buffer. Encoder inputs are raw YUV of constant size, so there is
+	 * nothing to learn from them.
+	 */
+	inst->clk_data.dcvs_predict =
+		inst->clk_data.dcvs_mode && msm_vidc_dcvs_predict &&
+		is_decode_session(inst);
 
-	s_vpr_hp(inst->sid, "DCVS %s: %pK\n",
-		inst->clk_data.dcvs_mode ? "enabled" : "disabled", inst);
+	s_vpr_hp(inst->sid, "DCVS %s%s: %pK\n",
+		inst->clk_data.dcvs_mode ? "enabled" : "disabled",
+		inst->clk_data.dcvs_predict ? " (predictive)" : "", inst);
 
 	return 0;
 }
@@ -1169,6 +1310,8 @@ void msm_dcvs_reset(struct msm_vidc_inst *inst)
 	dcvs->nom_threshold = dcvs->min_threshold +
 				(dcvs->dcvs_window ?
 				 (dcvs->dcvs_window / 2) : 0);
+
+	memset(&dcvs->pred, 0, sizeof(dcvs->pred));
 }
 
 int msm_comm_init_clocks_and_bus_data(struct msm_vidc_inst *inst)
@@ -9,6 +9,8 @@
 
 void msm_clock_data_reset(struct msm_vidc_inst *inst);
 void msm_dcvs_reset(struct msm_vidc_inst *inst);
+void msm_dcvs_predict_update(struct msm_vidc_inst *inst, u32 filled_len,
+	bool keyframe);
 int msm_vidc_set_clocks(struct msm_vidc_core *core, u32 sid, bool force_reset);
 int msm_comm_vote_bus(struct msm_vidc_inst *inst, bool force_reset);
 int msm_dcvs_try_enable(struct msm_vidc_inst *inst);
@@ -2558,6 +2558,8 @@ static void handle_ebd(enum hal_command_response cmd, void *data)
 		vb->planes[1].bytesused = vb->planes[1].length;
 
 	update_recon_stats(inst, &empty_buf_done->recon_stats);
+	msm_dcvs_predict_update(inst, vb->planes[0].bytesused,
+		!!(mbuf->vvb.flags & V4L2_BUF_FLAG_KEYFRAME));
 	inst->clk_data.buffer_counter++;
 	/*
 	 * dma cache operations need to be performed before dma_unmap
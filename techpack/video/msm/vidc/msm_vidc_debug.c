@@ -23,6 +23,7 @@ int msm_vidc_clock_voting = !1;
 bool msm_vidc_syscache_disable = !true;
 bool msm_vidc_cvp_usage = true;
 int msm_vidc_err_recovery_disable = !1;
+bool msm_vidc_dcvs_predict = !true;
 
 #define MAX_DBG_BUF_SIZE 4096
 
@@ -239,7 +240,8 @@ struct dentry *msm_vidc_debugfs_init_drv(void)
 	__debugfs_create(bool, "lossless_encoding",
 			&msm_vidc_lossless_encode) &&
 	__debugfs_create(u32, "disable_err_recovery",
-			&msm_vidc_err_recovery_disable);
+			&msm_vidc_err_recovery_disable) &&
+	__debugfs_create(bool, "dcvs_predict", &msm_vidc_dcvs_predict);
 
 #undef __debugfs_create
 
@@ -443,6 +445,24 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "FTB Count: %d\n", inst->count.ftb);
 	cur += write_str(cur, end - cur, "FBD Count: %d\n", inst->count.fbd);
 
+	if (inst->clk_data.dcvs_predict) {
+		struct dcvs_pred_data *pred = &inst->clk_data.pred;
+
+		cur += write_str(cur, end - cur,
+			"-----------DCVS prediction-----\n");
+		cur += write_str(cur, end - cur, "next freq: %lu (%s)\n",
+			pred->next_freq,
+			pred->next_class == DCVS_FRAME_INTRA ?
+			"intra" : "inter");
+		cur += write_str(cur, end - cur, "intra period: %u\n",
+			pred->intra_period);
+		cur += write_str(cur, end - cur,
+			"samples: %u hits: %u under: %u over: %u\n",
+			pred->samples, pred->hits, pred->under, pred->over);
+		cur += write_str(cur, end - cur, "avg error: %u%%\n",
+			pred->avg_err_pct);
+	}
+
 	publish_unreleased_reference(inst, &cur, end);
 	len = simple_read_from_buffer(buf, count, ppos,
 		dbuf, cur - dbuf);
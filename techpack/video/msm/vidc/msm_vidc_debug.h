@@ -78,6 +78,7 @@ extern bool msm_vidc_syscache_disable;
 extern bool msm_vidc_lossless_encode;
 extern bool msm_vidc_cvp_usage;
 extern int msm_vidc_err_recovery_disable;
+extern bool msm_vidc_dcvs_predict;
 
 #define dprintk(__level, sid, __fmt, ...)	\
 	do { \
@@ -392,6 +392,35 @@ enum dcvs_flags {
 	MSM_VIDC_DCVS_DECR = BIT(1),
 };
 
+#define DCVS_PRED_HISTORY 8
+
+enum dcvs_frame_class {
+	DCVS_FRAME_INTER,
+	DCVS_FRAME_INTRA,
+	DCVS_FRAME_CLASS_MAX,
+};
+
+/*
+ * Per session load predictor, decoder sessions only. Every processed
+ * frame contributes the clock it required to the history of its class;
+ * the next frame's clock is estimated from that history and voted before
+ * it is queued.
+ */
+struct dcvs_pred_data {
+	unsigned long hist[DCVS_FRAME_CLASS_MAX][DCVS_PRED_HISTORY];
+	u32 hist_idx[DCVS_FRAME_CLASS_MAX];
+	u32 hist_cnt[DCVS_FRAME_CLASS_MAX];
+	u32 frames_since_intra;
+	u32 intra_period;
+	u32 next_class;
+	unsigned long next_freq;
+	u32 samples;
+	u32 hits;
+	u32 under;
+	u32 over;
+	u32 avg_err_pct;
+};
+
 struct clock_data {
 	int buffer_counter;
 	int min_threshold;
@@ -417,6 +446,8 @@ struct clock_data {
 	u32 work_route;
 	u32 dcvs_flags;
 	u32 frame_rate;
+	bool dcvs_predict;
+	struct dcvs_pred_data pred;
 };
 
 struct vidc_bus_vote_data {